@@ -0,0 +1,116 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+/** \file
+	\brief Out-of-core block-wise surface extraction for large domains
+*/
+#pragma once
+
+#include "../common.hpp"
+#include "../data/component_index.hpp"
+#include "../field/scalar_field.hpp"
+#include "../qef/qef_solver_3d.hpp"
+#include "../util/zero_finder.hpp"
+
+#include <string>
+
+namespace isomesh
+{
+
+/** \brief Driver for extracting surfaces from domains too large for a single UniformGrid
+
+	The domain is a box of cells with its lowest corner placed at a given global position. It is
+	split into blocks, each of them is sampled into its own UniformGrid and contoured with either
+	\ref marchingCubes or \ref dualContouring on a pool of worker threads. Block meshes are streamed
+	into a single binary PLY file as soon as they are ready, vertices shared by neighbouring blocks
+	are welded together so the result has no seams.
+
+	Only as many grids as there are worker threads exist at once. Besides them, the driver keeps
+	only vertices lying on block boundaries which are still waiting for their neighbour blocks.
+	Blocks are processed in YXZ order, so this is roughly one layer of blocks worth of boundary data.
+
+	Neighbouring blocks sample the field at the same global points, but these points are computed
+	in different local spaces. If field value is exactly at zero there, blocks may disagree on edge
+	signs, producing a tiny crack. Choosing domain position and grid step exactly representable in
+	floating point (like integers or powers of two) avoids this completely.
+*/
+class BlockExtractor {
+public:
+	/** \brief Creates extractor for the given domain
+
+		\param[in] domainSize Size of the domain in cells, must be positive and less than 2^20 along each axis
+		\param[in] blockSize Size of a single block grid, requirements are the same as for UniformGrid size
+		\param[in] domainPos Global position of the lowest domain corner
+		\param[in] gridStep Distance between neighbouring grid points
+	*/
+	BlockExtractor (const glm::ivec3 &domainSize, uint32_t blockSize,
+	                const glm::dvec3 &domainPos = glm::dvec3 (0.0), double gridStep = 1.0);
+
+	/** \brief Extracts the surface using marching cubes
+
+		Blocks don't overlap, each of them shares one layer of grid points with its neighbours.
+		\param[in] field Scalar field to build surface of
+		\param[in] zeroFinder Solver to find zeros along grid edges
+		\param[in] filename Path to resulting PLY file
+	*/
+	void extractMarchingCubes (const ScalarField &field, const ZeroFinder &zeroFinder, const std::string &filename);
+	/** \brief Extracts the surface using dual contouring
+
+		Neighbouring blocks overlap by one layer of cells, so every quad has all its dual vertices
+		in at least one block. Each worker thread uses its own solver configured like \p solver.
+		\param[in] field Scalar field to build surface of
+		\param[in] zeroFinder Solver to find zeros along grid edges
+		\param[in] solver QEF solver prototype
+		\param[in] filename Path to resulting PLY file
+	*/
+	void extractDualContouring (const ScalarField &field, const ZeroFinder &zeroFinder,
+	                            const QefSolver3D &solver, const std::string &filename);
+
+	/** \brief Whether to write each connected component into a separate file
+
+		When enabled, \p filename passed to extraction methods is a path to ComponentIndex file.
+		Components are tracked across blocks with union-find and each of them is flushed to disk
+		as soon as all blocks it touches are processed, so no more than a few open components
+		are kept in memory. Component mesh files are named as \ref ComponentIndex::meshFilename
+		says. Note that welding is done on component level then, vertices not used by any triangle
+		are dropped.
+	*/
+	bool componentsSplit () const noexcept { return m_splitComponents; }
+	void setComponentsSplit (bool value) noexcept { m_splitComponents = value; }
+
+	/// Number of worker threads (one by default), zero means using all hardware threads
+	uint32_t threadCount () const noexcept { return m_threadCount; }
+	void setThreadCount (uint32_t value) noexcept { m_threadCount = value; }
+
+	glm::ivec3 domainSize () const noexcept { return m_domainSize; }
+	uint32_t blockSize () const noexcept { return m_blockSize; }
+	glm::dvec3 domainPosition () const noexcept { return m_domainPos; }
+	double gridStep () const noexcept { return m_gridStep; }
+
+	/// Number of vertices written during the last extraction
+	uint64_t vertexCount () const noexcept { return m_vertexCount; }
+	/// Number of triangles written during the last extraction
+	uint64_t triangleCount () const noexcept { return m_triangleCount; }
+	/// Number of components written during the last extraction (zero if components are not split)
+	uint64_t componentCount () const noexcept { return m_componentCount; }
+	/// Maximal number of boundary vertices waiting for neighbour blocks during the last extraction
+	uint64_t peakPendingVertices () const noexcept { return m_peakPendingVertices; }
+
+private:
+	template<bool DC>
+	void extract (const ScalarField &field, const ZeroFinder &zeroFinder,
+	              const QefSolver3D *solver, const std::string &filename);
+
+	glm::ivec3 m_domainSize;
+	uint32_t m_blockSize;
+	glm::dvec3 m_domainPos;
+	double m_gridStep;
+	uint32_t m_threadCount = 1;
+	bool m_splitComponents = false;
+
+	uint64_t m_vertexCount = 0;
+	uint64_t m_triangleCount = 0;
+	uint64_t m_peakPendingVertices = 0;
+	uint64_t m_componentCount = 0;
+};
+
+}
@@ -5,8 +5,12 @@
 */
 #pragma once
 
+#include "../data/fixed_grid.hpp"
 #include "../data/grid.hpp"
 #include "../data/mesh.hpp"
+#include "../util/component_culling.hpp"
+
+#include <array>
 
 namespace isomesh
 {
@@ -14,8 +18,49 @@ namespace isomesh
 /** \brief Marching cubes isosurface algorithm
 
 	TBD
+	\param[in] G Grid to build surface from
+	\param[in] culling Small components culling options, disabled by default
+*/
+Mesh marchingCubes (const UniformGrid &G, const ComponentCulling &culling = ComponentCulling ());
+
+/** \brief Marching cubes over a grid of fixed size
+
+	Builds exactly the same mesh as the generic version, but uses compile-time indexing of the grid.
+	Specialized code is compiled for sizes 16, 32 and 64, other sizes fall back to the generic version.
+*/
+template<uint32_t N>
+Mesh marchingCubes (const FixedUniformGrid<N> &G, const ComponentCulling &culling = ComponentCulling ()) {
+	return marchingCubes (static_cast<const UniformGrid &> (G), culling);
+}
+
+/// @cond
+template<>
+Mesh marchingCubes<16> (const FixedUniformGrid<16> &G, const ComponentCulling &culling);
+template<>
+Mesh marchingCubes<32> (const FixedUniformGrid<32> &G, const ComponentCulling &culling);
+template<>
+Mesh marchingCubes<64> (const FixedUniformGrid<64> &G, const ComponentCulling &culling);
+/// @endcond
+
+/** \brief Marching cubes with transition cells towards coarser neighbours
+
+	Used to join chunks of different levels of detail without cracks. Coarser neighbour is a grid
+	with two times bigger grid step adjacent to one of the grid faces, its points must coincide with
+	every other point of the grid on the shared face. Grid cells adjacent to such face are replaced with
+	transition cells sampled at neighbour's resolution on the face, so the surface on the face matches
+	the surface built by marching cubes from the neighbour. Neighbour meshes need no changes.
+
+	Chunks sharing a face along which both of them have transition cells must agree on coarser
+	neighbours of the edge between them, otherwise small cracks may appear there.
+	\param[in] G Grid to build surface from
+	\param[in] coarserNeighbours Coarser grids adjacent to -X, +X, -Y, +Y, -Z and +Z faces of the grid
+	(in this order), nullptr means there is no transition on the face
+	\param[in] culling Small components culling options, disabled by default
+	\throw std::invalid_argument if grid step or alignment of a neighbour is wrong, or if grid size is
+	less than four while there are coarser neighbours
 */
-Mesh marchingCubes (const UniformGrid &G);
+Mesh marchingCubes (const UniformGrid &G, const std::array<const UniformGrid *, 6> &coarserNeighbours,
+                    const ComponentCulling &culling = ComponentCulling ());
 
 }
 
@@ -0,0 +1,62 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+/** \file
+	\brief Feature-preserving edge-collapse mesh decimation
+*/
+#pragma once
+
+#include "../common.hpp"
+#include "../data/mesh.hpp"
+#include "../qef/qef_solver_3d.hpp"
+
+#include <limits>
+
+namespace isomesh
+{
+
+/** \brief Edge-collapse decimator for meshes built by extraction algorithms
+
+	Each vertex keeps a quadric error function in the same form as \ref QefSolver3D::State, built
+	from planes of its adjacent triangles. Collapsing an edge merges quadrics of its endpoints and
+	places the new vertex at the minimizer found by QefSolver3D (bounded by the edge's bounding
+	box), so sharp features are preserved the same way as in dual contouring. Edges are collapsed in
+	order of increasing error using a priority queue with lazy invalidation: queue entries are not
+	removed when their endpoints change, stale entries are detected and skipped when popped.
+
+	Collapses making the mesh non-manifold or flipping triangles are rejected. Vertices on mesh
+	boundary are never moved, so meshes of neighbouring chunks still join after decimation.
+
+	With several threads the mesh is split into spatial regions decimated in parallel. Vertices
+	having triangles in several regions are frozen during this stage, then a single-threaded pass
+	continues over the whole mesh (with the same quadrics) until the stopping condition is reached.
+*/
+class MeshDecimator {
+public:
+	/** \brief Decimates the mesh
+
+		Decimation stops when triangle count reaches the target or when the cheapest collapse
+		error exceeds the maximal error, whichever comes first.
+		\param[in] mesh Mesh to decimate, must be an indexed triangle mesh
+		\param[in] solver QEF solver prototype, each worker thread uses its own solver with the same configuration
+		\return Decimated mesh, unused vertices are removed
+	*/
+	Mesh decimate (const Mesh &mesh, const QefSolver3D &solver = QefSolver3D ()) const;
+
+	/// Triangle count to stop at, zero means no limit
+	size_t targetTriangleCount () const noexcept { return m_targetTriangles; }
+	void setTargetTriangleCount (size_t value) noexcept { m_targetTriangles = value; }
+	/** Maximal error of a single collapse (sum of squared distances to the original planes, in mesh
+	 local units). Infinity means no limit */
+	float maxError () const noexcept { return m_maxError; }
+	void setMaxError (float value) noexcept { m_maxError = glm::max (0.0f, value); }
+	/// Number of worker threads (one by default), zero means using all hardware threads
+	uint32_t threadCount () const noexcept { return m_threadCount; }
+	void setThreadCount (uint32_t value) noexcept { m_threadCount = value; }
+
+private:
+	size_t m_targetTriangles = 0;
+	float m_maxError = std::numeric_limits<float>::infinity ();
+	uint32_t m_threadCount = 1;
+};
+
+}
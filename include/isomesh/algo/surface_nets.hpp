@@ -0,0 +1,51 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+/** \file
+	\brief Naive surface nets algorithm, implemented over uniform grids
+*/
+#pragma once
+
+#include "../data/fixed_grid.hpp"
+#include "../data/grid.hpp"
+#include "../data/mesh.hpp"
+#include "../util/component_culling.hpp"
+
+namespace isomesh
+{
+
+/** \brief Naive surface nets isosurface algorithm
+
+	Builds the same mesh topology as \ref dualContouring, but places each dual vertex at the mean
+	of surface-crossing points on its cell edges instead of solving QEF. This is much cheaper, but
+	sharp features are smoothed out, so it suits smooth terrain and distant levels of detail.
+
+	Optional smoothing iterations move each vertex halfway towards the mean of vertices in
+	face-adjacent cells, keeping it inside its own cell.
+	\param[in] G Grid to build surface from
+	\param[in] smoothingIterations Number of smoothing iterations, zero disables smoothing
+	\param[in] culling Small components culling options, disabled by default
+*/
+Mesh surfaceNets (const UniformGrid &G, uint32_t smoothingIterations = 0,
+                  const ComponentCulling &culling = ComponentCulling ());
+
+/** \brief Naive surface nets over a grid of fixed size
+
+	Builds exactly the same mesh as the generic version, but uses compile-time indexing of the grid.
+	Specialized code is compiled for sizes 16, 32 and 64, other sizes fall back to the generic version.
+*/
+template<uint32_t N>
+Mesh surfaceNets (const FixedUniformGrid<N> &G, uint32_t smoothingIterations = 0,
+                  const ComponentCulling &culling = ComponentCulling ()) {
+	return surfaceNets (static_cast<const UniformGrid &> (G), smoothingIterations, culling);
+}
+
+/// @cond
+template<>
+Mesh surfaceNets<16> (const FixedUniformGrid<16> &G, uint32_t smoothingIterations, const ComponentCulling &culling);
+template<>
+Mesh surfaceNets<32> (const FixedUniformGrid<32> &G, uint32_t smoothingIterations, const ComponentCulling &culling);
+template<>
+Mesh surfaceNets<64> (const FixedUniformGrid<64> &G, uint32_t smoothingIterations, const ComponentCulling &culling);
+/// @endcond
+
+}
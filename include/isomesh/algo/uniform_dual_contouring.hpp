@@ -5,9 +5,11 @@
 */
 #pragma once
 
+#include "../data/fixed_grid.hpp"
 #include "../data/grid.hpp"
 #include "../data/mesh.hpp"
 #include "../qef/qef_solver_3d.hpp"
+#include "../util/component_culling.hpp"
 
 namespace isomesh
 {
@@ -15,7 +17,31 @@ namespace isomesh
 /** \brief Dual contouring isosurface algorithm
 
 	TBD
+	\param[in] G Grid to build surface from
+	\param[in] solver QEF solver used to place dual vertices
+	\param[in] culling Small components culling options, disabled by default
 */
-Mesh dualContouring (const UniformGrid &G, QefSolver3D &solver);
+Mesh dualContouring (const UniformGrid &G, QefSolver3D &solver,
+                     const ComponentCulling &culling = ComponentCulling ());
+
+/** \brief Dual contouring over a grid of fixed size
+
+	Builds exactly the same mesh as the generic version, but uses compile-time indexing of the grid.
+	Specialized code is compiled for sizes 16, 32 and 64, other sizes fall back to the generic version.
+*/
+template<uint32_t N>
+Mesh dualContouring (const FixedUniformGrid<N> &G, QefSolver3D &solver,
+                     const ComponentCulling &culling = ComponentCulling ()) {
+	return dualContouring (static_cast<const UniformGrid &> (G), solver, culling);
+}
+
+/// @cond
+template<>
+Mesh dualContouring<16> (const FixedUniformGrid<16> &G, QefSolver3D &solver, const ComponentCulling &culling);
+template<>
+Mesh dualContouring<32> (const FixedUniformGrid<32> &G, QefSolver3D &solver, const ComponentCulling &culling);
+template<>
+Mesh dualContouring<64> (const FixedUniformGrid<64> &G, QefSolver3D &solver, const ComponentCulling &culling);
+/// @endcond
 
 }
@@ -0,0 +1,95 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+/** \file
+	\brief Sparse set of uniform grid chunks meshed without seams
+*/
+#pragma once
+
+#include "../common.hpp"
+#include "../field/scalar_field.hpp"
+#include "../qef/qef_solver_3d.hpp"
+#include "../util/zero_finder.hpp"
+#include "grid.hpp"
+#include "mesh.hpp"
+
+#include <memory>
+#include <unordered_map>
+
+namespace isomesh
+{
+
+/** \brief Chunked world made of uniform grids
+
+	The world is an infinite lattice of chunks, each of them is a UniformGrid of the same size.
+	Chunk with key K covers grid points from K * size to (K + 1) * size (in units of grid step,
+	relative to world origin), so neighbouring chunks share one layer of grid points. Only chunks
+	explicitly filled are stored.
+
+	Chunks are meshed with dual contouring. A chunk owns every edge whose lesser endpoint
+	lies in [K * size; (K + 1) * size) along the edge direction and in (K * size; (K + 1) * size]
+	along two other axes, so every edge of the world is owned by exactly one chunk. Quads of
+	owned edges on the positive chunk borders need dual vertices of cells from neighbouring
+	chunks (a one-cell halo). These vertices are computed from neighbour grids in exactly the same
+	way as neighbours compute them for their own meshes, so chunk meshes join watertight. Meshing a
+	chunk only reads its neighbours, they don't need to be refilled or remeshed.
+*/
+class ChunkManager {
+public:
+	/** \brief Creates empty world
+
+		\param[in] chunkSize Size of chunk grids, requirements are the same as for UniformGrid size
+		\param[in] gridStep Distance between neighbouring grid points
+		\param[in] origin Global position of the lowest corner of chunk with key (0, 0, 0)
+	*/
+	explicit ChunkManager (uint32_t chunkSize, double gridStep = 1.0, const glm::dvec3 &origin = glm::dvec3 (0));
+
+	/** \brief Creates a chunk (or replaces existing one) and fills it with data
+
+		\param[in] key Chunk position in the chunk lattice
+		\param[in] field Scalar field to sample data from
+		\param[in] zeroFinder Solver to find zeros along grid edges
+		\return Filled chunk grid
+	*/
+	const UniformGrid &fillChunk (const glm::ivec3 &key, const ScalarField &field, const ZeroFinder &zeroFinder);
+	/// Removes a chunk, does nothing if there is no such chunk
+	void removeChunk (const glm::ivec3 &key) noexcept;
+	/// Returns chunk grid or nullptr if there is no such chunk
+	const UniformGrid *chunk (const glm::ivec3 &key) const noexcept;
+	/// Returns the number of stored chunks
+	size_t chunkCount () const noexcept { return m_chunks.size (); }
+
+	/** \brief Builds mesh of a chunk with seam geometry towards its neighbours
+
+		Seams are generated only towards existing neighbours in positive directions (chunks with
+		keys K + (1, 0, 0), K + (0, 1, 0), ..., K + (1, 1, 1)). Mesh is built in chunk local space.
+		\param[in] key Chunk to build the mesh of
+		\param[in] solver QEF solver used to place dual vertices
+		\return Chunk mesh
+		\throw std::invalid_argument if there is no such chunk
+	*/
+	Mesh meshChunk (const glm::ivec3 &key, QefSolver3D &solver) const;
+
+	uint32_t chunkSize () const noexcept { return m_chunkSize; }
+	double gridStep () const noexcept { return m_gridStep; }
+	glm::dvec3 origin () const noexcept { return m_origin; }
+	/// Returns global position of chunk center (i.e. UniformGrid global position)
+	glm::dvec3 chunkPosition (const glm::ivec3 &key) const noexcept {
+		return m_origin + (glm::dvec3 (key) * double (m_chunkSize) + double (m_chunkSize / 2)) * m_gridStep;
+	}
+
+private:
+	struct KeyHash {
+		size_t operator () (const glm::ivec3 &key) const noexcept {
+			return std::hash<uint64_t> () (uint64_t (uint32_t (key.x)) * 73856093u ^
+			                               uint64_t (uint32_t (key.y)) * 19349663u ^
+			                               uint64_t (uint32_t (key.z)) * 83492791u);
+		}
+	};
+
+	const uint32_t m_chunkSize;
+	const double m_gridStep;
+	const glm::dvec3 m_origin;
+	std::unordered_map<glm::ivec3, std::unique_ptr<UniformGrid>, KeyHash> m_chunks;
+};
+
+}
@@ -0,0 +1,87 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+/** \file
+	\brief Metadata index of surface components dumped to disk
+*/
+#pragma once
+
+#include "../common.hpp"
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace isomesh
+{
+
+/** \brief Metadata of one connected surface component
+
+	All coordinates are global. Oriented bounding box axes are found by principal component
+	analysis of component vertices, they are sorted by decreasing box extent.
+*/
+struct ComponentRecord {
+	/// Unique (within one index) component number
+	uint64_t id = 0;
+	uint64_t vertexCount = 0;
+	uint64_t triangleCount = 0;
+	/// Axis-aligned bounding box
+	glm::dvec3 aabbMin { 0 }, aabbMax { 0 };
+	/// Oriented bounding box center
+	glm::dvec3 obbCenter { 0 };
+	/// Oriented bounding box axes, orthonormal
+	glm::dvec3 obbAxes[3] = { glm::dvec3 (1, 0, 0), glm::dvec3 (0, 1, 0), glm::dvec3 (0, 0, 1) };
+	/// Oriented bounding box half-sizes along its axes
+	glm::dvec3 obbHalfExtents { 0 };
+	double area = 0;
+	/** Signed enclosed volume, computed using divergence theorem. It is exact only for
+	 watertight components, for ones cut by the domain border it is just an estimation. */
+	double volume = 0;
+	/// Whether every mesh edge is shared by exactly two triangles
+	bool watertight = false;
+};
+
+/** \brief Index of surface components stored in separate files
+
+	Index is a binary file containing a header and a sequence of \ref ComponentRecord entries.
+	Component meshes are stored next to it, see \ref meshFilename. Queries are answered from the
+	index only, without loading meshes themselves.
+*/
+class ComponentIndex {
+public:
+	ComponentIndex () = default;
+	/** \brief Loads the index from file
+
+		\param[in] filename Path to index file
+		\throw std::runtime_error if the file can't be read or has wrong format
+	*/
+	explicit ComponentIndex (const std::string &filename);
+
+	const std::vector<ComponentRecord> &records () const noexcept { return m_records; }
+	/// Returns path to PLY file with mesh of a given component
+	std::string meshFilename (const ComponentRecord &record) const;
+	/// Returns path to PLY file with mesh of a component with a given id
+	static std::string meshFilename (const std::string &indexFilename, uint64_t id);
+
+	/// Selects components having at least \p minTriangles triangles (i.e. removes small ones)
+	std::vector<ComponentRecord> withMinTriangles (uint64_t minTriangles) const;
+	/// Selects components enclosing volume of at least \p minVolume (by absolute value)
+	std::vector<ComponentRecord> withMinVolume (double minVolume) const;
+	/** \brief Selects components oriented along a given direction
+
+		Component orientation is defined by the major axis of its oriented bounding box.
+		\param[in] direction Direction to compare with, needs not to be normalized
+		\param[in] maxAngle Maximal angle (in radians) between major axis and \p direction line
+	*/
+	std::vector<ComponentRecord> alignedWith (const glm::dvec3 &direction, double maxAngle) const;
+
+	/// Writes index file header, used for streaming index output
+	static void writeHeader (std::ostream &stream);
+	/// Writes one index record, used for streaming index output
+	static void writeRecord (std::ostream &stream, const ComponentRecord &record);
+
+private:
+	std::string m_filename;
+	std::vector<ComponentRecord> m_records;
+};
+
+}
@@ -0,0 +1,60 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+/** \file
+	\brief Compact in-memory representation of filled uniform grids
+*/
+#pragma once
+
+#include "../common.hpp"
+#include "grid.hpp"
+
+#include <vector>
+
+namespace isomesh
+{
+
+/** \brief Compressed copy of a filled UniformGrid
+
+	Meant for keeping lots of filled grids in memory (for example, recently edited chunks which
+	may need remeshing soon). Materials are run-length encoded in storage order. Edges are stored
+	sorted, each one as a varint delta of its lesser endpoint index followed by quantized offset
+	(16 bits) and octahedral-encoded normal (two 16 bit components), edge material is restored
+	from grid materials. Edges take 7 bytes instead of 20, and materials usually shrink by an order
+	of magnitude, so a typical grid takes about 5 times less memory than UniformGrid.
+
+	Materials, edge positions and endpoint information are restored exactly, while surface points
+	get errors up to about 1e-5 grid units and normals deviate by less than 1e-3.
+*/
+class CompressedGrid {
+public:
+	/// Compresses a filled grid
+	explicit CompressedGrid (const UniformGrid &grid);
+
+	/** \brief Restores the grid
+
+		The grid gets the same size, position, step and layout as the compressed one, surface cells
+		list is rebuilt if it was tracked.
+	*/
+	UniformGrid decompress () const;
+	/// Returns approximate number of bytes occupied by this object
+	size_t memoryUsage () const noexcept;
+
+	uint32_t gridSize () const noexcept { return m_size; }
+	glm::dvec3 globalPosition () const noexcept { return m_globalPos; }
+	double gridStep () const noexcept { return m_gridStep; }
+
+private:
+	uint32_t m_size;
+	UniformGridLayout m_layout;
+	bool m_trackSurfaceCells;
+	glm::dvec3 m_globalPos;
+	double m_gridStep;
+	/// Runs of materials, each one is a material byte followed by varint run length
+	std::vector<uint8_t> m_materials;
+	/// Number of X, Y and Z edges
+	uint32_t m_edgeCount[3];
+	/// Encoded edges of all three storages
+	std::vector<uint8_t> m_edges;
+};
+
+}
@@ -8,7 +8,11 @@
 #include "../common.hpp"
 #include "../data/mesh.hpp"
 #include "../data/grid.hpp"
+#include "../field/scalar_field.hpp"
 #include "../qef/qef_solver_3d.hpp"
+#include "../util/component_culling.hpp"
+#include "../util/job_control.hpp"
+#include "../util/zero_finder.hpp"
 #include "dc_octree_node.hpp"
 
 namespace isomesh 
@@ -19,9 +23,45 @@ class DC_Octree {
 public:
 	explicit DC_Octree (int32_t root_size, glm::dvec3 global_pos = glm::dvec3 (0), double global_scale = 1);
 
+	/** \brief Builds octree from grid data
+
+		\param[in] control Optional cancellation token and progress tracker, cancellation is checked
+		before building every subtree. Octree is left empty after cancellation
+		\throw JobCancelled if the job was cancelled
+	*/
 	void build (const UniformGrid &G, QefSolver3D &solver, float epsilon,
-	            bool use_octree_simplification = true);
-	Mesh contour ();
+	            bool use_octree_simplification = true, JobControl *control = nullptr);
+	/** \brief Builds octree by sampling the field directly, without a uniform grid
+
+		Nodes are subdivided only while they may contain surface, so the field is sampled densely
+		only near the surface, and Hermite data is computed only for edges of leaf cells. A node is
+		skipped if the Lipschitz bound proves there is no surface inside it. When the bound is
+		unknown, a node not larger than 1/8 of the root is skipped if all points on its boundary have
+		the same sign, so surface components hidden inside such node are lost.
+		If nothing is skipped, the result is the same as of building from a grid filled with the
+		same field (grid size equal to root size, grid step and position equal to octree ones).
+		\param[in] field Scalar field to sample data from
+		\param[in] zeroFinder Solver to find zeros along cell edges
+		\param[in] lipschitz Lipschitz constant of the field (upper bound of its gradient length),
+		zero or negative if unknown. Distance fields have constant 1
+		\param[in] control Optional cancellation token and progress tracker
+		\throw JobCancelled if the job was cancelled
+	*/
+	void build (const ScalarField &field, const ZeroFinder &zeroFinder, QefSolver3D &solver, float epsilon,
+	            double lipschitz = 0, bool use_octree_simplification = true, JobControl *control = nullptr);
+	/** \brief Rebuilds the part of octree affected by grid changes
+
+		Call it after UniformGrid::refill with the same dirty box. Only leaves of cells touching the
+		box and their ancestors are rebuilt (and simplified again), other subtrees are kept as is.
+		The result is the same as of full \ref build with the same parameters.
+		\param[in] control Optional cancellation token and progress tracker, progress counts only
+		rebuilt subtrees. Octree is left empty after cancellation
+		\throw JobCancelled if the job was cancelled
+	*/
+	void update (const UniformGrid &G, QefSolver3D &solver, float epsilon,
+	             const glm::ivec3 &minPoint, const glm::ivec3 &maxPoint,
+	             bool use_octree_simplification = true, JobControl *control = nullptr);
+	Mesh contour (const ComponentCulling &culling = ComponentCulling ());
 
 	// Mappings between local and global coordinate spaces
 	glm::dvec3 localToGlobal (const glm::dvec3 &L) const noexcept { return L * m_globalScale + m_globalPos; }
@@ -33,19 +73,35 @@ private:
 
 	DC_OctreeNode m_root;
 
+	// Lazily sampled field data for building without a grid
+	class FieldSampler;
+
 	struct BuildArgs {
-		const UniformGrid &grid;
+		// Exactly one of data sources is set
+		const UniformGrid *grid;
+		FieldSampler *sampler;
 		QefSolver3D &solver;
 		float epsilon;
 		bool use_octree_simplification;
+		JobControl *control;
 	};
 
 	using CubeMaterials = std::array<std::array<std::array<Material, 3>, 3>, 3>;
 
 	void buildNode (DC_OctreeNode *node, glm::ivec3 min_corner, int32_t size, BuildArgs &args);
 	void buildLeaf (DC_OctreeNode *node, glm::ivec3 min_corner, int32_t size, BuildArgs &args);
-	// Implements topological safety test from Dual Contouring paper
-	static bool checkTopoSafety (const CubeMaterials &mats) noexcept;
+	void updateNode (DC_OctreeNode *node, glm::ivec3 min_corner, int32_t size, BuildArgs &args,
+	                 const glm::ivec3 &cell_min, const glm::ivec3 &cell_max);
+	// Returns volume of subtrees rebuilt by updateNode
+	static uint64_t updateWork (const DC_OctreeNode *node, glm::ivec3 min_corner, int32_t size,
+	                            const glm::ivec3 &cell_min, const glm::ivec3 &cell_max) noexcept;
+	// Tries to collapse a node whose children are built
+	void simplifyNode (DC_OctreeNode *node, glm::ivec3 min_corner, int32_t size, BuildArgs &args);
+	/* Implements topological safety test from Dual Contouring paper. Signs of 3x3x3 points of
+	 the node are packed in a 27-bit mask, bit (y * 9 + x * 3 + z) is set for solid points. */
+	static bool checkTopoSafety (uint32_t signs) noexcept;
+	// Extra midpoint tests comparing materials, needed only for nodes with several solid materials
+	static bool checkMaterialMidpoints (const CubeMaterials &mats) noexcept;
 };
 
 }
@@ -9,6 +9,8 @@
 #include "../data/mesh.hpp"
 #include "../field/scalar_field.hpp"
 #include "../qef/qef_solver_4d.hpp"
+#include "../util/component_culling.hpp"
+#include "../util/job_control.hpp"
 #include "dmc_octree_node.hpp"
 
 #include <random>
@@ -21,10 +23,37 @@ class DMC_Octree {
 public:
 	explicit DMC_Octree (int32_t root_size, glm::dvec3 global_pos = glm::dvec3 (0), double global_scale = 1);
 	
+	/** \brief Builds octree by sampling the field
+
+		\param[in] control Optional cancellation token and progress tracker, cancellation is checked
+		before building every subtree. Octree is left empty after cancellation
+		\throw JobCancelled if the job was cancelled
+	*/
 	void build (const ScalarField &field, QefSolver4D &solver, float epsilon,
 	            bool use_simple_split_policy = false, bool use_random_sampling = true,
-	            bool use_early_split_stop = false, uint32_t seed = 0xDEADBEEF);
-	Mesh contour () const;
+	            bool use_early_split_stop = false, uint32_t seed = 0xDEADBEEF,
+	            JobControl *control = nullptr);
+	Mesh contour (const ComponentCulling &culling = ComponentCulling ()) const;
+
+	/** \brief Whether random sampling takes points from Halton sequence
+
+		Points of a node are taken from Halton sequence (bases 2, 3 and 5) shifted by a random
+		offset, which covers the node much more evenly than independent uniform samples do, so
+		fewer samples are needed for the same QEF quality. Has no effect without random sampling.
+		Disabled by default.
+	*/
+	void useLowDiscrepancySampling (bool value) noexcept { m_lowDiscrepancySampling = value; }
+	bool lowDiscrepancySamplingUsed () const noexcept { return m_lowDiscrepancySampling; }
+	/** \brief Whether random sampling adds samples only while needed
+
+		Node sampling starts with a few points and doubles their count (up to the usual
+		6 * sqrt (size)) only while QEF error is close to epsilon. QEF error can only grow
+		when samples are added, so nodes already exceeding epsilon are rejected right away,
+		and nodes with error extrapolated to the full sample count well below epsilon
+		are accepted early. Has no effect without random sampling. Disabled by default.
+	*/
+	void useAdaptiveSampling (bool value) noexcept { m_adaptiveSampling = value; }
+	bool adaptiveSamplingUsed () const noexcept { return m_adaptiveSampling; }
 
 	// Mappings between local and global coordinate spaces
 	glm::dvec3 localToGlobal (const glm::dvec3 &L) const noexcept { return L * m_globalScale + m_globalPos; }
@@ -35,6 +64,8 @@ private:
 	const int32_t m_rootSize;
 	
 	DMC_OctreeNode m_root;
+	bool m_lowDiscrepancySampling = false;
+	bool m_adaptiveSampling = false;
 
 	struct BuildArgs {
 		const ScalarField &field;
@@ -44,6 +75,7 @@ private:
 		bool use_random_sampling;
 		bool use_early_split_stop;
 		std::mt19937 rng;
+		JobControl *control;
 	};
 
 	void buildNode (DMC_OctreeNode *node, glm::ivec3 min_corner, int32_t size, BuildArgs &args);
@@ -0,0 +1,111 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+/** \file
+	\brief Uniform grid with size known at compile time
+*/
+#pragma once
+
+#include "grid.hpp"
+
+#include <cassert>
+
+namespace isomesh
+{
+
+/** \brief Uniform grid of a fixed size
+
+	Stores exactly the same data in the same layout as UniformGrid of size N (so it can be passed
+	anywhere UniformGrid is expected), but indexing functions are redefined with compile-time
+	strides. Index computations then compile to shifts and additions, divisions in \ref indexToPoint
+	become multiplications, and neighbour offsets are constants. Extraction algorithms having
+	overloads for fixed grids (\ref marchingCubes, \ref dualContouring and \ref surfaceNets) use
+	these functions in their inner loops.
+
+	Note that the functions hide UniformGrid ones rather than override them, code working with
+	a reference to UniformGrid uses generic versions. Fixed grids always use linear layout.
+	\tparam N Grid size, the same requirements as for UniformGrid size apply
+*/
+template<uint32_t N>
+class FixedUniformGrid : public UniformGrid {
+	static_assert (N >= 2 && N <= 1024 && (N & (N - 1)) == 0, "Grid size must be a power of two in range [2; 1024]");
+public:
+	static constexpr uint32_t kSize = N;
+	static constexpr int32_t kHalfSize = int32_t (N / 2);
+	/// Differences between indices of neighbouring points along X, Y and Z axes
+	static constexpr uint32_t kStride[3] = { N + 1, (N + 1) * (N + 1), 1 };
+
+	explicit FixedUniformGrid (const glm::dvec3 &globalPos = glm::dvec3 (0.0), double gridStep = 1.0) :
+		UniformGrid (N, globalPos, gridStep) {}
+
+	constexpr uint32_t dataSize () const noexcept { return (N + 1) * (N + 1) * (N + 1); }
+	constexpr uint32_t gridSize () const noexcept { return N; }
+	constexpr int32_t maxCoord () const noexcept { return kHalfSize; }
+	constexpr int32_t minCoord () const noexcept { return -kHalfSize; }
+
+	uint32_t pointToIndex (int32_t x, int32_t y, int32_t z) const noexcept {
+		assert (isVertexInGrid (x, y, z));
+		return uint32_t (y + kHalfSize) * kStride[1] + uint32_t (x + kHalfSize) * kStride[0] + uint32_t (z + kHalfSize);
+	}
+	uint32_t pointToIndex (const glm::ivec3 &p) const noexcept { return pointToIndex (p.x, p.y, p.z); }
+	glm::ivec3 indexToPoint (uint32_t idx) const noexcept {
+		assert (idx < dataSize ());
+		int32_t z = int32_t (idx % (N + 1)) - kHalfSize;
+		int32_t x = int32_t (idx / (N + 1) % (N + 1)) - kHalfSize;
+		int32_t y = int32_t (idx / kStride[1]) - kHalfSize;
+		return glm::ivec3 (x, y, z);
+	}
+
+	bool isCellInGrid (const glm::ivec3 &cellPos) const noexcept {
+		// Casting shifted coordinates to unsigned checks both bounds at once
+		return uint32_t (cellPos.x + kHalfSize) < N && uint32_t (cellPos.y + kHalfSize) < N &&
+		       uint32_t (cellPos.z + kHalfSize) < N;
+	}
+
+	// Returns indices of (up to four) cells adjacent to this edge, in the same order as UniformGrid does
+	template<int D>
+	std::array<uint32_t, 4> adjacentCellsForEdge (const glm::ivec3 &edgePos) const noexcept {
+		static_assert (D >= 0 && D <= 2, "Wrong edge direction");
+		// Two other axes, taken in cyclic order
+		constexpr int U = (D + 1) % 3;
+		constexpr int V = (D + 2) % 3;
+		std::array<uint32_t, 4> cells;
+		cells[2] = pointToIndex (edgePos);
+		cells[0] = cells[2] - kStride[U] - kStride[V];
+		cells[1] = cells[2] - kStride[V];
+		cells[3] = cells[2] - kStride[U];
+		if (edgePos[U] == -kHalfSize)
+			cells[0] = cells[3] = kBadIndex;
+		if (edgePos[U] == kHalfSize)
+			cells[1] = cells[2] = kBadIndex;
+		if (edgePos[V] == -kHalfSize)
+			cells[0] = cells[1] = kBadIndex;
+		if (edgePos[V] == kHalfSize)
+			cells[2] = cells[3] = kBadIndex;
+		return cells;
+	}
+
+	using UniformGrid::adjacentVerticesForCell;
+	using UniformGrid::materialsOfCell;
+	std::array<uint32_t, 8> adjacentVerticesForCell (uint32_t cellIdx) const noexcept {
+		std::array<uint32_t, 8> vertices;
+		for (int i = 0; i < 8; i++)
+			vertices[i] = cellIdx + kCornerOffset[i];
+		return vertices;
+	}
+	std::array<Material, 8> materialsOfCell (uint32_t cellIdx) const noexcept {
+		const Material *mat = data () + cellIdx;
+		std::array<Material, 8> mats;
+		for (int i = 0; i < 8; i++)
+			mats[i] = mat[kCornerOffset[i]];
+		return mats;
+	}
+
+private:
+	// Index offsets of cell corners, numbered as in \ref kCellCornerOffset
+	static constexpr uint32_t kCornerOffset[8] = {
+		0, kStride[2], kStride[0], kStride[0] + kStride[2],
+		kStride[1], kStride[1] + kStride[2], kStride[1] + kStride[0], kStride[1] + kStride[0] + kStride[2]
+	};
+};
+
+}
@@ -7,15 +7,70 @@
 
 #include "../common.hpp"
 #include "../field/scalar_field.hpp"
+#include "../util/job_control.hpp"
 #include "../util/zero_finder.hpp"
 #include "grid_edge_storage.hpp"
 
 #include <array>
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace isomesh
 {
 
+/** \brief Grid cell crossed by the surface
+
+	Lists surface-crossing edges of the cell with their positions in grid edge storages,
+	so algorithms don't need to search for them. Edges are numbered as in \ref kCellEdgeEndpoint.
+*/
+struct UniformGridSurfaceCell {
+	/// Cell index (index of its lowest corner, as returned by UniformGrid::pointToIndex)
+	uint32_t cellIndex;
+	/// Bit i is set if i-th edge of the cell crosses the surface
+	uint16_t edgeMask;
+	/** Index of i-th edge in the storage of its axis (UniformGrid::edges<kCellEdgeDirection[i]> ()),
+	 kBadIndex for edges not crossing the surface */
+	uint32_t edgeIndex[12];
+};
+
+/// Order of grid points in memory
+enum class UniformGridLayout {
+	/// Points are stored row by row in YXZ order
+	Linear,
+	/** Points are grouped into 4x4x4 bricks (64 materials, i.e. one cache line), bricks and points
+	 inside them are stored in YXZ order. Neighbouring points along any axis are usually close in
+	 memory, which makes octree builders visiting cells in Z-order much more cache friendly. Brick
+	 count is rounded up, so storage is padded (by about 30% for size 32 and 15% for size 64). */
+	Tiled
+};
+
+/** \brief Boundary plane of points shared by neighbouring grids
+
+	Grids of the same size and step placed next to each other share the plane of points between
+	them, i.e. the upper X face of one grid is the lower X face of its +X neighbour. The plane is
+	exported by \ref UniformGrid::fill and imported by the neighbour to skip sampling it again.
+	Points are stored row by row, rows go along the last of the two remaining axes in YXZ order:
+	(Y, Z) for X planes, (X, Z) for Y planes and (Y, X) for Z planes.
+*/
+struct UniformGridBoundary {
+	/// Axis orthogonal to the plane
+	int axis = 0;
+	/// Size of the grids sharing the plane
+	uint32_t size = 0;
+	/// Grid step of the grids sharing the plane
+	double step = 0.0;
+	/// Global position of the plane center, i.e. the point with zero local coordinates along plane axes
+	glm::dvec3 origin = glm::dvec3 (0.0);
+	/// Field values in plane points
+	std::vector<double> values;
+	/// Materials of plane points
+	std::vector<Material> materials;
+	/** Surface-crossing edges lying in the plane, indexed by edge axis (edges[axis] is empty).
+	 Lesser endpoint coordinates along the plane axis are zero, edges are sorted */
+	std::vector<UniformGridEdge> edges[3];
+};
+
 // YXZ traversal order (to match Voxen's layout)
 // Local coordinates are [-size/2; size/2]
 // Global coordinates define point position in the world
@@ -28,21 +83,96 @@ namespace isomesh
  computer runs out of RAM and begins using swapfile). */
 class UniformGrid {
 public:
-	explicit UniformGrid (uint32_t size, const glm::dvec3 &globalPos = glm::dvec3 (0.0), double gridStep = 1.0);
+	explicit UniformGrid (uint32_t size, const glm::dvec3 &globalPos = glm::dvec3 (0.0), double gridStep = 1.0,
+	                      UniformGridLayout layout = UniformGridLayout::Linear);
 	/** \brief Fills the grid using provided scalar field
 	
 		\param[in] field Scalar field to sample data from
 		\param[in] solver Solver to find zeros along grid edges
-		\param[in] material Material selector
+		\param[in] control Optional cancellation token and progress tracker, cancellation is
+		checked after every slab of points. Grid contents are unspecified after cancellation
+		\throw JobCancelled if the job was cancelled
+	*/
+	void fill (const ScalarField &field, const ZeroFinder &solver, JobControl *control = nullptr);
+	/** \brief Fills the grid reusing boundary planes of already filled neighbours
+
+		Field values, materials and in-plane edges of imported planes are copied instead of being
+		sampled again, so seams between neighbouring grids match exactly. Faces are numbered as
+		2 * axis for lower faces and 2 * axis + 1 for upper ones, e.g. the lower X face (number 0)
+		imports the plane exported from the upper X face (number 1) of the -X neighbour.
+		\param[in] field,solver,control Same as for the other overload
+		\param[in] imported Planes of neighbours for each face, nullptr for faces to be sampled
+		\param[out] exported Receive planes of this grid for each face, nullptr for unneeded faces
+		\throw std::invalid_argument if an imported plane has wrong axis, size, step, position or data length
+		\throw JobCancelled if the job was cancelled
+	*/
+	void fill (const ScalarField &field, const ZeroFinder &solver,
+	           const std::array<const UniformGridBoundary *, 6> &imported,
+	           const std::array<UniformGridBoundary *, 6> &exported, JobControl *control = nullptr);
+	/** \brief Resamples a box of grid points after the field has changed there
+
+		Only points inside the box get new materials, and only edges having at least one endpoint
+		inside the box are recomputed, the rest of the grid is left intact. Field values on points
+		just outside the box are sampled again too (they are not stored in the grid), so the field
+		must not change there. Box corners are clamped to the grid, the grid must be filled first.
+		\param[in] field Scalar field to sample data from
+		\param[in] solver Solver to find zeros along grid edges
+		\param[in] minPoint,maxPoint Dirty box corners (local coordinates, inclusive)
+	*/
+	void refill (const ScalarField &field, const ZeroFinder &solver,
+	             const glm::ivec3 &minPoint, const glm::ivec3 &maxPoint);
+	/** \brief Builds twice coarser grid covering the same region, for lower levels of detail
+
+		The result has half the size and twice the step, with the same position and layout. Its points
+		are the even points of this grid, so materials are copied, and every surface-crossing coarse
+		edge contains exactly one surface-crossing edge of this grid, whose crossing point and normal
+		are reused. Thus the field is not evaluated at all, and a whole LOD pyramid costs much less
+		than filling its finest level. Coarse edges crossed by the surface several times may get
+		another (still valid) crossing than \ref fill would find. The grid must be filled first.
+		\return Coarse grid, it tracks surface cells if this grid does
+		\throw std::invalid_argument if grid size is less than 4
+	*/
+	UniformGrid downsample () const;
+	/** \brief Saves filled grid to a binary file
+
+		The file stores everything needed to run algorithms on the grid (materials, edges, global
+		position, step and layout), so extraction can start from cached data with no field evaluations.
+		It is written with a single write. Data is stored in native binary representation, so the file
+		is meant as a local cache rather than an exchange format.
+		\param[in] path File path, existing file is overwritten
+		\throw std::runtime_error if the file can't be written
+	*/
+	void save (const std::string &path) const;
+	/** \brief Loads grid saved by \ref save
+
+		The whole file is read with a single read. Surface cells list is rebuilt if it was tracked.
+		\param[in] path File path
+		\return Loaded grid
+		\throw std::runtime_error if the file can't be read, is damaged or was saved on an incompatible platform
+	*/
+	static UniformGrid load (const std::string &path);
+	/** \brief Enables building the list of surface cells
+
+		With tracking enabled \ref fill and \ref refill produce the list of cells with
+		surface-crossing edges, which extraction algorithms use instead of grouping edges by cells
+		themselves. The list costs about 56 bytes per surface cell. Enabling tracking on a filled
+		grid builds the list right away, disabling it frees the list. Disabled by default.
 	*/
-	void fill (const ScalarField &field, const ZeroFinder &solver);
+	void trackSurfaceCells (bool value);
+	bool surfaceCellsTracked () const noexcept { return m_trackSurfaceCells; }
+	/// Returns surface cells sorted by cell indices, the list is empty when tracking is disabled
+	const std::vector<UniformGridSurfaceCell> &surfaceCells () const noexcept { return m_surfaceCells; }
+	/// Finds a surface cell by cell index, returns nullptr if there is none (or tracking is disabled)
+	const UniformGridSurfaceCell *findSurfaceCell (uint32_t cellIdx) const noexcept;
 	// Local-coordinates indexing
 	Material at (int32_t x, int32_t y, int32_t z) const;
 	Material operator [] (const glm::ivec3 &v) const;
-	// Raw indexing
+	// Raw indexing, use pointToIndex to find a point as the order depends on layout
 	const Material *data () const noexcept { return m_mat.get (); }
 	// Properties
-	uint32_t dataSize () const noexcept { return (m_size + 1) * (m_size + 1) * (m_size + 1); }
+	/// Returns the number of point indices, for tiled layout it includes padding (unused indices)
+	uint32_t dataSize () const noexcept { return m_dataSize; }
+	UniformGridLayout layout () const noexcept { return m_layout; }
 	uint32_t gridSize () const noexcept { return m_size; }
 	int32_t maxCoord () const noexcept { return m_halfSize; }
 	int32_t minCoord () const noexcept { return -m_halfSize; }
@@ -99,19 +229,40 @@ public:
 	bool isCellOnBorder (const glm::ivec3 &cellPos) const noexcept;
 	std::array<uint32_t, 8> adjacentVerticesForCell (uint32_t cellIdx) const noexcept;
 	std::array<Material, 8> materialsOfCell (uint32_t cellIdx) const noexcept;
+	// Same as above, but don't need to convert index back to position with tiled layout
+	std::array<uint32_t, 8> adjacentVerticesForCell (const glm::ivec3 &cellPos) const noexcept;
+	std::array<Material, 8> materialsOfCell (const glm::ivec3 &cellPos) const noexcept;
 	// Edge storages access
 	template<int D> const UniformGridEdgeStorage &edges () const noexcept;
 
 private:
 	const uint32_t m_size;
 	const int32_t m_halfSize;
+	const UniformGridLayout m_layout;
 
+	/* Point index is a sum of per-axis offsets (both layouts are separable), so indexing
+	 is layout-agnostic. Offsets are indexed by coordinate + m_halfSize */
+	std::vector<uint32_t> m_axisOffset[3];
+	uint32_t m_dataSize;
 	std::unique_ptr<Material[]> m_mat;
 	
 	UniformGridEdgeStorage m_edgeX, m_edgeY, m_edgeZ;
 
+	bool m_trackSurfaceCells = false;
+	std::vector<UniformGridSurfaceCell> m_surfaceCells;
+
 	glm::dvec3 m_globalPos;
 	double m_gridStep;
+
+	void buildSurfaceCells ();
+	// Rebuilds surface cells inside the box after edges with Y in [minCell.y, maxCell.y + 1] were replaced
+	void updateSurfaceCells (const glm::ivec3 &minCell, const glm::ivec3 &maxCell, const size_t oldEdgeCount[3]);
+	// Returns index difference between point with given coordinate along axis and its lesser neighbour
+	uint32_t backwardStep (int axis, int32_t coord) const noexcept {
+		return coord > -m_halfSize ? m_axisOffset[axis][coord + m_halfSize] - m_axisOffset[axis][coord + m_halfSize - 1] : 0;
+	}
+
+	friend class CompressedGrid;
 };
 
 template<>
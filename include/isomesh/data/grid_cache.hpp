@@ -0,0 +1,98 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+/** \file
+	\brief Memory-bounded cache of compressed uniform grids
+*/
+#pragma once
+
+#include "../common.hpp"
+#include "compressed_grid.hpp"
+#include "grid.hpp"
+
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+namespace isomesh
+{
+
+/// Grid cache usage statistics
+struct GridCacheStats {
+	/// Number of successful lookups
+	uint64_t hits = 0;
+	/// Number of lookups of grids not present in the cache
+	uint64_t misses = 0;
+	/// Number of grids dropped to fit into memory budget
+	uint64_t evictions = 0;
+};
+
+/** \brief Least recently used cache of filled grids
+
+	Grids are stored compressed (see CompressedGrid) under chunk keys, in the same key space as
+	used by ChunkManager. When total memory used by stored grids exceeds the budget, least recently
+	used (stored or retrieved) grids are evicted. The cache is not thread-safe.
+*/
+class GridCache {
+public:
+	/** \brief Creates empty cache
+
+		\param[in] memoryBudget Maximal number of bytes occupied by stored grids
+	*/
+	explicit GridCache (size_t memoryBudget) noexcept : m_budget (memoryBudget) {}
+
+	/** \brief Compresses and stores a grid, replacing existing grid with the same key
+
+		\param[in] key Chunk key
+		\param[in] grid Filled grid to store
+		\return false if the grid alone doesn't fit into memory budget (it is not stored then)
+	*/
+	bool put (const glm::ivec3 &key, const UniformGrid &grid);
+	/** \brief Restores a stored grid
+
+		\param[in] key Chunk key
+		\return Decompressed grid or nullptr if there is no such grid
+	*/
+	std::unique_ptr<UniformGrid> get (const glm::ivec3 &key);
+	/// Returns whether a grid with given key is stored, doesn't affect statistics and LRU order
+	bool contains (const glm::ivec3 &key) const noexcept { return m_index.count (key) != 0; }
+	/// Removes a grid, does nothing if there is no such grid
+	void remove (const glm::ivec3 &key) noexcept;
+	/// Removes all grids, statistics are kept
+	void clear () noexcept;
+
+	/// Returns the number of stored grids
+	size_t size () const noexcept { return m_entries.size (); }
+	/// Returns the number of bytes occupied by stored grids
+	size_t memoryUsage () const noexcept { return m_usage; }
+	size_t memoryBudget () const noexcept { return m_budget; }
+	/// Changes memory budget, evicting grids if needed
+	void setMemoryBudget (size_t memoryBudget) noexcept;
+
+	const GridCacheStats &stats () const noexcept { return m_stats; }
+	void resetStats () noexcept { m_stats = GridCacheStats (); }
+
+private:
+	struct KeyHash {
+		size_t operator () (const glm::ivec3 &key) const noexcept {
+			return std::hash<uint64_t> () (uint64_t (uint32_t (key.x)) * 73856093u ^
+			                               uint64_t (uint32_t (key.y)) * 19349663u ^
+			                               uint64_t (uint32_t (key.z)) * 83492791u);
+		}
+	};
+	struct Entry {
+		glm::ivec3 key;
+		CompressedGrid grid;
+	};
+	using EntryList = std::list<Entry>;
+
+	void evict (size_t budget) noexcept;
+
+	size_t m_budget;
+	size_t m_usage = 0;
+	GridCacheStats m_stats;
+	/// Most recently used entries go first
+	EntryList m_entries;
+	std::unordered_map<glm::ivec3, EntryList::iterator, KeyHash> m_index;
+};
+
+}
@@ -47,8 +47,12 @@ struct UniformGridEdge {
 	glm::ivec3 lesserEndpoint () const noexcept;
 	/// Returns local coordinates of the bigger endpoint
 	glm::ivec3 biggerEndpoint () const noexcept;
+	/// Returns edge axis in GLM order (X=0, Y=1, Z=2)
+	int edgeAxis () const noexcept { return axis; }
 	/// Returns true if the lesser endpoint is solid, false otherwise
 	bool isLesserEndpointSolid () const noexcept { return solidEndpoint == 0; }
+	/// Returns the same edge moved by integer offset (in local coordinates)
+	UniformGridEdge translated (const glm::ivec3 &delta) const noexcept;
 
 private:
 	/** \brief Surface normal in zero-crossing point.
@@ -91,6 +95,23 @@ public:
 	*/
 	void sortEdges () noexcept;
 	void clear () noexcept { m_edges.clear (); }
+	/** \brief Replaces edges with lesser endpoints inside a box
+
+		Removes all edges with lesser endpoints in [minPoint; maxPoint] (inclusive) and inserts
+		given edges instead. Only the range of edges with Y coordinate in [minPoint.y; maxPoint.y]
+		is touched, the rest of the storage is just moved.
+		\param[in] minPoint,maxPoint Box corners (local coordinates)
+		\param[in] edges Edges to insert, they must lie inside the box
+		\attention Both stored and inserted edges must be sorted
+	*/
+	void replaceEdges (const glm::ivec3 &minPoint, const glm::ivec3 &maxPoint,
+	                   const std::vector<UniformGridEdge> &edges);
+	/** \brief Replaces all stored edges with a raw array of edges
+
+		\param[in] edges,count Edges to store
+		\throw std::invalid_argument if edges are not sorted
+	*/
+	void assign (const UniformGridEdge *edges, size_type count);
 	iterator begin () noexcept { return m_edges.begin (); }
 	iterator end () noexcept { return m_edges.end (); }
 	/** \brief Finds an edge with given lesser endpoint coordinates
@@ -102,6 +123,10 @@ public:
 	iterator findEdge (int32_t x, int32_t y, int32_t z) noexcept;
 	/// Returns the number of edges in storage
 	size_type size () const noexcept { return m_edges.size (); }
+	/// Returns pointer to the contiguous array of stored edges
+	const UniformGridEdge *data () const noexcept { return m_edges.data (); }
+	/// Returns edge by its position in storage
+	const UniformGridEdge &operator [] (size_type index) const noexcept { return m_edges[index]; }
 	const_iterator begin () const noexcept { return m_edges.begin (); }
 	const_iterator end () const noexcept { return m_edges.end (); }
 	const_iterator cbegin () const noexcept { return m_edges.cbegin (); }
@@ -9,6 +9,8 @@
 #include "../data/mesh.hpp"
 #include "../data/grid.hpp"
 #include "../qef/qef_solver_3d.hpp"
+#include "../util/component_culling.hpp"
+#include "../util/job_control.hpp"
 #include "mdc_octree_node.hpp"
 
 namespace isomesh
@@ -19,8 +21,21 @@ class MDC_Octree {
 public:
 	explicit MDC_Octree (int32_t root_size, glm::dvec3 global_pos = glm::dvec3 (0), double global_scale = 1);
 	
-	void build (const UniformGrid &G, QefSolver3D &solver);
-	Mesh contour (float epsilon);
+	/** \brief Builds octree from grid data
+
+		\param[in] control Optional cancellation token and progress tracker, cancellation is checked
+		before building every subtree. Octree is left empty after cancellation
+		\throw JobCancelled if the job was cancelled
+	*/
+	void build (const UniformGrid &G, QefSolver3D &solver, JobControl *control = nullptr);
+	Mesh contour (float epsilon, const ComponentCulling &culling = ComponentCulling ());
+
+	/** \brief Number of threads used for vertex clustering (one by default), zero means using all hardware threads
+
+		Nodes of the same depth are clustered concurrently, the result does not depend on thread count.
+	*/
+	uint32_t threadCount () const noexcept { return m_threadCount; }
+	void setThreadCount (uint32_t value) noexcept { m_threadCount = value; }
 	
 	// Mappings between local and global coordinate spaces
 	glm::dvec3 localToGlobal (const glm::dvec3 &L) const noexcept { return L * m_globalScale + m_globalPos; }
@@ -31,10 +46,14 @@ private:
 	const int32_t m_rootSize;
 
 	MDC_OctreeNode m_root;
+	uint32_t m_threadCount = 1;
 	
 	struct BuildArgs {
 		const UniformGrid &grid;
 		QefSolver3D &solver;
+		JobControl *control;
+		// Leaf cells have up to four vertices, their solvers are reused for all leaves
+		QefSolver3D leafSolvers[4];
 	};
 
 	void buildNode (MDC_OctreeNode *node, glm::ivec3 min_corner, int32_t size, BuildArgs &args);
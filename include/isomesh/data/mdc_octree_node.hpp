@@ -20,6 +20,8 @@ struct MDC_Vertex {
 	bool m_collapsible = true;
 	float m_error = -1.0f;
 	MDC_Vertex *m_parent = nullptr;
+	/// Highest collapsible vertex among this one and its ancestors, computed by contouring
+	MDC_Vertex *m_representative = nullptr;
 	uint32_t m_vertexIdx = kBadIndex;
 	uint32_t m_surfaceIdx = kBadIndex;
 	QefSolver3D::State m_qef;
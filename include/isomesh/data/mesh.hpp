@@ -65,6 +65,12 @@ public:
 	*/
 	void clear () noexcept;
 
+	/** \brief Removes vertices not referenced by any triangle
+
+		Remaining vertices keep their relative order, indices are updated in place.
+	*/
+	void removeUnusedVertices ();
+
 	Vertex &operator [] (uint32_t index) { return m_vertices[index]; }
 	const Vertex &operator [] (uint32_t index) const { return m_vertices[index]; }
 
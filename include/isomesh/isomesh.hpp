@@ -18,11 +18,16 @@
 
 #include "common.hpp"
 
+#include "data/chunk_manager.hpp"
+#include "data/component_index.hpp"
+#include "data/compressed_grid.hpp"
 #include "data/grid.hpp"
+#include "data/grid_cache.hpp"
 #include "data/mdc_octree.hpp"
 #include "data/mesh.hpp"
 #include "data/dc_octree.hpp"
 #include "data/dmc_octree.hpp"
+#include "data/fixed_grid.hpp"
 
 #include "field/heightmap.hpp"
 #include "field/scalar_field.hpp"
@@ -30,8 +35,13 @@
 #include "qef/qef_solver_3d.hpp"
 #include "qef/qef_solver_4d.hpp"
 
+#include "util/component_culling.hpp"
+#include "util/job_control.hpp"
 #include "util/material_filter.hpp"
 #include "util/zero_finder.hpp"
 
+#include "algo/block_extractor.hpp"
 #include "algo/marching_cubes.hpp"
+#include "algo/mesh_decimator.hpp"
+#include "algo/surface_nets.hpp"
 #include "algo/uniform_dual_contouring.hpp"
@@ -20,8 +20,7 @@ public:
 		for storage in octree nodes. You may use this struct to merge QEF's
 		together or to initialize another solver.
 		\note Solver's tunable options, such as tolerance or maximal number
-		of iterations, are not preserved. You need to used some other way
-		if you plan to store these options externally.
+		of iterations, are not preserved. Use \ref Config to store them.
 	*/
 	struct State {
 		// Compressed matrix, only nonzero elements
@@ -37,8 +36,36 @@ public:
 		uint32_t dim : 2;
 	};
 
+	/** \brief Solver tunable options
+
+		Unlike \ref State, configuration is never changed by the solver, so one configuration
+		may be shared between threads to create identically tuned solvers.
+	*/
+	struct Config {
+		/// Singular values with absolute value less than tolerance will be truncated to zero
+		float pinvTolerance = 0.01f;
+		/// Stopping condition in Jacobi eigenvalue algorithm
+		float jacobiTolerance = 0.0025f;
+		/// Maximal number of Jacobi eigenvalue algorithm iterations
+		int maxJacobiIters = 15;
+		/// Whether to use more accurate or faster formulae in Jacobi eigenvalue algorithm
+		bool useFastFormulas = true;
+		/** \brief Whether to accumulate normal equations instead of QR-compressed matrix
+
+			By default added planes are kept as rows of (A b) matrix, which is compressed with
+			Householder QR decomposition whenever the row buffer fills up. In normal equations
+			mode solver accumulates the symmetric matrix (A b)^T (A b) in double precision,
+			so adding a plane or merging a state never needs a decomposition. This makes
+			repeated merging (e.g. in octree simplification) much cheaper at the cost of
+			squared condition number, which double precision is enough to compensate for
+			typical QEFs. \ref State is the same in both modes.
+		*/
+		bool useNormalEquations = false;
+	};
+
 	QefSolver3D () noexcept;
 	QefSolver3D (const State &data) noexcept;
+	explicit QefSolver3D (const Config &config) noexcept;
 	/** \brief Resets solver to its initial state
 	*/
 	void reset () noexcept;
@@ -78,15 +105,20 @@ public:
 	*/
 	glm::vec3 solve (glm::vec3 min_point, glm::vec3 max_point);
 	
-	float pinvTolerance () const noexcept { return m_pinvTolerance; }
-	float jacobiTolerance () const noexcept { return m_jacobiTolerance; }
-	int maxJacobiIters () const noexcept { return m_maxJacobiIters; }
-	bool fastFormulasUsed () const noexcept { return m_useFastFormulas; }
+	const Config &config () const noexcept { return m_config; }
+	float pinvTolerance () const noexcept { return m_config.pinvTolerance; }
+	float jacobiTolerance () const noexcept { return m_config.jacobiTolerance; }
+	int maxJacobiIters () const noexcept { return m_config.maxJacobiIters; }
+	bool fastFormulasUsed () const noexcept { return m_config.useFastFormulas; }
+	bool normalEquationsUsed () const noexcept { return m_config.useNormalEquations; }
 	
-	void setPinvTolerance (float value) noexcept { m_pinvTolerance = glm::max (0.0f, value); }
-	void setJacobiTolerance (float value) noexcept { m_jacobiTolerance = glm::max (0.0f, value); }
-	void setMaxJacobiIters (int value) noexcept { m_maxJacobiIters = glm::max (1, value); }
-	void useFastFormulas (bool value) noexcept { m_useFastFormulas = value; }
+	void setConfig (const Config &value) noexcept;
+	void setPinvTolerance (float value) noexcept { m_config.pinvTolerance = glm::max (0.0f, value); }
+	void setJacobiTolerance (float value) noexcept { m_config.jacobiTolerance = glm::max (0.0f, value); }
+	void setMaxJacobiIters (int value) noexcept { m_config.maxJacobiIters = glm::max (1, value); }
+	void useFastFormulas (bool value) noexcept { m_config.useFastFormulas = value; }
+	/// Switches data representation, already added data is converted and preserved
+	void useNormalEquations (bool value) noexcept;
 
 private:
 	/// Maximal number of used rows
@@ -96,6 +128,9 @@ private:
 	float A[4][kMaxRows];
 	/// Count of matrix rows occupied with useful data
 	int m_usedRows;
+	/** \brief Packed upper triangle of (A b)^T (A b), used in normal equations mode
+	*/
+	double m_normal[10];
 	/// Algebraic sum of points added to the solver
 	glm::vec3 m_pointsSum;
 	/// Count of points added to the solver
@@ -109,16 +144,12 @@ private:
 		pseudoinverse matrix).
 	*/
 	uint32_t m_featureDim;
-	/// Singular values with absolute value less than tolerance will be truncated to zero
-	float m_pinvTolerance = 0.01f;
-	/// Stopping condition in Jacobi eigenvalue algorithm
-	float m_jacobiTolerance = 0.0025f;
-	/// Maximal number of Jacobi eigenvalue algorithm iterations
-	int m_maxJacobiIters = 15;
-	/// Whether to use more accurate or faster formulae in Jacobi eigenvalue algorithm
-	bool m_useFastFormulas = true;
+	/// Tunable options
+	Config m_config;
 
 	void compressMatrix () noexcept;
+	void addNormalRow (const double row[4]) noexcept;
+	void normalToState (State &data) const noexcept;
 };
 
 }
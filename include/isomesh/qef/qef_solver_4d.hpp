@@ -20,8 +20,7 @@ public:
 		for storage in octree nodes. You may use this struct to merge QEF's
 		together or to initialize another solver.
 		\note Solver's tunable options, such as tolerance or maximal number
-		of iterations, are not preserved. You need to used some other way
-		if you plan to store these options externally.
+		of iterations, are not preserved. Use \ref Config to store them.
 	*/
 	struct State {
 		// Compressed matrix, only nonzero elements
@@ -38,8 +37,31 @@ public:
 		uint32_t dim : 3;
 	};
 
+	/** \brief Solver tunable options
+
+		Unlike \ref State, configuration is never changed by the solver, so one configuration
+		may be shared between threads to create identically tuned solvers.
+	*/
+	struct Config {
+		/// Singular values with absolute value less than tolerance will be truncated to zero
+		float pinvTolerance = 0.01f;
+		/// Stopping condition in Jacobi eigenvalue algorithm
+		float jacobiTolerance = 0.0025f;
+		/// Maximal number of Jacobi eigenvalue algorithm iterations
+		int maxJacobiIters = 20;
+		/// Whether to use more accurate or faster formulae in Jacobi eigenvalue algorithm
+		bool useFastFormulas = true;
+		/** \brief Whether to use SIMD (SSE2) kernel for matrix compression
+
+			Both kernels compute the same decomposition, up to rounding. Ignored when
+			the library is built for a target without SSE2.
+		*/
+		bool useSimd = true;
+	};
+
 	QefSolver4D () noexcept;
 	QefSolver4D (const State &data) noexcept;
+	explicit QefSolver4D (const Config &config) noexcept;
 	/** \brief Resets solver to initial state
 	*/
 	void reset () noexcept;
@@ -71,28 +93,50 @@ public:
 		the one closest to the 'mass point' (centroid of all points added using
 		\ref addPlane), making the problem always have a unique solution. This is not
 		mandatory though.
+
+		The decomposition is cached until the QEF or solver options change, so solving
+		the same QEF again with other bounds (e.g. first with fixed and then with free W
+		coordinate) costs only clamping of the cached minimizer.
 		\param[in] minPoint Lower bound of solution space
 		\param[in] maxPoint Upper bound of solution space
 		\return Point which minimizes QEF value
 	*/
 	glm::vec4 solve (glm::vec4 minPoint, glm::vec4 maxPoint);
 	
-	float pinvTolerance () const noexcept { return m_pinvTolerance; }
-	float jacobiTolerance () const noexcept { return m_jacobiTolerance; }
-	int maxJacobiIters () const noexcept { return m_maxJacobiIters; }
-	bool fastFormulasUsed () const noexcept { return m_useFastFormulas; }
+	const Config &config () const noexcept { return m_config; }
+	float pinvTolerance () const noexcept { return m_config.pinvTolerance; }
+	float jacobiTolerance () const noexcept { return m_config.jacobiTolerance; }
+	int maxJacobiIters () const noexcept { return m_config.maxJacobiIters; }
+	bool fastFormulasUsed () const noexcept { return m_config.useFastFormulas; }
+	bool simdUsed () const noexcept { return m_config.useSimd; }
 	
-	void setPinvTolerance (float value) noexcept { m_pinvTolerance = glm::max (0.0f, value); }
-	void setJacobiTolerance (float value) noexcept { m_jacobiTolerance = glm::max (0.0f, value); }
-	void setMaxJacobiIters (int value) noexcept { m_maxJacobiIters = glm::max (1, value); }
-	void useFastFormulas (bool value) noexcept { m_useFastFormulas = value; }
+	void setConfig (const Config &value) noexcept;
+	void setPinvTolerance (float value) noexcept {
+		m_config.pinvTolerance = glm::max (0.0f, value);
+		m_solved = false;
+	}
+	void setJacobiTolerance (float value) noexcept {
+		m_config.jacobiTolerance = glm::max (0.0f, value);
+		m_solved = false;
+	}
+	void setMaxJacobiIters (int value) noexcept {
+		m_config.maxJacobiIters = glm::max (1, value);
+		m_solved = false;
+	}
+	void useFastFormulas (bool value) noexcept {
+		m_config.useFastFormulas = value;
+		m_solved = false;
+	}
+	void useSimd (bool value) noexcept { m_config.useSimd = value; }
 	
 private:
 	/// Maximal number of used rows
 	constexpr static int kMaxRows = 16;
 	/** \brief Column-major matrix A* = (A b)
+
+		Rows past the used ones are kept zeroed, columns are aligned for SIMD kernel.
 	*/
-	float A[5][kMaxRows];
+	alignas (16) float A[5][kMaxRows];
 	/// Count of matrix rows occupied with useful data
 	int m_usedRows;
 	/// Algebraic sum of points added to the solver
@@ -108,14 +152,12 @@ private:
 		pseudoinverse matrix).
 	*/
 	uint32_t m_featureDim;
-	/// Singular values with absolute value less than tolerance will be truncated to zero
-	float m_pinvTolerance = 0.01f;
-	/// Stopping condition in Jacobi eigenvalue algorithm
-	float m_jacobiTolerance = 0.0025f;
-	/// Maximal number of Jacobi eigenvalue algorithm iterations
-	int m_maxJacobiIters = 20;
-	/// Whether to use more accurate or faster formulae in Jacobi eigenvalue algorithm
-	bool m_useFastFormulas = true;
+	/// Tunable options
+	Config m_config;
+	/// Whether \ref m_minimizer is up to date with the QEF
+	bool m_solved;
+	/// Unbounded QEF minimizer closest to the mass point
+	glm::vec4 m_minimizer;
 	
 	void compressMatrix () noexcept;
 };
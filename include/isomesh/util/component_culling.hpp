@@ -0,0 +1,33 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+/** \file
+	\brief Options for dropping small surface components during extraction
+*/
+#pragma once
+
+#include "../common.hpp"
+
+namespace isomesh
+{
+
+/** \brief Small surface components culling options
+
+	Noisy fields tend to produce lots of tiny floating surface fragments. When culling is enabled,
+	algorithms label connected components while generating triangles and drop the ones failing any
+	of the thresholds before producing the final mesh. Vertices not used by any of the kept
+	triangles are removed.
+	Default-constructed options disable culling, it has no overhead then.
+*/
+struct ComponentCulling {
+	/// Components with less triangles are dropped
+	uint32_t minTriangles = 0;
+	/** Components enclosing less volume (by absolute value) are dropped. Volume is measured in mesh
+	 local units (i.e. in grid cells for algorithms working on uniform grids). Note that volume is
+	 estimated with divergence theorem, it is meaningful only for closed components. */
+	double minVolume = 0;
+
+	/// Whether any threshold is set
+	bool enabled () const noexcept { return minTriangles > 0 || minVolume > 0; }
+};
+
+}
@@ -0,0 +1,108 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+/** \file
+	\brief Cancellation and progress reporting for long operations, running them asynchronously
+*/
+#pragma once
+
+#include "../common.hpp"
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+
+namespace isomesh
+{
+
+/// Exception thrown by operations cancelled through JobControl
+class JobCancelled : public std::runtime_error {
+public:
+	JobCancelled () : std::runtime_error ("Job was cancelled") {}
+};
+
+/** \brief Cancellation token and progress tracker of a long operation
+
+	Long operations (UniformGrid::fill, octree builds) accept an optional pointer to this object.
+	They check for cancellation between slabs of grid points or octree subtrees and throw
+	JobCancelled when it's requested. Cancellation and progress can be used from any thread while
+	the operation is running, but the progress callback must be set before it starts.
+
+	One control object tracks one operation at a time, progress is reset when the next one starts.
+*/
+class JobControl {
+public:
+	/// Requests cancellation, operation will stop at the next check
+	void cancel () noexcept { m_cancelled.store (true, std::memory_order_relaxed); }
+	bool isCancelled () const noexcept { return m_cancelled.load (std::memory_order_relaxed); }
+	/// Returns fraction of work done by the current operation, from 0 to 1
+	float progress () const noexcept;
+	/** \brief Sets function to call when progress changes
+
+		The callback is called from the thread running the operation roughly every percent of
+		progress, it may call \ref cancel.
+	*/
+	void setProgressCallback (std::function<void (float)> callback) { m_callback = std::move (callback); }
+
+	/// Throws JobCancelled if cancellation was requested, called by operations
+	void checkCancelled () const {
+		if (isCancelled ())
+			throw JobCancelled ();
+	}
+	/// Starts tracking progress of an operation consisting of given amount of work units
+	void resetProgress (uint64_t totalWork) noexcept;
+	/// Marks some work units done
+	void addProgress (uint64_t work);
+
+private:
+	std::atomic<bool> m_cancelled { false };
+	std::atomic<uint64_t> m_done { 0 };
+	std::atomic<uint64_t> m_total { 0 };
+	std::atomic<uint32_t> m_reportedPercent { 0 };
+	std::function<void (float)> m_callback;
+};
+
+/// Throws JobCancelled if control is given and cancellation was requested
+inline void checkCancelled (const JobControl *control) {
+	if (control)
+		control->checkCancelled ();
+}
+
+/// Marks a finished octree leaf of given size (work is counted in grid cells) as done, if control is given
+inline void addLeafProgress (JobControl *control, int32_t size) {
+	if (control)
+		control->addProgress (uint64_t (size) * uint64_t (size) * uint64_t (size));
+}
+
+/** \brief Job executor, receives a function and runs it somewhere
+
+	Executors let operations run on an application thread pool. Executor must run the function
+	exactly once, it is allowed to run it synchronously.
+*/
+using JobExecutor = std::function<void (std::function<void ()>)>;
+
+/** \brief Runs a function asynchronously
+
+	Use JobControl inside the function to make the job cancellable, e.g.
+	`runAsync ([&] { grid.fill (field, finder, &control); }, executor)`.
+	\param[in] job Function to run, its result (or exception) is passed to the future
+	\param[in] executor Executor running the job. When empty, the job is started with std::async,
+	so the returned future waits for the job to finish on destruction (nothing outlives it)
+	\return Future holding job result
+*/
+template<typename Func>
+auto runAsync (Func &&job, const JobExecutor &executor = JobExecutor ())
+	-> std::future<std::invoke_result_t<std::decay_t<Func>>> {
+	using Result = std::invoke_result_t<std::decay_t<Func>>;
+	if (!executor)
+		return std::async (std::launch::async, std::forward<Func> (job));
+	// std::function requires copyable functions, so the task is shared
+	auto task = std::make_shared<std::packaged_task<Result ()>> (std::forward<Func> (job));
+	auto future = task->get_future ();
+	executor ([task] () { (*task) (); });
+	return future;
+}
+
+}
@@ -0,0 +1,260 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+#include <isomesh/algo/block_extractor.hpp>
+#include <isomesh/algo/marching_cubes.hpp>
+#include <isomesh/algo/uniform_dual_contouring.hpp>
+#include <isomesh/data/grid.hpp>
+
+#include "../private/block_output.hpp"
+#include "../private/component_tracker.hpp"
+#include "../private/mesh_origin.hpp"
+#include "../private/ply_stream_writer.hpp"
+#include "../private/worker_pool.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace isomesh
+{
+
+namespace block_detail
+{
+
+// Global coordinates are packed into 20 bits each
+constexpr int32_t kCoordBits = 20;
+constexpr int32_t kMaxDomainSize = (1 << kCoordBits) - 1;
+
+// Splitting of the domain into blocks
+struct BlockLayout {
+	glm::ivec3 domain;
+	// Block grid size
+	int32_t size;
+	// Distance between origins of neighbouring blocks
+	int32_t stride;
+	glm::ivec3 blocks;
+};
+
+// Boundary vertex already written to file and waiting for other blocks sharing it
+struct PendingVertex {
+	uint32_t id;
+	uint32_t refsLeft;
+};
+
+uint64_t packKey (const glm::ivec3 &g, uint32_t tag) noexcept {
+	return uint64_t (g.x) | (uint64_t (g.y) << kCoordBits) |
+		(uint64_t (g.z) << (2 * kCoordBits)) | (uint64_t (tag) << (3 * kCoordBits));
+}
+
+/* Counts blocks containing a point with global coordinates g. Only coordinates along
+ axes set in axis_mask are checked, other ones are assumed to be strictly inside one block */
+uint32_t sharingBlocksCount (const BlockLayout &L, const glm::ivec3 &g, uint32_t axis_mask) noexcept {
+	uint32_t count = 1;
+	for (int i = 0; i < 3; i++) {
+		if (!(axis_mask & (1u << i)))
+			continue;
+		if (g[i] > 0 && g[i] % L.stride == 0 && g[i] / L.stride < L.blocks[i])
+			count *= 2;
+	}
+	return count;
+}
+
+BlockVertex makeVertex (const UniformGrid &G, const Mesh::Vertex &v) noexcept {
+	glm::dvec3 pos = G.localToGlobal (glm::dvec3 (v.position));
+	return BlockVertex { glm::vec3 (pos), v.normal, 0, 0 };
+}
+
+bool isInDomain (const BlockLayout &L, const glm::ivec3 &g) noexcept {
+	return g.x < L.domain.x && g.y < L.domain.y && g.z < L.domain.z;
+}
+
+/* Marching cubes vertices lie on edges, they are shared by blocks touching along the planes
+ containing the edge. Triangles are kept if their cells are inside the domain. */
+void processMcBlock (const BlockLayout &L, const glm::ivec3 &offset, const UniformGrid &G, BlockOutput &out) {
+	MeshOrigin origin;
+	Mesh mesh = marchingCubesWithOrigin (G, origin);
+	out.vertices.reserve (mesh.vertexCount ());
+	for (uint32_t i = 0; i < mesh.vertexCount (); i++) {
+		const MeshOrigin::Source &src = origin.vertices[i];
+		glm::ivec3 g = src.position + offset;
+		BlockVertex v = makeVertex (G, mesh[i]);
+		// Edges may lie on upper domain borders, but not cross them
+		bool in_domain = true;
+		for (int k = 0; k < 3; k++)
+			if (k == src.axis ? g[k] >= L.domain[k] : g[k] > L.domain[k])
+				in_domain = false;
+		if (in_domain) {
+			v.key = packKey (g, uint32_t (src.axis));
+			v.refs = sharingBlocksCount (L, g, 7u & ~(1u << src.axis));
+		}
+		out.vertices.push_back (v);
+	}
+	const uint32_t *indices = static_cast<const uint32_t *> (mesh.indexData ());
+	out.indices.reserve (mesh.indexCount ());
+	for (size_t i = 0; i < origin.triangles.size (); i++)
+		if (isInDomain (L, origin.triangles[i].position + offset))
+			out.indices.insert (out.indices.end (), indices + 3 * i, indices + 3 * i + 3);
+}
+
+/* Dual contouring vertices lie in cells, which are shared by overlapping blocks. Quads of
+ edges lying in the overlap layer are owned by the block which has this layer first. */
+void processDcBlock (const BlockLayout &L, const glm::ivec3 &offset, const glm::ivec3 &block_origin,
+                     const UniformGrid &G, QefSolver3D &solver, BlockOutput &out) {
+	MeshOrigin origin;
+	Mesh mesh = dualContouringWithOrigin (G, solver, origin);
+	out.vertices.reserve (mesh.vertexCount ());
+	for (uint32_t i = 0; i < mesh.vertexCount (); i++) {
+		glm::ivec3 g = origin.vertices[i].position + offset;
+		BlockVertex v = makeVertex (G, mesh[i]);
+		if (isInDomain (L, g)) {
+			v.key = packKey (g, 0);
+			v.refs = sharingBlocksCount (L, g, 7);
+		}
+		out.vertices.push_back (v);
+	}
+	const uint32_t *indices = static_cast<const uint32_t *> (mesh.indexData ());
+	out.indices.reserve (mesh.indexCount ());
+	for (size_t i = 0; i < origin.triangles.size (); i++) {
+		const MeshOrigin::Source &src = origin.triangles[i];
+		glm::ivec3 g = src.position + offset;
+		bool owned = g[src.axis] < block_origin[src.axis] + L.stride;
+		if (owned && isInDomain (L, g))
+			out.indices.insert (out.indices.end (), indices + 3 * i, indices + 3 * i + 3);
+	}
+}
+
+}
+
+using namespace block_detail;
+
+BlockExtractor::BlockExtractor (const glm::ivec3 &domainSize, uint32_t blockSize,
+                                const glm::dvec3 &domainPos, double gridStep) :
+	m_domainSize (domainSize), m_blockSize (blockSize), m_domainPos (domainPos), m_gridStep (gridStep) {
+	if (domainSize.x < 1 || domainSize.y < 1 || domainSize.z < 1)
+		throw std::invalid_argument ("Domain size should be positive");
+	if (domainSize.x > kMaxDomainSize || domainSize.y > kMaxDomainSize || domainSize.z > kMaxDomainSize)
+		throw std::length_error ("Too large domain size (>= 2^20)");
+	if (blockSize < 2)
+		throw std::invalid_argument ("Block size should be at least two");
+	if (blockSize & (blockSize - 1))
+		throw std::invalid_argument ("Block size is not a power of two");
+	if (blockSize > 1024)
+		throw std::length_error ("Too large block size (> 1024)");
+	if (!(gridStep > 0))
+		throw std::invalid_argument ("Grid step should be positive");
+}
+
+void BlockExtractor::extractMarchingCubes (const ScalarField &field, const ZeroFinder &zeroFinder,
+                                           const std::string &filename) {
+	extract<false> (field, zeroFinder, nullptr, filename);
+}
+
+void BlockExtractor::extractDualContouring (const ScalarField &field, const ZeroFinder &zeroFinder,
+                                            const QefSolver3D &solver, const std::string &filename) {
+	extract<true> (field, zeroFinder, &solver, filename);
+}
+
+template<bool DC>
+void BlockExtractor::extract (const ScalarField &field, const ZeroFinder &zeroFinder,
+                              const QefSolver3D *solver, const std::string &filename) {
+	BlockLayout L;
+	L.domain = m_domainSize;
+	L.size = int32_t (m_blockSize);
+	// Dual contouring needs all four cells around an edge, so blocks have to overlap
+	L.stride = DC ? L.size - 1 : L.size;
+	L.blocks = (m_domainSize + (L.stride - 1)) / L.stride;
+	const uint64_t total_blocks = uint64_t (L.blocks.x) * uint64_t (L.blocks.y) * uint64_t (L.blocks.z);
+
+	const uint32_t threads = uint32_t (std::min (uint64_t (WorkerPool::resolveThreadCount (m_threadCount)), total_blocks));
+
+	std::unique_ptr<PlyStreamWriter> writer;
+	std::unique_ptr<ComponentTracker> tracker;
+	if (m_splitComponents)
+		tracker.reset (new ComponentTracker (filename));
+	else
+		writer.reset (new PlyStreamWriter (filename));
+	std::unordered_map<uint64_t, PendingVertex> pending;
+	uint64_t peak_pending = 0;
+	std::mutex commit_mutex;
+
+	auto commit = [&] (const BlockOutput &out) {
+		std::lock_guard<std::mutex> lock (commit_mutex);
+		if (tracker) {
+			tracker->addBlock (out);
+			peak_pending = std::max (peak_pending, tracker->pendingCount ());
+			return;
+		}
+		std::vector<uint32_t> ids (out.vertices.size (), kBadIndex);
+		for (size_t i = 0; i < out.vertices.size (); i++) {
+			const BlockVertex &v = out.vertices[i];
+			if (v.refs == 0)
+				continue;
+			if (v.refs == 1) {
+				ids[i] = writer->addVertex (v.position, v.normal);
+				continue;
+			}
+			auto iter = pending.find (v.key);
+			if (iter != pending.end ()) {
+				ids[i] = iter->second.id;
+				if (--iter->second.refsLeft == 0)
+					pending.erase (iter);
+			}
+			else {
+				ids[i] = writer->addVertex (v.position, v.normal);
+				pending.emplace (v.key, PendingVertex { ids[i], v.refs - 1 });
+			}
+		}
+		for (size_t i = 0; i < out.indices.size (); i += 3)
+			writer->addTriangle (ids[out.indices[i]], ids[out.indices[i + 1]], ids[out.indices[i + 2]]);
+		peak_pending = std::max (peak_pending, uint64_t (pending.size ()));
+	};
+
+	WorkerPool workers (threads);
+	// Only tunables are taken from the prototype
+	std::vector<QefSolver3D> solvers (workers.threadCount ());
+	if (DC)
+		for (auto &local_solver : solvers)
+			local_solver.setConfig (solver->config ());
+	const int32_t h = L.size / 2;
+	workers.run (size_t (total_blocks), [&] (size_t block_idx, uint32_t worker) {
+		// YXZ order, the same as used by grids
+		glm::ivec3 block;
+		block.z = int32_t (block_idx % uint64_t (L.blocks.z));
+		block_idx /= uint64_t (L.blocks.z);
+		block.x = int32_t (block_idx % uint64_t (L.blocks.x));
+		block.y = int32_t (block_idx / uint64_t (L.blocks.x));
+		glm::ivec3 origin = block * L.stride;
+		// Shift from block local coordinates to domain coordinates
+		glm::ivec3 offset = origin + h;
+		glm::dvec3 center = m_domainPos + glm::dvec3 (offset) * m_gridStep;
+		BlockOutput out;
+		{
+			UniformGrid G (m_blockSize, center, m_gridStep);
+			G.fill (field, zeroFinder);
+			if (DC)
+				processDcBlock (L, offset, origin, G, solvers[worker], out);
+			else
+				processMcBlock (L, offset, G, out);
+		}
+		commit (out);
+	});
+
+	if (tracker) {
+		tracker->finish ();
+		m_vertexCount = tracker->vertexCount ();
+		m_triangleCount = tracker->triangleCount ();
+		m_componentCount = tracker->componentCount ();
+	}
+	else {
+		writer->finish ();
+		m_vertexCount = writer->vertexCount ();
+		m_triangleCount = writer->triangleCount ();
+		m_componentCount = 0;
+	}
+	m_peakPendingVertices = peak_pending;
+}
+
+}
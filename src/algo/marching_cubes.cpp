@@ -3,7 +3,14 @@
 #include <isomesh/algo/marching_cubes.hpp>
 #include <isomesh/util/tables.hpp>
 
+#include "../private/component_culler.hpp"
+#include "../private/disjoint_set_union.hpp"
+
 #include <algorithm>
+#include <cmath>
+#include <map>
+#include <stdexcept>
+#include <unordered_map>
 #include <vector>
 
 namespace isomesh
@@ -26,7 +33,8 @@ struct EdgeEntry {
 	bool operator < (const EdgeEntry &e) const noexcept { return cellIndex < e.cellIndex; }
 };
 
-uint32_t getVertexMask (const UniformGrid &G, uint32_t cell_idx) {
+template<typename Grid>
+uint32_t getVertexMask (const Grid &G, uint32_t cell_idx) {
 	auto materials = G.materialsOfCell (cell_idx);
 	uint32_t mask = 0;
 	for (uint32_t i = 0; i < 8; i++)
@@ -35,24 +43,25 @@ uint32_t getVertexMask (const UniformGrid &G, uint32_t cell_idx) {
 	return mask;
 }
 
-template<int D>
+template<int D, typename Grid>
 void collectCellEdges (std::vector<EdgeEntry> &cell_edges_0, std::vector<EdgeEntry> &cell_edges_1,
                        std::vector<EdgeEntry> &cell_edges_2, std::vector<EdgeEntry> &cell_edges_3,
-                       Mesh &mesh, const UniformGrid &G) {
-	size_t edges_count = G.edges<D> ().size ();
+                       ComponentCuller &mesh, const Grid &G) {
+	size_t edges_count = G.template edges<D> ().size ();
 	cell_edges_0.reserve (edges_count);
 	cell_edges_1.reserve (edges_count);
 	cell_edges_2.reserve (edges_count);
 	cell_edges_3.reserve (edges_count);
-	for (const auto &edge : G.edges<D> ()) {
+	for (const auto &edge : G.template edges<D> ()) {
 		// Add this edge's vertex to mesh
 		glm::vec3 point = edge.surfacePoint ();
 		glm::vec3 normal = edge.surfaceNormal ();
 		Material mat = edge.solidEndpointMaterial ();
+		glm::ivec3 edge_pos = edge.lesserEndpoint ();
+		mesh.setSource (edge_pos, D);
 		uint32_t vertex_idx = mesh.addVertex (point, normal, mat);
 		// Add this edge to adjacent cells
-		glm::ivec3 edge_pos = edge.lesserEndpoint ();
-		auto cells = G.adjacentCellsForEdge<D> (edge_pos);
+		auto cells = G.template adjacentCellsForEdge<D> (edge_pos);
 		if (cells[0] != kBadIndex)
 			cell_edges_0.emplace_back (cells[0], vertex_idx);
 		if (cells[1] != kBadIndex)
@@ -64,55 +73,495 @@ void collectCellEdges (std::vector<EdgeEntry> &cell_edges_0, std::vector<EdgeEnt
 	}
 }
 
+template<int D>
+void addEdgeVertices (ComponentCuller &mesh, const UniformGrid &G) {
+	for (const auto &edge : G.edges<D> ()) {
+		mesh.setSource (edge.lesserEndpoint (), D);
+		mesh.addVertex (edge.surfacePoint (), edge.surfaceNormal (), edge.solidEndpointMaterial ());
+	}
 }
 
-using namespace mc_detail;
+/* Builds transition cells in grid layers adjacent to coarser neighbours (i.e. neighbours with
+ two times bigger grid step). Faces of such layers are sampled at neighbour's resolution, so
+ the surface there matches neighbour's marching cubes surface exactly.
 
-Mesh marchingCubes (const UniformGrid &G) {
-	size_t edges_count = G.edges<0> ().size () + G.edges<1> ().size () + G.edges<2> ().size ();
-	// Each edge generates one vertex, and we assume that each vertex is shared by six triangles
-	Mesh mesh (edges_count, 6 * edges_count);
-	std::vector<EdgeEntry> cell_edges[12];
-	collectCellEdges<0> (cell_edges[3], cell_edges[1], cell_edges[0], cell_edges[2], mesh, G); // X
-	collectCellEdges<1> (cell_edges[7], cell_edges[6], cell_edges[4], cell_edges[5], mesh, G); // Y
-	collectCellEdges<2> (cell_edges[11], cell_edges[10], cell_edges[8], cell_edges[9], mesh, G); // Z
-	std::vector<EdgeEntry>::const_iterator cell_edge_iters[12];
-	// Group edges by cell ids
-	for (int i = 0; i < 12; i++) {
-		std::sort (cell_edges[i].begin (), cell_edges[i].end ());
-		cell_edge_iters[i] = cell_edges[i].begin ();
-	}
-	while (true) {
-		uint32_t min_unprocessed_cell = kBadIndex;
-		for (int i = 0; i < 12; i++)
-			if (cell_edge_iters[i] != cell_edges[i].end ())
-				min_unprocessed_cell = glm::min (min_unprocessed_cell, cell_edge_iters[i]->cellIndex);
-		// All cells are processed
-		if (min_unprocessed_cell == kBadIndex)
-			break;
-		uint32_t cell_idx = min_unprocessed_cell;
-		uint32_t vertex_idx[12];
-		uint32_t edge_mask = 0;
-		for (int i = 0; i < 12; i++) {
-			auto &iter = cell_edge_iters[i];
-			if (iter != cell_edges[i].end () && iter->cellIndex == cell_idx) {
-				vertex_idx[i] = iter->vertexIndex;
-				edge_mask |= uint32_t (1 << i);
-				++iter;
+ Instead of transition cell tables, each transition cell is processed as a polyhedron. Layer cells
+ sharing a coarse face square are grouped into one box, so boxes are 2x2x1 blocks of cells (or 2x2x2
+ blocks where several coarse faces meet). Box faces are split into polygons: coarse squares on
+ coarse faces, parts shared with the same neighbouring box, and single cell faces elsewhere. Cell
+ edges lying on coarse faces are replaced with coarse edges. Each polygon is processed like a face in
+ marching squares, resolving ambiguous faces the same way as marching cubes table does (solid
+ corners are separated). Face segments form closed loops, which are triangulated as fans. */
+class TransitionBuilder {
+public:
+	TransitionBuilder (const UniformGrid &G, const std::array<const UniformGrid *, 6> &coarser,
+	                   ComponentCuller &mesh);
+
+	bool enabled () const noexcept { return m_enabled; }
+	// Returns whether cell (given by its minimal corner) is replaced by transition cells
+	bool isTransitionCell (const glm::ivec3 &cell) const noexcept {
+		return m_cellBoxes.count (m_grid.pointToIndex (cell)) != 0;
+	}
+	// Must be called after regular marching cubes vertices are added
+	void build ();
+
+private:
+	using Polygon = std::vector<glm::ivec3>;
+
+	void collectBoxes ();
+	bool isOnCoarseFace (const glm::ivec3 &point, int axis) const noexcept;
+	bool isSolid (const glm::ivec3 &point) const noexcept { return m_grid[point] != Material::Empty; }
+	void buildBox (uint32_t box_id);
+	void tracePolygon (const std::vector<Polygon> &squares, Polygon &result) const;
+	void addPolygonSegments (const Polygon &polygon, std::unordered_map<uint32_t, uint32_t> &segments);
+	uint32_t fineVertex (const glm::ivec3 &a, const glm::ivec3 &b);
+	uint32_t coarseVertex (const glm::ivec3 &a, const glm::ivec3 &b);
+
+	const UniformGrid &m_grid;
+	const std::array<const UniformGrid *, 6> &m_coarser;
+	ComponentCuller &m_mesh;
+	const int32_t m_half;
+	bool m_enabled = false;
+	// Transition boxes given by minimal and maximal cells
+	std::vector<std::pair<glm::ivec3, glm::ivec3>> m_boxes;
+	std::unordered_map<uint32_t, uint32_t> m_cellBoxes;
+	std::unordered_map<uint32_t, uint32_t> m_coarseVertices;
+};
+
+TransitionBuilder::TransitionBuilder (const UniformGrid &G, const std::array<const UniformGrid *, 6> &coarser,
+                                      ComponentCuller &mesh) :
+	m_grid (G), m_coarser (coarser), m_mesh (mesh), m_half (G.maxCoord ()) {
+	for (const UniformGrid *C : coarser) {
+		if (!C)
+			continue;
+		m_enabled = true;
+		if (std::abs (C->gridStep () - 2.0 * G.gridStep ()) > 1e-9 * G.gridStep ())
+			throw std::invalid_argument ("Coarser neighbour grid step should be two times bigger");
+		// Grid corner must be a point of coarser grid
+		glm::dvec3 corner = C->globalToLocal (G.localToGlobal (glm::dvec3 (G.minCoord ())));
+		if (glm::length (corner - glm::round (corner)) > 1e-6)
+			throw std::invalid_argument ("Coarser neighbour grid is not aligned with the grid");
+	}
+	if (m_enabled && G.gridSize () < 4)
+		throw std::invalid_argument ("Grid with transition cells should be at least 4 in size");
+	if (m_enabled)
+		collectBoxes ();
+}
+
+bool TransitionBuilder::isOnCoarseFace (const glm::ivec3 &point, int axis) const noexcept {
+	return (m_coarser[2 * axis] && point[axis] == -m_half) || (m_coarser[2 * axis + 1] && point[axis] == m_half);
+}
+
+void TransitionBuilder::collectBoxes () {
+	// Collect cells of layers adjacent to coarse faces
+	std::vector<glm::ivec3> cells;
+	std::unordered_map<uint32_t, uint32_t> cell_ids;
+	for (int face = 0; face < 6; face++) {
+		if (!m_coarser[face])
+			continue;
+		int axis = face / 2;
+		int u = (axis + 1) % 3, v = (axis + 2) % 3;
+		glm::ivec3 cell;
+		cell[axis] = (face & 1) ? m_half - 1 : -m_half;
+		for (cell[u] = -m_half; cell[u] < m_half; cell[u]++) {
+			for (cell[v] = -m_half; cell[v] < m_half; cell[v]++) {
+				if (cell_ids.emplace (m_grid.pointToIndex (cell), uint32_t (cells.size ())).second)
+					cells.push_back (cell);
+			}
+		}
+	}
+	// Cells sharing a coarse square belong to one box
+	DisjointSetUnion<uint32_t> groups (uint32_t (cells.size ()));
+	for (uint32_t i = 0; i < cells.size (); i++) {
+		const glm::ivec3 &cell = cells[i];
+		for (int axis = 0; axis < 3; axis++) {
+			if (!isOnCoarseFace (cell, axis) && !isOnCoarseFace (cell + kCellCornerOffset[7], axis))
+				continue;
+			int u = (axis + 1) % 3, v = (axis + 2) % 3;
+			glm::ivec3 base = cell;
+			base[u] -= (cell[u] + m_half) & 1;
+			base[v] -= (cell[v] + m_half) & 1;
+			groups.mergeSets (i, cell_ids[m_grid.pointToIndex (base)]);
+		}
+	}
+	// Boxes are bounding boxes of groups, so L-shaped groups along edges are completed to cubes
+	std::unordered_map<uint32_t, uint32_t> group_boxes;
+	for (uint32_t i = 0; i < cells.size (); i++) {
+		auto iter = group_boxes.emplace (groups.getSetLeader (i), uint32_t (m_boxes.size ())).first;
+		if (iter->second == m_boxes.size ())
+			m_boxes.emplace_back (cells[i], cells[i]);
+		auto &box = m_boxes[iter->second];
+		box.first = glm::min (box.first, cells[i]);
+		box.second = glm::max (box.second, cells[i]);
+	}
+	for (uint32_t i = 0; i < m_boxes.size (); i++) {
+		glm::ivec3 cell;
+		for (cell.y = m_boxes[i].first.y; cell.y <= m_boxes[i].second.y; cell.y++)
+			for (cell.x = m_boxes[i].first.x; cell.x <= m_boxes[i].second.x; cell.x++)
+				for (cell.z = m_boxes[i].first.z; cell.z <= m_boxes[i].second.z; cell.z++)
+					m_cellBoxes[m_grid.pointToIndex (cell)] = i;
+	}
+}
+
+void TransitionBuilder::build () {
+	for (uint32_t i = 0; i < m_boxes.size (); i++)
+		buildBox (i);
+}
+
+void TransitionBuilder::buildBox (uint32_t box_id) {
+	constexpr uint32_t kOutside = kBadIndex - 1;
+	const glm::ivec3 box_min = m_boxes[box_id].first;
+	const glm::ivec3 box_max = m_boxes[box_id].second + 1;
+	m_mesh.setSource (box_min, -1);
+	std::vector<Polygon> polygons;
+	for (int dir = 0; dir < 6; dir++) {
+		int axis = dir / 2;
+		int u = (axis + 1) % 3, v = (axis + 2) % 3;
+		glm::ivec3 base;
+		base[axis] = (dir & 1) ? box_max[axis] : box_min[axis];
+		// Box faces are oriented counterclockwise as seen from outside
+		auto makeFace = [&] (int32_t step) {
+			glm::ivec3 du (0), dv (0);
+			du[u] = step;
+			dv[v] = step;
+			Polygon face { base, base + du, base + du + dv, base + dv };
+			if (!(dir & 1))
+				std::reverse (face.begin (), face.end ());
+			return face;
+		};
+		if (isOnCoarseFace (base, axis)) {
+			for (base[u] = box_min[u]; base[u] < box_max[u]; base[u] += 2)
+				for (base[v] = box_min[v]; base[v] < box_max[v]; base[v] += 2)
+					polygons.push_back (makeFace (2));
+			continue;
+		}
+		// Cell faces shared with the same box (or lying on the grid border) form one polygon
+		std::vector<Polygon> squares;
+		std::vector<uint32_t> neighbours;
+		for (base[u] = box_min[u]; base[u] < box_max[u]; base[u]++) {
+			for (base[v] = box_min[v]; base[v] < box_max[v]; base[v]++) {
+				glm::ivec3 neighbour = base;
+				if (!(dir & 1))
+					neighbour[axis]--;
+				uint32_t neighbour_box = kOutside;
+				if (m_grid.isCellInGrid (neighbour)) {
+					auto iter = m_cellBoxes.find (m_grid.pointToIndex (neighbour));
+					neighbour_box = (iter != m_cellBoxes.end ()) ? iter->second : kBadIndex;
+				}
+				squares.push_back (makeFace (1));
+				neighbours.push_back (neighbour_box);
+			}
+		}
+		DisjointSetUnion<uint32_t> merged (uint32_t (squares.size ()));
+		std::unordered_map<uint32_t, uint32_t> first_square;
+		std::map<std::pair<int, uint32_t>, uint32_t> coarse_edges;
+		for (uint32_t i = 0; i < squares.size (); i++) {
+			if (neighbours[i] != kBadIndex) {
+				auto iter = first_square.emplace (neighbours[i], i).first;
+				merged.mergeSets (i, iter->second);
+			}
+			// Halves of one coarse edge
+			for (int k = 0; k < 4; k++) {
+				glm::ivec3 a = glm::min (squares[i][k], squares[i][(k + 1) % 4]);
+				glm::ivec3 b = glm::max (squares[i][k], squares[i][(k + 1) % 4]);
+				int edge_axis = (a.x != b.x) ? 0 : (a.y != b.y) ? 1 : 2;
+				int plane_axis = 3 - axis - edge_axis;
+				if (!isOnCoarseFace (a, plane_axis))
+					continue;
+				a[edge_axis] -= (a[edge_axis] + m_half) & 1;
+				auto iter = coarse_edges.emplace (std::make_pair (edge_axis, m_grid.pointToIndex (a)), i).first;
+				merged.mergeSets (i, iter->second);
+			}
+		}
+		std::map<uint32_t, std::vector<Polygon>> merged_squares;
+		for (uint32_t i = 0; i < squares.size (); i++)
+			merged_squares[merged.getSetLeader (i)].push_back (squares[i]);
+		for (const auto &entry : merged_squares) {
+			polygons.emplace_back ();
+			tracePolygon (entry.second, polygons.back ());
+		}
+	}
+	// Surface segments on the box boundary form closed loops
+	std::unordered_map<uint32_t, uint32_t> segments;
+	for (const auto &polygon : polygons)
+		addPolygonSegments (polygon, segments);
+	while (!segments.empty ()) {
+		std::vector<uint32_t> loop;
+		uint32_t start = segments.begin ()->first;
+		uint32_t vertex = start;
+		do {
+			auto iter = segments.find (vertex);
+			// Each crossing is entered by one polygon sharing its edge and exited by the other
+			assert (iter != segments.end ());
+			loop.push_back (vertex);
+			vertex = iter->second;
+			segments.erase (iter);
+		} while (vertex != start);
+		assert (loop.size () >= 2);
+		// Two segments between the same crossings (surface touching box boundary) enclose no area
+		if (loop.size () == 2)
+			continue;
+		if (loop.size () == 3) {
+			m_mesh.addTriangle (loop[0], loop[1], loop[2]);
+			continue;
+		}
+		glm::vec3 center (0), normal (0);
+		for (uint32_t id : loop) {
+			center += m_mesh[id].position;
+			normal += m_mesh[id].normal;
+		}
+		center /= float (loop.size ());
+		Material mat = Material (uint8_t (m_mesh[loop[0]].material));
+		uint32_t center_id = m_mesh.addVertex (center, glm::normalize (normal), mat);
+		for (size_t i = 0; i < loop.size (); i++)
+			m_mesh.addTriangle (center_id, loop[i], loop[(i + 1) % loop.size ()]);
+	}
+}
+
+void TransitionBuilder::tracePolygon (const std::vector<Polygon> &squares, Polygon &result) const {
+	// Collect boundary edges, inner edges are shared by two faces in opposite directions
+	std::map<std::pair<uint32_t, uint32_t>, std::pair<glm::ivec3, glm::ivec3>> edges;
+	for (const auto &face : squares) {
+		for (int k = 0; k < 4; k++) {
+			uint32_t a = m_grid.pointToIndex (face[k]);
+			uint32_t b = m_grid.pointToIndex (face[(k + 1) % 4]);
+			if (edges.erase (std::make_pair (b, a)) == 0)
+				edges.emplace (std::make_pair (a, b), std::make_pair (face[k], face[(k + 1) % 4]));
+		}
+	}
+	std::unordered_map<uint32_t, glm::ivec3> next;
+	for (const auto &edge : edges)
+		next.emplace (edge.first.first, edge.second.second);
+	// Walk around the boundary, skipping midpoints of coarse edges
+	glm::ivec3 start = edges.begin ()->second.first;
+	glm::ivec3 point = start;
+	do {
+		glm::ivec3 following = next[m_grid.pointToIndex (point)];
+		bool is_midpoint = false;
+		if (!result.empty ()) {
+			glm::ivec3 prev = result.back ();
+			glm::ivec3 d1 = point - prev, d2 = following - point;
+			if (d1 == d2) {
+				for (int axis = 0; axis < 3; axis++) {
+					int edge_axis = (d1.x != 0) ? 0 : (d1.y != 0) ? 1 : 2;
+					if (isOnCoarseFace (point, axis) && ((point[edge_axis] + m_half) & 1))
+						is_midpoint = true;
+				}
 			}
 		}
+		if (!is_midpoint)
+			result.push_back (point);
+		point = following;
+	} while (point != start);
+	// Start point itself may be a midpoint
+	if (result.size () > 2) {
+		glm::ivec3 d1 = result[0] - result.back (), d2 = result[1] - result[0];
+		int edge_axis = (d1.x != 0) ? 0 : (d1.y != 0) ? 1 : 2;
+		if (d1 == d2 && ((result[0][edge_axis] + m_half) & 1)) {
+			for (int axis = 0; axis < 3; axis++) {
+				if (isOnCoarseFace (result[0], axis)) {
+					result.erase (result.begin ());
+					break;
+				}
+			}
+		}
+	}
+}
+
+void TransitionBuilder::addPolygonSegments (const Polygon &polygon, std::unordered_map<uint32_t, uint32_t> &segments) {
+	const size_t n = polygon.size ();
+	size_t first_enter = n;
+	for (size_t i = 0; i < n; i++) {
+		if (!isSolid (polygon[i]) && isSolid (polygon[(i + 1) % n])) {
+			first_enter = i;
+			break;
+		}
+	}
+	if (first_enter == n)
+		return;
+	auto crossing = [&] (size_t i) {
+		const glm::ivec3 &a = polygon[i % n];
+		const glm::ivec3 &b = polygon[(i + 1) % n];
+		int32_t length = glm::abs (b.x - a.x) + glm::abs (b.y - a.y) + glm::abs (b.z - a.z);
+		return length == 1 ? fineVertex (a, b) : coarseVertex (a, b);
+	};
+	// Connect crossings bounding each run of solid points, this separates solid corners
+	uint32_t enter = crossing (first_enter);
+	for (size_t i = first_enter + 1; i < first_enter + n; i++) {
+		bool solid1 = isSolid (polygon[i % n]);
+		bool solid2 = isSolid (polygon[(i + 1) % n]);
+		if (solid1 && !solid2) {
+			bool inserted = segments.emplace (enter, crossing (i)).second;
+			// Every crossing is left by exactly one segment
+			assert (inserted);
+			(void) inserted;
+		}
+		else if (!solid1 && solid2)
+			enter = crossing (i);
+	}
+}
+
+uint32_t TransitionBuilder::fineVertex (const glm::ivec3 &a, const glm::ivec3 &b) {
+	glm::ivec3 lesser = glm::min (a, b);
+	int axis = (a.x != b.x) ? 0 : (a.y != b.y) ? 1 : 2;
+	const auto &storage = (axis == 0 ? m_grid.edges<0> () : axis == 1 ? m_grid.edges<1> () : m_grid.edges<2> ());
+	auto iter = storage.findEdge (lesser.x, lesser.y, lesser.z);
+	assert (iter != storage.end ());
+	// Regular vertices are added in storages order
+	uint32_t base = 0;
+	if (axis > 0)
+		base += uint32_t (m_grid.edges<0> ().size ());
+	if (axis > 1)
+		base += uint32_t (m_grid.edges<1> ().size ());
+	return base + uint32_t (iter - storage.begin ());
+}
+
+uint32_t TransitionBuilder::coarseVertex (const glm::ivec3 &a, const glm::ivec3 &b) {
+	glm::ivec3 lesser = glm::min (a, b);
+	int axis = (a.x != b.x) ? 0 : (a.y != b.y) ? 1 : 2;
+	uint32_t key = m_grid.pointToIndex (lesser) * 3 + uint32_t (axis);
+	auto cached = m_coarseVertices.find (key);
+	if (cached != m_coarseVertices.end ())
+		return cached->second;
+	uint32_t id = kBadIndex;
+	for (int face = 0; face < 6 && id == kBadIndex; face++) {
+		const UniformGrid *C = m_coarser[face];
+		int32_t plane = (face & 1) ? m_half : -m_half;
+		if (!C || lesser[face / 2] != plane)
+			continue;
+		glm::ivec3 pos = glm::ivec3 (glm::round (C->globalToLocal (m_grid.localToGlobal (glm::dvec3 (lesser)))));
+		const auto &storage = (axis == 0 ? C->edges<0> () : axis == 1 ? C->edges<1> () : C->edges<2> ());
+		auto iter = storage.findEdge (pos.x, pos.y, pos.z);
+		if (iter == storage.end ())
+			continue;
+		glm::dvec3 point = m_grid.globalToLocal (C->localToGlobal (glm::dvec3 (iter->surfacePoint ())));
+		id = m_mesh.addVertex (glm::vec3 (point), iter->surfaceNormal (), iter->solidEndpointMaterial ());
+	}
+	// Neighbour disagrees about the edge sign change, use the fine edge containing it
+	if (id == kBadIndex) {
+		glm::ivec3 middle = (a + b) / 2;
+		id = (isSolid (a) != isSolid (middle)) ? fineVertex (a, middle) : fineVertex (middle, b);
+	}
+	m_coarseVertices.emplace (key, id);
+	return id;
+}
+
+// Templated on grid type to use compile-time indexing of FixedUniformGrid when it is available
+template<typename Grid>
+Mesh marchingCubes (const Grid &G, const std::array<const UniformGrid *, 6> &coarserNeighbours,
+                    const ComponentCulling &culling, MeshOrigin *origin = nullptr) {
+	size_t edges_count = G.template edges<0> ().size () + G.template edges<1> ().size () + G.template edges<2> ().size ();
+	// Each edge generates one vertex, and we assume that each vertex is shared by six triangles
+	Mesh result (edges_count, 6 * edges_count);
+	ComponentCuller mesh (result, culling);
+	if (origin)
+		mesh.recordOrigin (*origin);
+	TransitionBuilder transition (G, coarserNeighbours, mesh);
+	// Origins would be broken by removing unused vertices
+	assert (!origin || !transition.enabled ());
+	auto processCell = [&] (uint32_t cell_idx, uint32_t edge_mask, const uint32_t vertex_idx[12]) {
+		if (transition.enabled () && transition.isTransitionCell (G.indexToPoint (cell_idx)))
+			return;
 		uint32_t vertex_mask = getVertexMask (G, cell_idx);
 		assert (edge_mask == kMcVertexMaskToEdgeMask[vertex_mask]);
+		(void) edge_mask;
+		if (mesh.recordsOrigin ())
+			mesh.setSource (G.indexToPoint (cell_idx), -1);
 		for (int i = 0; kMcTriangleTable[vertex_mask][i] != -1; i += 3) {
 			int i1 = kMcTriangleTable[vertex_mask][i];
 			int i2 = kMcTriangleTable[vertex_mask][i + 1];
 			int i3 = kMcTriangleTable[vertex_mask][i + 2];
 			mesh.addTriangle (vertex_idx[i1], vertex_idx[i2], vertex_idx[i3]);
 		}
+	};
+	if (G.surfaceCellsTracked ()) {
+		// Vertices are added in storages order, so edge indices map to vertex indices directly
+		addEdgeVertices<0> (mesh, G);
+		addEdgeVertices<1> (mesh, G);
+		addEdgeVertices<2> (mesh, G);
+		const uint32_t base[3] = {
+			0, uint32_t (G.template edges<0> ().size ()), uint32_t (G.template edges<0> ().size () + G.template edges<1> ().size ())
+		};
+		for (const auto &cell : G.surfaceCells ()) {
+			uint32_t vertex_idx[12];
+			for (int i = 0; i < 12; i++)
+				if (cell.edgeMask & (1 << i))
+					vertex_idx[i] = base[kCellEdgeDirection[i]] + cell.edgeIndex[i];
+			processCell (cell.cellIndex, cell.edgeMask, vertex_idx);
+		}
 	}
-	mesh.setGlobalPos (G.globalPosition ());
-	mesh.setGlobalScale (G.gridStep ());
-	return mesh;
+	else {
+		std::vector<EdgeEntry> cell_edges[12];
+		collectCellEdges<0> (cell_edges[3], cell_edges[1], cell_edges[0], cell_edges[2], mesh, G); // X
+		collectCellEdges<1> (cell_edges[7], cell_edges[6], cell_edges[4], cell_edges[5], mesh, G); // Y
+		collectCellEdges<2> (cell_edges[11], cell_edges[10], cell_edges[8], cell_edges[9], mesh, G); // Z
+		std::vector<EdgeEntry>::const_iterator cell_edge_iters[12];
+		// Group edges by cell ids
+		for (int i = 0; i < 12; i++) {
+			std::sort (cell_edges[i].begin (), cell_edges[i].end ());
+			cell_edge_iters[i] = cell_edges[i].begin ();
+		}
+		while (true) {
+			uint32_t min_unprocessed_cell = kBadIndex;
+			for (int i = 0; i < 12; i++)
+				if (cell_edge_iters[i] != cell_edges[i].end ())
+					min_unprocessed_cell = glm::min (min_unprocessed_cell, cell_edge_iters[i]->cellIndex);
+			// All cells are processed
+			if (min_unprocessed_cell == kBadIndex)
+				break;
+			uint32_t cell_idx = min_unprocessed_cell;
+			uint32_t vertex_idx[12];
+			uint32_t edge_mask = 0;
+			for (int i = 0; i < 12; i++) {
+				auto &iter = cell_edge_iters[i];
+				if (iter != cell_edges[i].end () && iter->cellIndex == cell_idx) {
+					vertex_idx[i] = iter->vertexIndex;
+					edge_mask |= uint32_t (1 << i);
+					++iter;
+				}
+			}
+			processCell (cell_idx, edge_mask, vertex_idx);
+		}
+	}
+	if (transition.enabled ())
+		transition.build ();
+	mesh.finish ();
+	// Fine vertices replaced by coarse ones are left unused (culling already removes them)
+	if (transition.enabled () && !culling.enabled ())
+		result.removeUnusedVertices ();
+	result.setGlobalPos (G.globalPosition ());
+	result.setGlobalScale (G.gridStep ());
+	return result;
+}
+
+}
+
+Mesh marchingCubes (const UniformGrid &G, const ComponentCulling &culling) {
+	return mc_detail::marchingCubes (G, { nullptr, nullptr, nullptr, nullptr, nullptr, nullptr }, culling);
+}
+
+Mesh marchingCubes (const UniformGrid &G, const std::array<const UniformGrid *, 6> &coarserNeighbours,
+                    const ComponentCulling &culling) {
+	return mc_detail::marchingCubes (G, coarserNeighbours, culling);
+}
+
+Mesh marchingCubesWithOrigin (const UniformGrid &G, MeshOrigin &origin) {
+	return mc_detail::marchingCubes (G, { nullptr, nullptr, nullptr, nullptr, nullptr, nullptr }, ComponentCulling (), &origin);
+}
+
+template<>
+Mesh marchingCubes<16> (const FixedUniformGrid<16> &G, const ComponentCulling &culling) {
+	return mc_detail::marchingCubes (G, { nullptr, nullptr, nullptr, nullptr, nullptr, nullptr }, culling);
+}
+
+template<>
+Mesh marchingCubes<32> (const FixedUniformGrid<32> &G, const ComponentCulling &culling) {
+	return mc_detail::marchingCubes (G, { nullptr, nullptr, nullptr, nullptr, nullptr, nullptr }, culling);
+}
+
+template<>
+Mesh marchingCubes<64> (const FixedUniformGrid<64> &G, const ComponentCulling &culling) {
+	return mc_detail::marchingCubes (G, { nullptr, nullptr, nullptr, nullptr, nullptr, nullptr }, culling);
 }
 
 }
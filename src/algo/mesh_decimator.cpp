@@ -0,0 +1,377 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+#include <isomesh/algo/mesh_decimator.hpp>
+
+#include "../private/worker_pool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <queue>
+#include <vector>
+
+namespace isomesh
+{
+
+namespace decim_detail
+{
+
+struct Collapse {
+	float cost;
+	uint32_t a, b;
+	uint32_t versionA, versionB;
+	// Priority queue pops the largest element, so compare in reverse
+	bool operator < (const Collapse &other) const noexcept { return cost > other.cost; }
+};
+
+class Decimation {
+public:
+	Decimation (const Mesh &mesh);
+
+	size_t triangleCount () const noexcept { return m_liveTriangles; }
+	// Splits vertices into regions, vertices shared by several regions are not moved by regional runs
+	uint32_t makeRegions (uint32_t regions_per_axis);
+	/* Collapses edges with both endpoints in the region (or with any unfrozen endpoints
+	 if region is kBadIndex) until keep_ratio of triangles of the region (or of the source
+	 mesh) is left or maximal error is reached. Global run may start from edges of shared
+	 vertices only, when regional runs have already exhausted all other collapses. Returns
+	 whether the queue ran out of collapses within the maximal error (rather than stopping
+	 at the target) */
+	bool run (uint32_t region, double keep_ratio, float max_error, QefSolver3D &solver,
+	          bool shared_only = false);
+	Mesh result (const Mesh &source) const;
+
+private:
+	bool isFree (uint32_t v, uint32_t region) const noexcept {
+		return !m_frozen[v] && (region == kBadIndex || (m_region[v] == region && !m_shared[v]));
+	}
+	void pushEdges (uint32_t v, uint32_t region, std::priority_queue<Collapse> &queue, QefSolver3D &solver);
+	bool evaluate (uint32_t a, uint32_t b, QefSolver3D &solver, float &cost, glm::vec3 &point);
+	bool isCollapseValid (uint32_t a, uint32_t b, const glm::vec3 &point);
+	// Returns the number of removed triangles
+	size_t collapse (uint32_t a, uint32_t b, const glm::vec3 &point, QefSolver3D &solver);
+	void compactTriangles (uint32_t v);
+
+	std::vector<glm::vec3> m_positions;
+	std::vector<glm::vec3> m_normals;
+	std::vector<Material> m_materials;
+	std::vector<QefSolver3D::State> m_quadrics;
+	std::vector<uint32_t> m_versions;
+	std::vector<uint32_t> m_region;
+	// Vertices of each region, regional runs never look at vertices of other regions
+	std::vector<std::vector<uint32_t>> m_regionVertices;
+	// Boundary vertices are never moved
+	std::vector<uint8_t> m_frozen;
+	std::vector<uint8_t> m_shared;
+	std::vector<uint8_t> m_removed;
+	std::vector<std::array<uint32_t, 3>> m_triangles;
+	std::vector<uint8_t> m_deadTriangles;
+	std::vector<std::vector<uint32_t>> m_vertexTriangles;
+	std::atomic<size_t> m_liveTriangles;
+};
+
+Decimation::Decimation (const Mesh &mesh) :
+	m_positions (mesh.vertexCount ()), m_normals (mesh.vertexCount ()), m_materials (mesh.vertexCount ()),
+	m_quadrics (mesh.vertexCount ()), m_versions (mesh.vertexCount (), 0),
+	m_region (mesh.vertexCount (), 0), m_frozen (mesh.vertexCount (), 0), m_shared (mesh.vertexCount (), 0),
+	m_removed (mesh.vertexCount (), 0), m_triangles (mesh.indexCount () / 3),
+	m_deadTriangles (mesh.indexCount () / 3, 0), m_vertexTriangles (mesh.vertexCount ()),
+	m_liveTriangles (mesh.indexCount () / 3) {
+	const uint32_t *indices = static_cast<const uint32_t *> (mesh.indexData ());
+	for (uint32_t i = 0; i < mesh.vertexCount (); i++) {
+		m_positions[i] = mesh[i].position;
+		m_normals[i] = mesh[i].normal;
+		m_materials[i] = Material (uint8_t (mesh[i].material));
+	}
+	std::vector<glm::vec3> triangle_normals (m_triangles.size (), glm::vec3 (0));
+	for (uint32_t t = 0; t < m_triangles.size (); t++) {
+		for (int k = 0; k < 3; k++) {
+			m_triangles[t][k] = indices[3 * t + k];
+			m_vertexTriangles[indices[3 * t + k]].push_back (t);
+		}
+		const glm::vec3 &p0 = m_positions[m_triangles[t][0]];
+		glm::vec3 normal = glm::cross (m_positions[m_triangles[t][1]] - p0, m_positions[m_triangles[t][2]] - p0);
+		float length = glm::length (normal);
+		if (length > 0.0f)
+			triangle_normals[t] = normal / length;
+	}
+	// Initial quadric of a vertex is made of planes of its triangles
+	QefSolver3D solver;
+	for (uint32_t v = 0; v < mesh.vertexCount (); v++) {
+		solver.reset ();
+		for (uint32_t t : m_vertexTriangles[v])
+			if (triangle_normals[t] != glm::vec3 (0))
+				solver.addPlane (m_positions[v], triangle_normals[t]);
+		m_quadrics[v] = solver.state ();
+	}
+	/* Vertices on boundary edges (used by a single triangle) are never moved. Each edge is
+	 counted with sign depending on its direction, boundary edges are left unbalanced. */
+	for (uint32_t v = 0; v < mesh.vertexCount (); v++) {
+		std::vector<std::pair<uint32_t, int>> balance;
+		for (uint32_t t : m_vertexTriangles[v]) {
+			for (int k = 0; k < 3; k++) {
+				if (m_triangles[t][k] != v)
+					continue;
+				balance.emplace_back (m_triangles[t][(k + 1) % 3], 1);
+				balance.emplace_back (m_triangles[t][(k + 2) % 3], -1);
+			}
+		}
+		std::sort (balance.begin (), balance.end ());
+		for (size_t i = 0; i < balance.size () && !m_frozen[v];) {
+			int sum = 0;
+			size_t j = i;
+			for (; j < balance.size () && balance[j].first == balance[i].first; j++)
+				sum += balance[j].second;
+			if (sum != 0)
+				m_frozen[v] = 1;
+			i = j;
+		}
+	}
+}
+
+uint32_t Decimation::makeRegions (uint32_t regions_per_axis) {
+	if (m_positions.empty ())
+		return 0;
+	glm::vec3 lo = m_positions[0], hi = m_positions[0];
+	for (const auto &p : m_positions) {
+		lo = glm::min (lo, p);
+		hi = glm::max (hi, p);
+	}
+	glm::vec3 extent = glm::max (hi - lo, glm::vec3 (1e-6f));
+	m_regionVertices.assign (regions_per_axis * regions_per_axis * regions_per_axis, {});
+	for (uint32_t v = 0; v < m_positions.size (); v++) {
+		glm::ivec3 bin = glm::ivec3 ((m_positions[v] - lo) / extent * float (regions_per_axis));
+		bin = glm::clamp (bin, glm::ivec3 (0), glm::ivec3 (int32_t (regions_per_axis) - 1));
+		m_region[v] = (uint32_t (bin.y) * regions_per_axis + uint32_t (bin.x)) * regions_per_axis + uint32_t (bin.z);
+		m_regionVertices[m_region[v]].push_back (v);
+	}
+	// Vertices having triangles in several regions are shared
+	for (const auto &tri : m_triangles) {
+		if (m_region[tri[0]] == m_region[tri[1]] && m_region[tri[0]] == m_region[tri[2]])
+			continue;
+		for (uint32_t v : tri)
+			m_shared[v] = 1;
+	}
+	return regions_per_axis * regions_per_axis * regions_per_axis;
+}
+
+bool Decimation::run (uint32_t region, double keep_ratio, float max_error, QefSolver3D &solver,
+                     bool shared_only) {
+	std::priority_queue<Collapse> queue;
+	size_t live = 0;
+	size_t target_triangles;
+	if (region != kBadIndex) {
+		/* Other workers modify vertices of their regions concurrently, so only own vertices are
+		 visited. Triangles are counted by their first vertex, so each is counted once */
+		for (uint32_t v : m_regionVertices[region]) {
+			if (!m_removed[v] && isFree (v, region))
+				pushEdges (v, region, queue, solver);
+			for (uint32_t t : m_vertexTriangles[v])
+				live += !m_deadTriangles[t] && m_triangles[t][0] == v;
+		}
+		// Regions hold different shares of the mesh, so each keeps the same fraction of its own triangles
+		target_triangles = size_t (std::llround (keep_ratio * double (live)));
+	} else {
+		for (uint32_t v = 0; v < m_positions.size (); v++)
+			if (!m_removed[v] && isFree (v, region) && (!shared_only || m_shared[v]))
+				pushEdges (v, region, queue, solver);
+		live = m_liveTriangles;
+		target_triangles = size_t (std::llround (keep_ratio * double (m_triangles.size ())));
+	}
+	while (!queue.empty () && live > target_triangles) {
+		Collapse c = queue.top ();
+		if (c.cost > max_error)
+			return true;
+		queue.pop ();
+		if (m_removed[c.a] || m_removed[c.b])
+			continue;
+		if (m_versions[c.a] != c.versionA || m_versions[c.b] != c.versionB)
+			continue;
+		float cost;
+		glm::vec3 point;
+		if (!evaluate (c.a, c.b, solver, cost, point) || !isCollapseValid (c.a, c.b, point))
+			continue;
+		live -= glm::min (live, collapse (c.a, c.b, point, solver));
+		pushEdges (c.a, region, queue, solver);
+	}
+	return queue.empty ();
+}
+
+void Decimation::pushEdges (uint32_t v, uint32_t region, std::priority_queue<Collapse> &queue, QefSolver3D &solver) {
+	for (uint32_t t : m_vertexTriangles[v]) {
+		if (m_deadTriangles[t])
+			continue;
+		for (int k = 0; k < 3; k++) {
+			uint32_t a = m_triangles[t][k];
+			uint32_t b = m_triangles[t][(k + 1) % 3];
+			// Edges may be pushed twice, duplicates are dropped as stale after the first collapse
+			if ((a != v && b != v) || !isFree (a, region) || !isFree (b, region))
+				continue;
+			float cost;
+			glm::vec3 point;
+			if (evaluate (a, b, solver, cost, point))
+				queue.push ({ cost, a, b, m_versions[a], m_versions[b] });
+		}
+	}
+}
+
+bool Decimation::evaluate (uint32_t a, uint32_t b, QefSolver3D &solver, float &cost, glm::vec3 &point) {
+	solver.reset ();
+	solver.merge (m_quadrics[a]);
+	solver.merge (m_quadrics[b]);
+	glm::vec3 lo = glm::min (m_positions[a], m_positions[b]);
+	glm::vec3 hi = glm::max (m_positions[a], m_positions[b]);
+	point = solver.solve (lo, hi);
+	cost = solver.eval (point);
+	return cost == cost;
+}
+
+bool Decimation::isCollapseValid (uint32_t a, uint32_t b, const glm::vec3 &point) {
+	// Link condition: common neighbours must be exactly the opposite vertices of shared triangles
+	std::vector<uint32_t> na, nb;
+	size_t shared = 0;
+	for (uint32_t t : m_vertexTriangles[a]) {
+		if (m_deadTriangles[t])
+			continue;
+		bool has_b = false;
+		for (uint32_t v : m_triangles[t]) {
+			if (v != a)
+				na.push_back (v);
+			has_b |= (v == b);
+		}
+		shared += has_b;
+	}
+	for (uint32_t t : m_vertexTriangles[b]) {
+		if (m_deadTriangles[t])
+			continue;
+		for (uint32_t v : m_triangles[t])
+			if (v != b)
+				nb.push_back (v);
+	}
+	std::sort (na.begin (), na.end ());
+	na.erase (std::unique (na.begin (), na.end ()), na.end ());
+	std::sort (nb.begin (), nb.end ());
+	nb.erase (std::unique (nb.begin (), nb.end ()), nb.end ());
+	std::vector<uint32_t> common;
+	std::set_intersection (na.begin (), na.end (), nb.begin (), nb.end (), std::back_inserter (common));
+	if (shared != 2 || common.size () != 2)
+		return false;
+	// Merged vertex must keep at least three neighbours (e.g. tetrahedron can't be collapsed)
+	if (na.size () + nb.size () - common.size () < 5)
+		return false;
+	// Triangles must not flip or degenerate
+	for (uint32_t v : { a, b }) {
+		for (uint32_t t : m_vertexTriangles[v]) {
+			if (m_deadTriangles[t])
+				continue;
+			const auto &tri = m_triangles[t];
+			if ((tri[0] == a || tri[1] == a || tri[2] == a) && (tri[0] == b || tri[1] == b || tri[2] == b))
+				continue;
+			glm::vec3 p[3], q[3];
+			for (int k = 0; k < 3; k++) {
+				p[k] = m_positions[tri[k]];
+				q[k] = (tri[k] == v) ? point : p[k];
+			}
+			glm::vec3 old_normal = glm::cross (p[1] - p[0], p[2] - p[0]);
+			glm::vec3 new_normal = glm::cross (q[1] - q[0], q[2] - q[0]);
+			if (glm::dot (old_normal, new_normal) <= 0.0f)
+				return false;
+		}
+	}
+	return true;
+}
+
+size_t Decimation::collapse (uint32_t a, uint32_t b, const glm::vec3 &point, QefSolver3D &solver) {
+	solver.reset ();
+	solver.merge (m_quadrics[a]);
+	solver.merge (m_quadrics[b]);
+	m_quadrics[a] = solver.state ();
+	m_positions[a] = point;
+	glm::vec3 normal = m_normals[a] + m_normals[b];
+	if (glm::dot (normal, normal) > 0.0f)
+		m_normals[a] = glm::normalize (normal);
+	m_removed[b] = 1;
+	m_versions[a]++;
+	size_t removed = 0;
+	for (uint32_t t : m_vertexTriangles[b]) {
+		if (m_deadTriangles[t])
+			continue;
+		auto &tri = m_triangles[t];
+		if (tri[0] == a || tri[1] == a || tri[2] == a) {
+			m_deadTriangles[t] = 1;
+			removed++;
+			continue;
+		}
+		for (auto &v : tri)
+			if (v == b)
+				v = a;
+		m_vertexTriangles[a].push_back (t);
+	}
+	m_vertexTriangles[b].clear ();
+	compactTriangles (a);
+	m_liveTriangles -= removed;
+	return removed;
+}
+
+void Decimation::compactTriangles (uint32_t v) {
+	auto &list = m_vertexTriangles[v];
+	list.erase (std::remove_if (list.begin (), list.end (), [&] (uint32_t t) { return m_deadTriangles[t] != 0; }),
+	            list.end ());
+}
+
+Mesh Decimation::result (const Mesh &source) const {
+	Mesh mesh (m_positions.size (), 3 * m_liveTriangles);
+	std::vector<uint32_t> ids (m_positions.size (), kBadIndex);
+	for (uint32_t t = 0; t < m_triangles.size (); t++) {
+		if (m_deadTriangles[t])
+			continue;
+		uint32_t tri[3];
+		for (int k = 0; k < 3; k++) {
+			uint32_t v = m_triangles[t][k];
+			if (ids[v] == kBadIndex)
+				ids[v] = mesh.addVertex (m_positions[v], m_normals[v], m_materials[v]);
+			tri[k] = ids[v];
+		}
+		mesh.addTriangle (tri[0], tri[1], tri[2]);
+	}
+	mesh.setGlobalPos (source.globalPos ());
+	mesh.setGlobalScale (source.globalScale ());
+	return mesh;
+}
+
+}
+
+using namespace decim_detail;
+
+Mesh MeshDecimator::decimate (const Mesh &mesh, const QefSolver3D &solver) const {
+	Decimation state (mesh);
+	// Set if regional runs have done all collapses within maximal error apart from shared vertices
+	bool regions_exhausted = false;
+	const uint32_t threads = WorkerPool::resolveThreadCount (m_threadCount);
+	const size_t total_triangles = state.triangleCount ();
+	// Share of triangles to keep, regions apply it to their own triangles
+	const double keep_ratio = total_triangles > 0 ? double (m_targetTriangles) / double (total_triangles) : 1.0;
+	if (threads > 1 && total_triangles > 0) {
+		// A few regions per thread to balance the load
+		uint32_t per_axis = 1;
+		while (per_axis * per_axis * per_axis < 4 * threads)
+			per_axis++;
+		uint32_t regions = state.makeRegions (per_axis);
+		std::vector<uint8_t> exhausted (regions, 0);
+		WorkerPool workers (threads);
+		std::vector<QefSolver3D> solvers (workers.threadCount (), QefSolver3D (solver.config ()));
+		workers.run (regions, [&] (size_t region, uint32_t worker) {
+			exhausted[region] = state.run (uint32_t (region), keep_ratio, m_maxError, solvers[worker]);
+		});
+		regions_exhausted = std::find (exhausted.begin (), exhausted.end (), 0) == exhausted.end ();
+	}
+	/* Finish the job over the whole mesh, keeping quadrics accumulated by regional runs so the error
+	 is still measured against the original planes. Only edges of shared vertices are left to queue
+	 if regions have exhausted their collapses */
+	QefSolver3D local_solver (solver.config ());
+	state.run (kBadIndex, keep_ratio, m_maxError, local_solver, regions_exhausted);
+	return state.result (mesh);
+}
+
+}
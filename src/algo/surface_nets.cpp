@@ -0,0 +1,126 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+#include <isomesh/algo/surface_nets.hpp>
+#include <isomesh/util/material_filter.hpp>
+
+#include "../private/dual_grid.hpp"
+
+#include <vector>
+
+namespace isomesh
+{
+
+namespace sn_detail
+{
+
+using namespace dual_detail;
+
+struct NetVertex {
+	uint32_t cellIndex;
+	glm::vec3 position;
+	glm::vec3 normal;
+};
+
+void computeVertices (const std::vector<EdgeEntry> &cell_edges, std::vector<NetVertex> &vertices,
+                      std::vector<uint32_t> &cell_vertices) {
+	auto iter = cell_edges.begin ();
+	while (iter != cell_edges.end ()) {
+		uint32_t cell_idx = iter->cellIndex;
+		glm::vec3 mean (0), avg_normal (0);
+		int count = 0;
+		do {
+			mean += iter->edgeIter->surfacePoint ();
+			avg_normal += iter->edgeIter->surfaceNormal ();
+			count++;
+			++iter;
+		} while (iter != cell_edges.end () && iter->cellIndex == cell_idx);
+		cell_vertices[cell_idx] = uint32_t (vertices.size ());
+		vertices.push_back ({ cell_idx, mean / float (count), glm::normalize (avg_normal) });
+	}
+}
+
+template<typename Grid>
+void smoothVertices (const Grid &G, std::vector<NetVertex> &vertices,
+                     const std::vector<uint32_t> &cell_vertices, uint32_t iterations) {
+	const int32_t max_cell = G.maxCoord () - 1;
+	std::vector<glm::vec3> smoothed (vertices.size ());
+	for (uint32_t it = 0; it < iterations; it++) {
+		for (size_t i = 0; i < vertices.size (); i++) {
+			glm::ivec3 cell = G.indexToPoint (vertices[i].cellIndex);
+			glm::vec3 sum (0);
+			int count = 0;
+			for (int axis = 0; axis < 3; axis++) {
+				for (int32_t delta = -1; delta <= 1; delta += 2) {
+					glm::ivec3 neighbour = cell;
+					neighbour[axis] += delta;
+					if (neighbour[axis] < G.minCoord () || neighbour[axis] > max_cell)
+						continue;
+					uint32_t id = cell_vertices[G.pointToIndex (neighbour)];
+					if (id == kBadIndex)
+						continue;
+					sum += vertices[id].position;
+					count++;
+				}
+			}
+			glm::vec3 position = vertices[i].position;
+			if (count > 0)
+				position = 0.5f * (position + sum / float (count));
+			glm::vec3 lower_bound = cell;
+			smoothed[i] = glm::clamp (position, lower_bound, lower_bound + 1.0f);
+		}
+		for (size_t i = 0; i < vertices.size (); i++)
+			vertices[i].position = smoothed[i];
+	}
+}
+
+template<typename Grid>
+Mesh surfaceNets (const Grid &G, uint32_t smoothingIterations, const ComponentCulling &culling) {
+	size_t edges_count = G.template edges<0> ().size () + G.template edges<1> ().size () + G.template edges<2> ().size ();
+	std::vector<EdgeEntry> cell_edges;
+	collectCellEdges (cell_edges, G);
+	std::vector<NetVertex> vertices;
+	std::vector<uint32_t> dual_vertex_ids (G.dataSize (), kBadIndex);
+	computeVertices (cell_edges, vertices, dual_vertex_ids);
+	if (smoothingIterations > 0)
+		smoothVertices (G, vertices, dual_vertex_ids, smoothingIterations);
+	// Rough estimation that vertices count is equal to edges count
+	// and each vertex is shared by six triangles
+	Mesh result (edges_count, 6 * edges_count);
+	ComponentCuller mesh (result, culling);
+	MaterialFilter filter;
+	for (const auto &vertex : vertices) {
+		filter.reset ();
+		filter.add (G.materialsOfCell (vertex.cellIndex));
+		dual_vertex_ids[vertex.cellIndex] = mesh.addVertex (vertex.position, vertex.normal, filter.select ());
+	}
+	generateQuads<0> (dual_vertex_ids, mesh, G); // X
+	generateQuads<1> (dual_vertex_ids, mesh, G); // Y
+	generateQuads<2> (dual_vertex_ids, mesh, G); // Z
+	mesh.finish ();
+	result.setGlobalPos (G.globalPosition ());
+	result.setGlobalScale (G.gridStep ());
+	return result;
+}
+
+}
+
+Mesh surfaceNets (const UniformGrid &G, uint32_t smoothingIterations, const ComponentCulling &culling) {
+	return sn_detail::surfaceNets (G, smoothingIterations, culling);
+}
+
+template<>
+Mesh surfaceNets<16> (const FixedUniformGrid<16> &G, uint32_t smoothingIterations, const ComponentCulling &culling) {
+	return sn_detail::surfaceNets (G, smoothingIterations, culling);
+}
+
+template<>
+Mesh surfaceNets<32> (const FixedUniformGrid<32> &G, uint32_t smoothingIterations, const ComponentCulling &culling) {
+	return sn_detail::surfaceNets (G, smoothingIterations, culling);
+}
+
+template<>
+Mesh surfaceNets<64> (const FixedUniformGrid<64> &G, uint32_t smoothingIterations, const ComponentCulling &culling) {
+	return sn_detail::surfaceNets (G, smoothingIterations, culling);
+}
+
+}
@@ -0,0 +1,115 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+#include <isomesh/data/chunk_manager.hpp>
+
+#include "../private/dual_grid.hpp"
+
+#include <stdexcept>
+
+namespace isomesh
+{
+
+namespace chunk_detail
+{
+
+using namespace dual_detail;
+
+template<int D, typename DualVertexFunc>
+void generateQuads (const UniformGrid &G, DualVertexFunc &dual_vertex, Mesh &mesh) {
+	const int32_t h = G.maxCoord ();
+	for (const auto &edge : G.edges<D> ()) {
+		glm::ivec3 edge_pos = edge.lesserEndpoint ();
+		// Edges on negative borders are owned by neighbours
+		if ((D != 0 && edge_pos.x == -h) || (D != 1 && edge_pos.y == -h) || (D != 2 && edge_pos.z == -h))
+			continue;
+		uint32_t vtx[4];
+		bool complete = true;
+		for (int i = 0; i < 4 && complete; i++) {
+			vtx[i] = dual_vertex (edge_pos + kEdgeCellOffset[D][i]);
+			complete = (vtx[i] != kBadIndex);
+		}
+		// Neighbour chunk is missing
+		if (!complete)
+			continue;
+		addQuad (mesh, vtx, !edge.isLesserEndpointSolid ());
+	}
+}
+
+}
+
+using namespace chunk_detail;
+
+ChunkManager::ChunkManager (uint32_t chunkSize, double gridStep, const glm::dvec3 &origin) :
+	m_chunkSize (chunkSize), m_gridStep (gridStep), m_origin (origin) {
+	if (chunkSize < 2)
+		throw std::invalid_argument ("Chunk size should be at least two");
+	if (chunkSize & (chunkSize - 1))
+		throw std::invalid_argument ("Chunk size is not a power of two");
+	if (chunkSize > 1024)
+		throw std::length_error ("Too large chunk size (> 1024)");
+}
+
+const UniformGrid &ChunkManager::fillChunk (const glm::ivec3 &key, const ScalarField &field,
+                                            const ZeroFinder &zeroFinder) {
+	auto &grid = m_chunks[key];
+	if (!grid)
+		grid.reset (new UniformGrid (m_chunkSize, chunkPosition (key), m_gridStep));
+	grid->fill (field, zeroFinder);
+	return *grid;
+}
+
+void ChunkManager::removeChunk (const glm::ivec3 &key) noexcept {
+	m_chunks.erase (key);
+}
+
+const UniformGrid *ChunkManager::chunk (const glm::ivec3 &key) const noexcept {
+	auto iter = m_chunks.find (key);
+	return iter != m_chunks.end () ? iter->second.get () : nullptr;
+}
+
+Mesh ChunkManager::meshChunk (const glm::ivec3 &key, QefSolver3D &solver) const {
+	const UniformGrid *G = chunk (key);
+	if (!G)
+		throw std::invalid_argument ("Chunk does not exist");
+	const int32_t size = int32_t (m_chunkSize);
+	const int32_t h = size / 2;
+	const UniformGrid *neighbours[8];
+	for (int i = 0; i < 8; i++)
+		neighbours[i] = chunk (key + glm::ivec3 (i & 1, (i >> 1) & 1, (i >> 2) & 1));
+
+	size_t edges_count = G->edges<0> ().size () + G->edges<1> ().size () + G->edges<2> ().size ();
+	Mesh mesh (edges_count, 6 * edges_count);
+	// Cells are indexed in (size + 1)^3 box, as halo cells have coordinates up to h
+	std::unordered_map<uint32_t, uint32_t> dual_vertex_ids;
+	DualVertexBuilder builder (solver);
+	auto dualVertex = [&] (const glm::ivec3 &cell) {
+		uint32_t cell_key = (uint32_t (cell.y + h) * uint32_t (size + 1) + uint32_t (cell.x + h)) *
+			uint32_t (size + 1) + uint32_t (cell.z + h);
+		auto iter = dual_vertex_ids.find (cell_key);
+		if (iter != dual_vertex_ids.end ())
+			return iter->second;
+		// Find the chunk containing this cell
+		glm::ivec3 shift (cell.x >= h ? 1 : 0, cell.y >= h ? 1 : 0, cell.z >= h ? 1 : 0);
+		const UniformGrid *owner = neighbours[shift.x | (shift.y << 1) | (shift.z << 2)];
+		uint32_t id = kBadIndex;
+		if (owner) {
+			glm::ivec3 local_cell = cell - shift * size;
+			builder.reset ();
+			builder.addCellEdges (*owner, local_cell);
+			if (!builder.empty ()) {
+				DualVertex v = builder.solve (local_cell, owner->materialsOfCell (local_cell));
+				id = mesh.addVertex (v.position + glm::vec3 (shift * size), v.normal, v.material);
+			}
+		}
+		dual_vertex_ids.emplace (cell_key, id);
+		return id;
+	};
+	generateQuads<0> (*G, dualVertex, mesh); // X
+	generateQuads<1> (*G, dualVertex, mesh); // Y
+	generateQuads<2> (*G, dualVertex, mesh); // Z
+	mesh.setGlobalPos (G->globalPosition ());
+	mesh.setGlobalScale (G->gridStep ());
+	return mesh;
+}
+
+}
@@ -0,0 +1,121 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+#include <isomesh/data/component_index.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace isomesh
+{
+
+namespace component_index_detail
+{
+
+constexpr char kMagic[8] = { 'I', 'S', 'O', 'C', 'I', 'D', 'X', '\0' };
+constexpr uint32_t kVersion = 1;
+// Number of doubles in serialized record: AABB, OBB center, axes, extents, area and volume
+constexpr int kDoublesCount = 3 + 3 + 3 + 9 + 3 + 2;
+
+}
+
+using namespace component_index_detail;
+
+ComponentIndex::ComponentIndex (const std::string &filename) : m_filename (filename) {
+	std::ifstream in (filename, std::ios::binary);
+	if (!in.is_open ())
+		throw std::runtime_error ("Can't open component index " + filename);
+	char magic[8];
+	uint32_t version = 0;
+	in.read (magic, sizeof (magic));
+	in.read (reinterpret_cast<char *> (&version), sizeof (version));
+	if (!in || std::memcmp (magic, kMagic, sizeof (magic)) != 0 || version != kVersion)
+		throw std::runtime_error ("Wrong component index format in " + filename);
+	while (true) {
+		uint64_t ints[3];
+		double doubles[kDoublesCount];
+		uint8_t watertight;
+		if (!in.read (reinterpret_cast<char *> (ints), sizeof (ints)))
+			break;
+		in.read (reinterpret_cast<char *> (doubles), sizeof (doubles));
+		in.read (reinterpret_cast<char *> (&watertight), sizeof (watertight));
+		if (!in)
+			throw std::runtime_error ("Truncated component index " + filename);
+		ComponentRecord r;
+		r.id = ints[0];
+		r.vertexCount = ints[1];
+		r.triangleCount = ints[2];
+		const double *d = doubles;
+		auto next = [&d] () { glm::dvec3 v (d[0], d[1], d[2]); d += 3; return v; };
+		r.aabbMin = next ();
+		r.aabbMax = next ();
+		r.obbCenter = next ();
+		for (int i = 0; i < 3; i++)
+			r.obbAxes[i] = next ();
+		r.obbHalfExtents = next ();
+		r.area = d[0];
+		r.volume = d[1];
+		r.watertight = (watertight != 0);
+		m_records.push_back (r);
+	}
+}
+
+std::string ComponentIndex::meshFilename (const ComponentRecord &record) const {
+	return meshFilename (m_filename, record.id);
+}
+
+std::string ComponentIndex::meshFilename (const std::string &indexFilename, uint64_t id) {
+	return indexFilename + "." + std::to_string (id) + ".ply";
+}
+
+std::vector<ComponentRecord> ComponentIndex::withMinTriangles (uint64_t minTriangles) const {
+	std::vector<ComponentRecord> result;
+	std::copy_if (m_records.begin (), m_records.end (), std::back_inserter (result),
+	              [&] (const ComponentRecord &r) { return r.triangleCount >= minTriangles; });
+	return result;
+}
+
+std::vector<ComponentRecord> ComponentIndex::withMinVolume (double minVolume) const {
+	std::vector<ComponentRecord> result;
+	std::copy_if (m_records.begin (), m_records.end (), std::back_inserter (result),
+	              [&] (const ComponentRecord &r) { return std::abs (r.volume) >= minVolume; });
+	return result;
+}
+
+std::vector<ComponentRecord> ComponentIndex::alignedWith (const glm::dvec3 &direction, double maxAngle) const {
+	std::vector<ComponentRecord> result;
+	glm::dvec3 dir = glm::normalize (direction);
+	double min_cos = std::cos (glm::clamp (maxAngle, 0.0, glm::half_pi<double> ()));
+	std::copy_if (m_records.begin (), m_records.end (), std::back_inserter (result),
+	              [&] (const ComponentRecord &r) { return std::abs (glm::dot (r.obbAxes[0], dir)) >= min_cos; });
+	return result;
+}
+
+void ComponentIndex::writeHeader (std::ostream &stream) {
+	stream.write (kMagic, sizeof (kMagic));
+	stream.write (reinterpret_cast<const char *> (&kVersion), sizeof (kVersion));
+}
+
+void ComponentIndex::writeRecord (std::ostream &stream, const ComponentRecord &r) {
+	uint64_t ints[3] = { r.id, r.vertexCount, r.triangleCount };
+	double doubles[kDoublesCount];
+	double *d = doubles;
+	auto put = [&d] (const glm::dvec3 &v) { d[0] = v.x; d[1] = v.y; d[2] = v.z; d += 3; };
+	put (r.aabbMin);
+	put (r.aabbMax);
+	put (r.obbCenter);
+	for (int i = 0; i < 3; i++)
+		put (r.obbAxes[i]);
+	put (r.obbHalfExtents);
+	d[0] = r.area;
+	d[1] = r.volume;
+	uint8_t watertight = r.watertight ? 1 : 0;
+	stream.write (reinterpret_cast<const char *> (ints), sizeof (ints));
+	stream.write (reinterpret_cast<const char *> (doubles), sizeof (doubles));
+	stream.write (reinterpret_cast<const char *> (&watertight), sizeof (watertight));
+}
+
+}
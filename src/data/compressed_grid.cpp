@@ -0,0 +1,164 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+#include <isomesh/data/compressed_grid.hpp>
+
+#include <cassert>
+#include <cmath>
+
+namespace isomesh
+{
+
+namespace cg_detail
+{
+
+// Quantization scales for edge offsets (in [0; 1]) and normal components (in [-1; 1])
+constexpr double kOffsetScale = 65535.0;
+constexpr double kNormalScale = 32767.0;
+
+void putVarint (std::vector<uint8_t> &out, uint64_t value) {
+	while (value >= 0x80) {
+		out.push_back (uint8_t (value | 0x80));
+		value >>= 7;
+	}
+	out.push_back (uint8_t (value));
+}
+
+uint64_t getVarint (const uint8_t *&ptr) noexcept {
+	uint64_t value = 0;
+	int shift = 0;
+	while (*ptr & 0x80) {
+		value |= uint64_t (*ptr++ & 0x7F) << shift;
+		shift += 7;
+	}
+	value |= uint64_t (*ptr++) << shift;
+	return value;
+}
+
+void putUint16 (std::vector<uint8_t> &out, uint16_t value) {
+	out.push_back (uint8_t (value));
+	out.push_back (uint8_t (value >> 8));
+}
+
+uint16_t getUint16 (const uint8_t *&ptr) noexcept {
+	uint16_t value = uint16_t (ptr[0] | (ptr[1] << 8));
+	ptr += 2;
+	return value;
+}
+
+int16_t quantizeNormal (double value) noexcept {
+	return int16_t (std::lround (glm::clamp (value, -1.0, 1.0) * kNormalScale));
+}
+
+double signNotZero (double value) noexcept { return value < 0 ? -1.0 : 1.0; }
+
+/* Octahedral normal encoding: the normal is projected onto octahedron |x| + |y| + |z| = 1 and lower
+ half (y < 0) is folded onto upper one. Unlike storing two components and restoring the third one,
+ error is uniform over the sphere (restoring Y from quantized X and Z loses precision near XZ plane) */
+glm::dvec2 encodeNormal (const glm::dvec3 &n) noexcept {
+	glm::dvec3 p = n / (std::abs (n.x) + std::abs (n.y) + std::abs (n.z));
+	if (p.y >= 0)
+		return glm::dvec2 (p.x, p.z);
+	return glm::dvec2 ((1.0 - std::abs (p.z)) * signNotZero (p.x), (1.0 - std::abs (p.x)) * signNotZero (p.z));
+}
+
+glm::dvec3 decodeNormal (const glm::dvec2 &e) noexcept {
+	double y = 1.0 - std::abs (e.x) - std::abs (e.y);
+	if (y >= 0)
+		return glm::normalize (glm::dvec3 (e.x, y, e.y));
+	return glm::normalize (glm::dvec3 ((1.0 - std::abs (e.y)) * signNotZero (e.x), y,
+	                                   (1.0 - std::abs (e.x)) * signNotZero (e.y)));
+}
+
+// Index of a point in YXZ order, edges are sorted by it regardless of grid layout
+uint64_t linearIndex (const glm::ivec3 &p, int32_t half, uint32_t size) noexcept {
+	uint64_t row = uint64_t (size) + 1;
+	return (uint64_t (p.y + half) * row + uint64_t (p.x + half)) * row + uint64_t (p.z + half);
+}
+
+}
+
+using namespace cg_detail;
+
+CompressedGrid::CompressedGrid (const UniformGrid &grid) :
+	m_size (grid.gridSize ()), m_layout (grid.layout ()), m_trackSurfaceCells (grid.surfaceCellsTracked ()),
+	m_globalPos (grid.globalPosition ()), m_gridStep (grid.gridStep ()) {
+	const Material *mat = grid.data ();
+	const uint32_t data_size = grid.dataSize ();
+	uint32_t run_start = 0;
+	for (uint32_t i = 1; i <= data_size; i++) {
+		if (i < data_size && mat[i] == mat[run_start])
+			continue;
+		m_materials.push_back (uint8_t (mat[run_start]));
+		putVarint (m_materials, i - run_start);
+		run_start = i;
+	}
+	m_materials.shrink_to_fit ();
+
+	const UniformGridEdgeStorage *storages[3] = { &grid.edges<0> (), &grid.edges<1> (), &grid.edges<2> () };
+	const int32_t half = grid.maxCoord ();
+	for (int axis = 0; axis < 3; axis++) {
+		m_edgeCount[axis] = uint32_t (storages[axis]->size ());
+		uint64_t prev_index = 0;
+		for (const auto &edge : *storages[axis]) {
+			glm::ivec3 lesser = edge.lesserEndpoint ();
+			uint64_t index = linearIndex (lesser, half, m_size);
+			assert (index >= prev_index);
+			glm::dvec2 normal = encodeNormal (edge.surfaceNormal ());
+			float offset = edge.surfacePoint ()[axis] - float (lesser[axis]);
+			// Solid endpoint flag goes to the lowest bit of position delta
+			putVarint (m_edges, ((index - prev_index) << 1) | (edge.isLesserEndpointSolid () ? 1u : 0u));
+			putUint16 (m_edges, uint16_t (std::lround (glm::clamp (double (offset), 0.0, 1.0) * kOffsetScale)));
+			putUint16 (m_edges, uint16_t (quantizeNormal (normal.x)));
+			putUint16 (m_edges, uint16_t (quantizeNormal (normal.y)));
+			prev_index = index;
+		}
+	}
+	m_edges.shrink_to_fit ();
+}
+
+UniformGrid CompressedGrid::decompress () const {
+	UniformGrid G (m_size, m_globalPos, m_gridStep, m_layout);
+	Material *mat = G.m_mat.get ();
+	const uint8_t *ptr = m_materials.data ();
+	const uint8_t *end = ptr + m_materials.size ();
+	while (ptr != end) {
+		Material value = Material (*ptr++);
+		uint64_t length = getVarint (ptr);
+		std::fill (mat, mat + length, value);
+		mat += length;
+	}
+	assert (mat == G.m_mat.get () + G.m_dataSize);
+
+	UniformGridEdgeStorage *storages[3] = { &G.m_edgeX, &G.m_edgeY, &G.m_edgeZ };
+	const int32_t half = G.maxCoord ();
+	const uint64_t row = uint64_t (m_size) + 1;
+	ptr = m_edges.data ();
+	for (int axis = 0; axis < 3; axis++) {
+		uint64_t index = 0;
+		for (uint32_t i = 0; i < m_edgeCount[axis]; i++) {
+			uint64_t packed = getVarint (ptr);
+			index += packed >> 1;
+			bool lesser_solid = (packed & 1) != 0;
+			double offset = getUint16 (ptr) / kOffsetScale;
+			double u = int16_t (getUint16 (ptr)) / kNormalScale;
+			double v = int16_t (getUint16 (ptr)) / kNormalScale;
+			glm::ivec3 lesser (int32_t (index / row % row) - half, int32_t (index / (row * row)) - half,
+			                   int32_t (index % row) - half);
+			glm::ivec3 bigger = lesser;
+			bigger[axis]++;
+			Material solid_mat = lesser_solid ? G[lesser] : G[bigger];
+			storages[axis]->addEdge (lesser.x, lesser.y, lesser.z, decodeNormal (glm::dvec2 (u, v)),
+			                         offset, axis, lesser_solid, solid_mat);
+		}
+	}
+	assert (ptr == m_edges.data () + m_edges.size ());
+	if (m_trackSurfaceCells)
+		G.trackSurfaceCells (true);
+	return G;
+}
+
+size_t CompressedGrid::memoryUsage () const noexcept {
+	return sizeof (CompressedGrid) + m_materials.capacity () + m_edges.capacity ();
+}
+
+}
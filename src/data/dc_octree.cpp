@@ -4,6 +4,8 @@
 #include <isomesh/util/material_filter.hpp>
 #include <isomesh/util/tables.hpp>
 
+#include "../private/component_culler.hpp"
+
 #include <cassert>
 #include <limits>
 #include <stdexcept>
@@ -19,15 +21,178 @@ DC_Octree::DC_Octree (int32_t root_size, glm::dvec3 global_pos, double global_sc
 }
 
 void DC_Octree::build (const UniformGrid &grid, QefSolver3D &solver, float epsilon,
-                       bool use_octree_simplification) {
+                       bool use_octree_simplification, JobControl *control) {
 	// Scale epsilon according to QEF scale (when translating from global coordinates to
 	// local QEF value is scaled by 1/(scale^2))
 	float scaled_epsilon = epsilon / float (m_globalScale * m_globalScale);
 	BuildArgs args {
-		grid, solver,
+		&grid, nullptr, solver,
 		scaled_epsilon,
-		use_octree_simplification
+		use_octree_simplification,
+		control
 	};
+	if (control)
+		control->resetProgress (uint64_t (m_rootSize) * uint64_t (m_rootSize) * uint64_t (m_rootSize));
+	try {
+		if (m_root.isSubdivided ())
+			m_root.collapse ();
+		glm::ivec3 min_corner (-m_rootSize / 2);
+		buildNode (&m_root, min_corner, m_rootSize, args);
+	}
+	catch (...) {
+		if (m_root.isSubdivided())
+			m_root.collapse ();
+		throw;
+	}
+}
+
+void DC_Octree::update (const UniformGrid &grid, QefSolver3D &solver, float epsilon,
+                        const glm::ivec3 &minPoint, const glm::ivec3 &maxPoint,
+                        bool use_octree_simplification, JobControl *control) {
+	float scaled_epsilon = epsilon / float (m_globalScale * m_globalScale);
+	BuildArgs args {
+		&grid, nullptr, solver,
+		scaled_epsilon,
+		use_octree_simplification,
+		control
+	};
+	// Cells having at least one corner in the dirty box
+	glm::ivec3 cell_min = minPoint - 1;
+	glm::ivec3 cell_max = maxPoint;
+	glm::ivec3 min_corner (-m_rootSize / 2);
+	if (control)
+		control->resetProgress (updateWork (&m_root, min_corner, m_rootSize, cell_min, cell_max));
+	try {
+		updateNode (&m_root, min_corner, m_rootSize, args, cell_min, cell_max);
+	}
+	catch (...) {
+		if (m_root.isSubdivided())
+			m_root.collapse ();
+		throw;
+	}
+}
+
+/* Samples field values and Hermite data on demand, caching them as nodes share corners and
+ leaf cells share edges. Values and edges are computed exactly as UniformGrid::fill does. */
+class DC_Octree::FieldSampler {
+public:
+	FieldSampler (const DC_Octree &octree, const ScalarField &field, const ZeroFinder &zero_finder,
+	              double lipschitz) :
+		m_octree (octree), m_field (field), m_zeroFinder (zero_finder), m_lipschitz (lipschitz),
+		m_halfSize (octree.m_rootSize / 2), m_stride (uint32_t (octree.m_rootSize) + 1) {}
+
+	// Returns true if the node surely has no surface, filling its corners then
+	bool canSkip (glm::ivec3 min_corner, int32_t size, std::array<Material, 8> &corners) {
+		bool solid = isSolid (min_corner);
+		for (int i = 0; i < 8; i++) {
+			glm::ivec3 corner = min_corner + size * kCellCornerOffset[i];
+			if (isSolid (corner) != solid)
+				return false;
+			corners[i] = sample (corner).material;
+		}
+		if (m_lipschitz <= 0) {
+			if (size * 8 > m_octree.m_rootSize)
+				return false;
+			/* Neighbours see sign changes on the shared faces, so the whole boundary must have
+			 the same sign. Surface hidden inside is dropped, it can't connect to anything outside. */
+			glm::ivec3 max_corner = min_corner + size;
+			for (int32_t y = min_corner.y; y <= max_corner.y; y++) {
+				for (int32_t x = min_corner.x; x <= max_corner.x; x++) {
+					bool side = (y == min_corner.y || y == max_corner.y || x == min_corner.x || x == max_corner.x);
+					int32_t z_step = side ? 1 : size;
+					for (int32_t z = min_corner.z; z <= max_corner.z; z += z_step)
+						if (isSolid (glm::ivec3 (x, y, z)) != solid)
+							return false;
+				}
+			}
+			return true;
+		}
+		// Field can't reach zero within the bounding sphere of the node
+		double radius = double (size) * glm::root_three<double> () * 0.5 * m_octree.m_globalScale;
+		double value = sample (min_corner + size / 2).value;
+		return glm::abs (value) > m_lipschitz * radius;
+	}
+
+	std::array<Material, 8> cellCorners (glm::ivec3 min_corner) {
+		std::array<Material, 8> corners;
+		for (int i = 0; i < 8; i++)
+			corners[i] = sample (min_corner + kCellCornerOffset[i]).material;
+		return corners;
+	}
+
+	const UniformGridEdge &edge (int axis, glm::ivec3 lesser) {
+		uint64_t key = uint64_t (pointKey (lesser)) * 3 + uint64_t (axis);
+		auto iter = m_edges.find (key);
+		if (iter != m_edges.end ())
+			return iter->second;
+		glm::ivec3 bigger = lesser;
+		bigger[axis]++;
+		const Sample &s1 = sample (lesser);
+		const Sample &s2 = sample (bigger);
+		bool sign1 = (s1.value <= 0.0);
+		const double step = m_octree.m_globalScale;
+		glm::dvec3 p = m_octree.localToGlobal (glm::dvec3 (lesser));
+		double c0 = p[axis];
+		double c1 = c0 + step;
+		if (axis == 0)
+			p.x = m_zeroFinder.findAlongX (c0, p.y, p.z, c1, s1.value, s2.value, m_field);
+		else if (axis == 1)
+			p.y = m_zeroFinder.findAlongY (p.x, c0, p.z, c1, s1.value, s2.value, m_field);
+		else p.z = m_zeroFinder.findAlongZ (p.x, p.y, c0, c1, s1.value, s2.value, m_field);
+		glm::dvec3 grad = m_field.grad (p);
+		double offset = (p[axis] - c0) / step;
+		Material mat = sign1 ? s1.material : s2.material;
+		UniformGridEdge edge (lesser.x, lesser.y, lesser.z, grad, offset, axis, sign1, mat);
+		return m_edges.emplace (key, edge).first->second;
+	}
+
+private:
+	struct Sample {
+		double value;
+		Material material;
+	};
+
+	uint32_t pointKey (glm::ivec3 p) const noexcept {
+		return (uint32_t (p.y + m_halfSize) * m_stride + uint32_t (p.x + m_halfSize)) * m_stride +
+			uint32_t (p.z + m_halfSize);
+	}
+
+	const Sample &sample (glm::ivec3 p) {
+		uint32_t key = pointKey (p);
+		auto iter = m_points.find (key);
+		if (iter != m_points.end ())
+			return iter->second;
+		glm::dvec3 pos = m_octree.localToGlobal (glm::dvec3 (p));
+		Sample s;
+		s.value = m_field (pos);
+		s.material = s.value > 0 ? Material::Empty : m_field.material (pos, s.value);
+		return m_points.emplace (key, s).first->second;
+	}
+
+	bool isSolid (glm::ivec3 p) { return sample (p).value <= 0.0; }
+
+	const DC_Octree &m_octree;
+	const ScalarField &m_field;
+	const ZeroFinder &m_zeroFinder;
+	const double m_lipschitz;
+	const int32_t m_halfSize;
+	const uint32_t m_stride;
+	std::unordered_map<uint32_t, Sample> m_points;
+	std::unordered_map<uint64_t, UniformGridEdge> m_edges;
+};
+
+void DC_Octree::build (const ScalarField &field, const ZeroFinder &zeroFinder, QefSolver3D &solver,
+                       float epsilon, double lipschitz, bool use_octree_simplification, JobControl *control) {
+	float scaled_epsilon = epsilon / float (m_globalScale * m_globalScale);
+	FieldSampler sampler (*this, field, zeroFinder, lipschitz);
+	BuildArgs args {
+		nullptr, &sampler, solver,
+		scaled_epsilon,
+		use_octree_simplification,
+		control
+	};
+	if (control)
+		control->resetProgress (uint64_t (m_rootSize) * uint64_t (m_rootSize) * uint64_t (m_rootSize));
 	try {
 		if (m_root.isSubdivided ())
 			m_root.collapse ();
@@ -44,6 +209,67 @@ void DC_Octree::build (const UniformGrid &grid, QefSolver3D &solver, float epsil
 namespace dc_detail
 {
 
+// Manifold cell configurations by solid corners mask in Marching Cubes corner order
+constexpr bool kManifoldMc[256] = {
+	true, true, true, true, true, false, true, true, true, true, false, true, true, true, true, true,
+	true, true, false, true, false, false, false, true, false, true, false, true, false, true, false, true,
+	true, false, true, true, false, false, true, true, false, false, false, true, false, false, true, true,
+	true, true, true, true, false, false, true, true, false, true, false, true, false, false, false, true,
+	true, false, false, false, true, false, true, true, false, false, false, false, true, true, true, true,
+	false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false,
+	true, false, true, true, true, false, true, true, false, false, false, false, true, false, true, true,
+	true, true, true, true, true, false, true, true, false, false, false, false, false, false, false, true,
+	true, false, false, false, false, false, false, false, true, true, false, true, true, true, true, true,
+	true, true, false, true, false, false, false, false, true, true, false, true, true, true, false, true,
+	false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false,
+	true, true, true, true, false, false, false, false, true, true, false, true, false, false, false, true,
+	true, false, false, false, true, false, true, false, true, true, false, false, true, true, true, true,
+	true, true, false, false, true, false, false, false, true, true, false, false, true, true, false, true,
+	true, false, true, false, true, false, true, false, true, false, false, false, true, false, true, true,
+	true, true, true, true, true, false, true, true, true, true, false, true, true, true, true, true,
+};
+
+constexpr std::array<bool, 256> makeManifoldDc () {
+	constexpr int dc_to_mc[8] = { 0, 3, 1, 2, 4, 7, 5, 6 };
+	std::array<bool, 256> result {};
+	for (uint32_t mask = 0; mask < 256; mask++) {
+		uint32_t mc_mask = 0;
+		for (int i = 0; i < 8; i++)
+			if (mask & (1u << i))
+				mc_mask |= 1u << dc_to_mc[i];
+		result[mask] = kManifoldMc[mc_mask];
+	}
+	return result;
+}
+
+// The same table indexed by mask in kCellCornerOffset corner order
+constexpr std::array<bool, 256> kManifoldDc = makeManifoldDc ();
+
+/* Bit masks for 3x3x3 point signs, bit index is (y * 9 + x * 3 + z). Line masks select
+ the lesser endpoints of all lines of three points along an axis. */
+constexpr uint32_t kYLineBits = 0x1FFu;
+constexpr uint32_t kXLineBits = 0x1C0E07u;
+constexpr uint32_t kZLineBits = 0x1249249u;
+constexpr uint32_t kNodeCornerBits = 0x5140145u;
+// Three points along an axis starting from the lowest point
+constexpr uint32_t kXAxisBits = 0x49u;
+constexpr uint32_t kYAxisBits = 0x40201u;
+constexpr uint32_t kZAxisBits = 0x7u;
+// Bit of the lowest point of every child
+constexpr int kChildBaseBit[8] = { 0, 1, 3, 4, 9, 10, 12, 13 };
+
+// Packs signs of node corners (bits 0, 2, 6, 8, 18, 20, 24, 26) in kCellCornerOffset order
+inline uint32_t nodeCornerSigns (uint32_t signs) noexcept {
+	return (signs & 0x1u) | ((signs >> 1) & 0x2u) | ((signs >> 4) & 0x4u) | ((signs >> 5) & 0x8u) |
+		((signs >> 14) & 0x10u) | ((signs >> 15) & 0x20u) | ((signs >> 18) & 0x40u) | ((signs >> 19) & 0x80u);
+}
+
+// Packs signs of child corners (bits 0, 1, 3, 4, 9, 10, 12, 13 above the base) in kCellCornerOffset order
+inline uint32_t childCornerSigns (uint32_t signs, int base) noexcept {
+	uint32_t w = signs >> base;
+	return (w & 0x3u) | ((w >> 1) & 0xCu) | ((w >> 5) & 0x30u) | ((w >> 6) & 0xC0u);
+}
+
 /* Quadruples of node children sharing an edge along some axis. First dimension - axis,
  second dimension - quadruple, third dimension - children. */
 constexpr int edgeTable[3][2][4] = {
@@ -53,7 +279,7 @@ constexpr int edgeTable[3][2][4] = {
 };
 
 template<int D>
-void edgeProc (std::array<const DC_OctreeNode *, 4> nodes, Mesh &mesh) {
+void edgeProc (std::array<const DC_OctreeNode *, 4> nodes, ComponentCuller &mesh) {
 	/* For a quadruple of nodes sharing an edge along some axis there are two quadruples
 	 of their children nodes sharing the same edge. This table maps node to its child. First
 	 dimension - axis, second dimension - position of child. Two values - parent number (in
@@ -134,7 +360,7 @@ constexpr int faceTableX[4][2] = { { 0, 2 }, { 4, 6 }, { 5, 7 }, { 1, 3 } };
 constexpr int faceTableY[4][2] = { { 0, 4 }, { 1, 5 }, { 3, 7 }, { 2, 6 } };
 constexpr int faceTableZ[4][2] = { { 0, 1 }, { 2, 3 }, { 6, 7 }, { 4, 5 } };
 
-void faceProcX (std::array<const DC_OctreeNode *, 2> nodes, Mesh &mesh) {
+void faceProcX (std::array<const DC_OctreeNode *, 2> nodes, ComponentCuller &mesh) {
 	constexpr int subTable[8][2] = {
 		{ 0, 2 }, { 0, 3 }, { 1, 0 }, { 1, 1 },
 		{ 0, 6 }, { 0, 7 }, { 1, 4 }, { 1, 5 }
@@ -173,7 +399,7 @@ void faceProcX (std::array<const DC_OctreeNode *, 2> nodes, Mesh &mesh) {
 	}
 }
 
-void faceProcY (std::array<const DC_OctreeNode *, 2> nodes, Mesh &mesh) {
+void faceProcY (std::array<const DC_OctreeNode *, 2> nodes, ComponentCuller &mesh) {
 	constexpr int subTable[8][2] = {
 		{ 0, 4 }, { 0, 5 }, { 0, 6 }, { 0, 7 },
 		{ 1, 0 }, { 1, 1 }, { 1, 2 }, { 1, 3 }
@@ -212,7 +438,7 @@ void faceProcY (std::array<const DC_OctreeNode *, 2> nodes, Mesh &mesh) {
 	}
 }
 
-void faceProcZ (std::array<const DC_OctreeNode *, 2> nodes, Mesh &mesh) {
+void faceProcZ (std::array<const DC_OctreeNode *, 2> nodes, ComponentCuller &mesh) {
 	constexpr int subTable[8][2] = {
 		{ 0, 1 }, { 1, 0 }, { 0, 3 }, { 1, 2 },
 		{ 0, 5 }, { 1, 4 }, { 0, 7 }, { 1, 6 }
@@ -251,7 +477,7 @@ void faceProcZ (std::array<const DC_OctreeNode *, 2> nodes, Mesh &mesh) {
 	}
 }
 
-void cellProc (const DC_OctreeNode *node, Mesh &mesh) {
+void cellProc (const DC_OctreeNode *node, ComponentCuller &mesh) {
 	assert (node);
 	if (!node->isSubdivided ())
 		return;
@@ -275,7 +501,7 @@ void cellProc (const DC_OctreeNode *node, Mesh &mesh) {
 	}
 }
 
-void makeVertices (DC_OctreeNode *node, Mesh &mesh) {
+void makeVertices (DC_OctreeNode *node, ComponentCuller &mesh) {
 	MaterialFilter filter;
 	if (!node->isSubdivided ()) {
 		if (!node->isHomogenous ()) {
@@ -296,13 +522,15 @@ void makeVertices (DC_OctreeNode *node, Mesh &mesh) {
 
 using namespace dc_detail;
 
-Mesh DC_Octree::contour () {
-	Mesh mesh;
+Mesh DC_Octree::contour (const ComponentCulling &culling) {
+	Mesh result;
+	ComponentCuller mesh (result, culling);
 	makeVertices (&m_root, mesh);
 	cellProc (&m_root, mesh);
-	mesh.setGlobalPos (m_globalPos);
-	mesh.setGlobalScale (m_globalScale);
-	return mesh;
+	mesh.finish ();
+	result.setGlobalPos (m_globalPos);
+	result.setGlobalScale (m_globalScale);
+	return result;
 }
 
 void DC_Octree::buildNode (DC_OctreeNode *node, glm::ivec3 min_corner,
@@ -310,6 +538,12 @@ void DC_Octree::buildNode (DC_OctreeNode *node, glm::ivec3 min_corner,
 	assert (node);
 	if (size == 1) {
 		buildLeaf (node, min_corner, size, args);
+		addLeafProgress (args.control, size);
+		return;
+	}
+	checkCancelled (args.control);
+	if (args.sampler && args.sampler->canSkip (min_corner, size, node->leaf_data.corners)) {
+		addLeafProgress (args.control, size);
 		return;
 	}
 	node->subdivide ();
@@ -318,6 +552,47 @@ void DC_Octree::buildNode (DC_OctreeNode *node, glm::ivec3 min_corner,
 		glm::ivec3 child_min_corner = min_corner + child_size * kCellCornerOffset[i];
 		buildNode(node->children[i], child_min_corner, child_size, args);
 	}
+	simplifyNode (node, min_corner, size, args);
+}
+
+void DC_Octree::updateNode (DC_OctreeNode *node, glm::ivec3 min_corner, int32_t size, BuildArgs &args,
+                            const glm::ivec3 &cell_min, const glm::ivec3 &cell_max) {
+	assert (node);
+	glm::ivec3 max_corner = min_corner + (size - 1);
+	for (int i = 0; i < 3; i++)
+		if (max_corner[i] < cell_min[i] || min_corner[i] > cell_max[i])
+			return;
+	// Collapsed node has no children to reuse
+	if (size == 1 || !node->isSubdivided ()) {
+		buildNode (node, min_corner, size, args);
+		return;
+	}
+	int32_t child_size = size / 2;
+	for (int i = 0; i < 8; i++) {
+		glm::ivec3 child_min_corner = min_corner + child_size * kCellCornerOffset[i];
+		updateNode (node->children[i], child_min_corner, child_size, args, cell_min, cell_max);
+	}
+	simplifyNode (node, min_corner, size, args);
+}
+
+uint64_t DC_Octree::updateWork (const DC_OctreeNode *node, glm::ivec3 min_corner, int32_t size,
+                                const glm::ivec3 &cell_min, const glm::ivec3 &cell_max) noexcept {
+	glm::ivec3 max_corner = min_corner + (size - 1);
+	for (int i = 0; i < 3; i++)
+		if (max_corner[i] < cell_min[i] || min_corner[i] > cell_max[i])
+			return 0;
+	if (size == 1 || !node->isSubdivided ())
+		return uint64_t (size) * uint64_t (size) * uint64_t (size);
+	uint64_t work = 0;
+	int32_t child_size = size / 2;
+	for (int i = 0; i < 8; i++) {
+		glm::ivec3 child_min_corner = min_corner + child_size * kCellCornerOffset[i];
+		work += updateWork (node->children[i], child_min_corner, child_size, cell_min, cell_max);
+	}
+	return work;
+}
+
+void DC_Octree::simplifyNode (DC_OctreeNode *node, glm::ivec3 min_corner, int32_t size, BuildArgs &args) {
 	// All children are build and possibly simplified, try to do simplification of this node
 	std::array<Material, 8> corners;
 	corners.fill (Material::Empty);
@@ -337,15 +612,35 @@ void DC_Octree::buildNode (DC_OctreeNode *node, glm::ivec3 min_corner,
 		return;
 	}
 	if (args.use_octree_simplification) {
-		CubeMaterials mats;
+		// Children share points, so some bits are set several times
+		uint32_t signs = 0;
+		Material solid_mat = Material::Empty;
+		bool single_material = true;
 		for (int i = 0; i < 8; i++) {
 			for (int j = 0; j < 8; j++) {
-				auto offset = kCellCornerOffset[i] + kCellCornerOffset[j];
-				mats[offset.y][offset.x][offset.z] = node->children[i]->leaf_data.corners[j];
+				Material mat = node->children[i]->leaf_data.corners[j];
+				if (mat == Material::Empty)
+					continue;
+				signs |= 1u << (kChildBaseBit[i] + kChildBaseBit[j]);
+				if (solid_mat == Material::Empty)
+					solid_mat = mat;
+				single_material &= (mat == solid_mat);
 			}
 		}
-		if (!checkTopoSafety (mats))
+		if (!checkTopoSafety (signs))
 			return;
+		// With one solid material comparing materials is the same as comparing signs
+		if (!single_material) {
+			CubeMaterials mats;
+			for (int i = 0; i < 8; i++) {
+				for (int j = 0; j < 8; j++) {
+					auto offset = kCellCornerOffset[i] + kCellCornerOffset[j];
+					mats[offset.y][offset.x][offset.z] = node->children[i]->leaf_data.corners[j];
+				}
+			}
+			if (!checkMaterialMidpoints (mats))
+				return;
+		}
 		args.solver.reset ();
 		glm::vec3 avg_normal { 0 };
 		for (int i = 0; i < 8; i++) {
@@ -371,14 +666,22 @@ void DC_Octree::buildNode (DC_OctreeNode *node, glm::ivec3 min_corner,
 void DC_Octree::buildLeaf (DC_OctreeNode *node, glm::ivec3 min_corner,
                            int32_t size, BuildArgs &args) {
 	QefSolver3D &solver = args.solver;
-	const UniformGrid &G = args.grid;
+	const UniformGrid *G = args.grid;
 
 	solver.reset ();
 	glm::vec3 avg_normal { 0 };
 
-	node->leaf_data.corners = G.materialsOfCell (G.pointToIndex (min_corner));
+	if (G)
+		node->leaf_data.corners = G->materialsOfCell (min_corner);
+	else node->leaf_data.corners = args.sampler->cellCorners (min_corner);
 	
 	bool has_edges = false;
+	const UniformGridSurfaceCell *surface_cell = nullptr;
+	if (G && G->surfaceCellsTracked ()) {
+		surface_cell = G->findSurfaceCell (G->pointToIndex (min_corner));
+		if (!surface_cell)
+			return;
+	}
 
 	constexpr int edge_table[3][4][2] = {
 		{ { 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 } }, // X
@@ -394,13 +697,23 @@ void DC_Octree::buildLeaf (DC_OctreeNode *node, glm::ivec3 min_corner,
 			if (mat1 != Material::Empty && mat2 != Material::Empty)
 				continue;
 			has_edges = true;
-			// C++ really needs 'for static' like in D language...
-			const auto &storage = (dim == 0 ? G.edges<0> () : dim == 1 ? G.edges<1> () : G.edges<2> ());
 			auto edge_pos = min_corner + kCellCornerOffset[edge_table[dim][i][0]];
-			auto iter = storage.findEdge (edge_pos.x, edge_pos.y, edge_pos.z);
-			assert (iter != storage.end ());
-			glm::vec3 vertex = iter->surfacePoint ();
-			glm::vec3 normal = iter->surfaceNormal ();
+			const UniformGridEdge *edge;
+			if (surface_cell) {
+				const auto &storage = (dim == 0 ? G->edges<0> () : dim == 1 ? G->edges<1> () : G->edges<2> ());
+				assert (surface_cell->edgeMask & (1 << (4 * dim + i)));
+				edge = &storage[surface_cell->edgeIndex[4 * dim + i]];
+			}
+			else if (G) {
+				// C++ really needs 'for static' like in D language...
+				const auto &storage = (dim == 0 ? G->edges<0> () : dim == 1 ? G->edges<1> () : G->edges<2> ());
+				auto iter = storage.findEdge (edge_pos.x, edge_pos.y, edge_pos.z);
+				assert (iter != storage.end ());
+				edge = &*iter;
+			}
+			else edge = &args.sampler->edge (dim, edge_pos);
+			glm::vec3 vertex = edge->surfacePoint ();
+			glm::vec3 normal = edge->surfaceNormal ();
 			solver.addPlane (vertex, normal);
 			avg_normal += normal;
 		}
@@ -415,47 +728,39 @@ void DC_Octree::buildLeaf (DC_OctreeNode *node, glm::ivec3 min_corner,
 	}
 }
 
-bool DC_Octree::checkTopoSafety (const CubeMaterials &mats) noexcept {
-	constexpr int dcToMc[8] = { 0, 3, 1, 2, 4, 7, 5, 6 };
-	constexpr bool isManifold[256] = {
-		true, true, true, true, true, false, true, true, true, true, false, true, true, true, true, true,
-		true, true, false, true, false, false, false, true, false, true, false, true, false, true, false, true,
-		true, false, true, true, false, false, true, true, false, false, false, true, false, false, true, true,
-		true, true, true, true, false, false, true, true, false, true, false, true, false, false, false, true,
-		true, false, false, false, true, false, true, true, false, false, false, false, true, true, true, true,
-		false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false,
-		true, false, true, true, true, false, true, true, false, false, false, false, true, false, true, true,
-		true, true, true, true, true, false, true, true, false, false, false, false, false, false, false, true,
-		true, false, false, false, false, false, false, false, true, true, false, true, true, true, true, true,
-		true, true, false, true, false, false, false, false, true, true, false, true, true, true, false, true,
-		false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false,
-		true, true, true, true, false, false, false, false, true, true, false, true, false, false, false, true,
-		true, false, false, false, true, false, true, false, true, true, false, false, true, true, true, true,
-		true, true, false, false, true, false, false, false, true, true, false, false, true, true, false, true,
-		true, false, true, false, true, false, true, false, true, false, false, false, true, false, true, true,
-		true, true, true, true, true, false, true, true, true, true, false, true, true, true, true, true,
-	};
-	uint32_t mask = 0;
-	for (int i = 0; i < 8; i++) {
-		auto pos = 2 * kCellCornerOffset[i];
-		auto mat = mats[pos.y][pos.x][pos.z];
-		if (mat != Material::Empty)
-			mask |= uint32_t (1 << dcToMc[i]);
-	}
-	if (!isManifold[mask])
+bool DC_Octree::checkTopoSafety (uint32_t signs) noexcept {
+	// Manifold test of the whole node and of all its children
+	if (!kManifoldDc[nodeCornerSigns (signs)])
 		return false;
-	for (int i = 0; i < 8; i++) {
-		uint32_t submask = 0;
-		for (int j = 0; j < 8; j++) {
-			auto pos = kCellCornerOffset[i] + kCellCornerOffset[j];
-			auto mat = mats[pos.y][pos.x][pos.z];
-			if (mat != Material::Empty)
-				submask |= uint32_t (1 << dcToMc[j]);
-		}
-		if (!isManifold[submask])
+	for (int i = 0; i < 8; i++)
+		if (!kManifoldDc[childCornerSigns (signs, kChildBaseBit[i])])
 			return false;
-	}
-	// Check edge midpoint signs
+	/* Check edge midpoint signs. Midpoint of three collinear points is bad if the other two are
+	 equal and the midpoint differs from them. Nine lines along each axis are tested at once. */
+	auto badLines = [] (uint32_t a, uint32_t m, uint32_t b, uint32_t mask) {
+		return (~(a ^ b) & (a ^ m) & mask) != 0;
+	};
+	if (badLines (signs, signs >> 9, signs >> 18, kYLineBits) ||
+	    badLines (signs, signs >> 3, signs >> 6, kXLineBits) ||
+	    badLines (signs, signs >> 1, signs >> 2, kZLineBits))
+		return false;
+	// Check face midpoint signs, the same way with four corners of a face
+	auto badFaces = [] (uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3, uint32_t m, uint32_t mask) {
+		return (~(c0 ^ c1) & ~(c0 ^ c2) & ~(c0 ^ c3) & (c0 ^ m) & mask) != 0;
+	};
+	if (badFaces (signs, signs >> 6, signs >> 18, signs >> 24, signs >> 12, kZAxisBits) ||
+	    badFaces (signs, signs >> 2, signs >> 18, signs >> 20, signs >> 10, kXAxisBits) ||
+	    badFaces (signs, signs >> 2, signs >> 6, signs >> 8, signs >> 4, kYAxisBits))
+		return false;
+	// Check cube midpoint sign
+	uint32_t corners = signs & kNodeCornerBits;
+	if (signs & (1u << 13))
+		return corners != 0;
+	return corners != kNodeCornerBits;
+}
+
+bool DC_Octree::checkMaterialMidpoints (const CubeMaterials &mats) noexcept {
+	// Check edge midpoint materials
 	for (int c1 = 0; c1 < 3; c1++) {
 		for (int c2 = 0; c2 < 3; c2++) {
 			if (mats[1][c1][c2] != mats[0][c1][c2] && mats[1][c1][c2] != mats[2][c1][c2])
@@ -466,7 +771,7 @@ bool DC_Octree::checkTopoSafety (const CubeMaterials &mats) noexcept {
 				return false;
 		}
 	}
-	// Check face midpoint signs
+	// Check face midpoint materials
 	for (int c1 = 0; c1 < 3; c1++) {
 		Material mat;
 		mat = mats[1][1][c1];
@@ -479,7 +784,7 @@ bool DC_Octree::checkTopoSafety (const CubeMaterials &mats) noexcept {
 		if (mat != mats[c1][0][0] && mat != mats[c1][0][2] && mat != mats[c1][2][0] && mat != mats[c1][2][2])
 			return false;
 	}
-	// Check cube midpoint sign
+	// Check cube midpoint material
 	auto mat = mats[1][1][1];
 	for (int i = 0; i < 8; i++) {
 		auto pos = 2 * kCellCornerOffset[i];
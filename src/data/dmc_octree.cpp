@@ -3,6 +3,8 @@
 #include <isomesh/data/dmc_octree.hpp>
 #include <isomesh/util/tables.hpp>
 
+#include "../private/component_culler.hpp"
+
 #include <algorithm>
 #include <cassert>
 #include <limits>
@@ -20,12 +22,14 @@ DMC_Octree::DMC_Octree (int32_t root_size, glm::dvec3 global_pos, double global_
 
 void DMC_Octree::build (const ScalarField &field, QefSolver4D &solver, float epsilon,
                         bool use_simple_split_policy, bool use_random_sampling,
-                        bool use_early_split_stop, uint32_t seed) {
+                        bool use_early_split_stop, uint32_t seed, JobControl *control) {
 	// Scale epsilon according to QEF scale (when translating from global coordinates to
 	// local QEF value is scaled by 1/(scale^2))
 	float scaled_epsilon = epsilon / float (m_globalScale * m_globalScale);
 	BuildArgs args { field, solver, scaled_epsilon, use_simple_split_policy,
-	                 use_random_sampling, use_early_split_stop, std::mt19937 (seed) };
+	                 use_random_sampling, use_early_split_stop, std::mt19937 (seed), control };
+	if (control)
+		control->resetProgress (uint64_t (m_rootSize) * uint64_t (m_rootSize) * uint64_t (m_rootSize));
 	try {
 		m_root.collapse ();
 		glm::ivec3 min_corner (-m_rootSize / 2);
@@ -41,6 +45,29 @@ void DMC_Octree::build (const ScalarField &field, QefSolver4D &solver, float eps
 namespace dmc_detail
 {
 
+// Samples taken by adaptive sampling before the first QEF check
+constexpr int kAdaptiveInitialSamples = 8;
+// Adaptive sampling stops when extrapolated error is below this fraction of epsilon
+constexpr float kAdaptiveAcceptFraction = 0.5f;
+
+// Van der Corput sequence in a given base
+float radicalInverse (uint32_t index, uint32_t base) {
+	float inv_base = 1.0f / float (base);
+	float factor = inv_base;
+	float result = 0;
+	while (index > 0) {
+		result += float (index % base) * factor;
+		index /= base;
+		factor *= inv_base;
+	}
+	return result;
+}
+
+// Point of 3D Halton sequence in the unit cube
+glm::vec3 haltonPoint (uint32_t index) {
+	return glm::vec3 (radicalInverse (index, 2), radicalInverse (index, 3), radicalInverse (index, 5));
+}
+
 struct NodeHash {
 	size_t operator ()(const std::pair<const DMC_OctreeNode *, const DMC_OctreeNode *> &node) const noexcept {
 		uintptr_t h1 = uintptr_t (node.first);
@@ -56,7 +83,7 @@ glm::vec3 lerp (const glm::vec3 &a, float w_a, const glm::vec3 &b, float w_b) {
 	return (a * w_b + b * w_a) / (w_a + w_b);
 }
 
-void vertProc (std::array<const DMC_OctreeNode *, 8> nodes, VertexMap &vtx_map, Mesh &mesh) {
+void vertProc (std::array<const DMC_OctreeNode *, 8> nodes, VertexMap &vtx_map, ComponentCuller &mesh) {
 	assert (nodes[0] && nodes[1] && nodes[2] && nodes[3] &&
 	        nodes[4] && nodes[5] && nodes[6] && nodes[7]);
 	const DMC_OctreeNode *sub[8];
@@ -114,7 +141,7 @@ constexpr int edgeTableX[2][4] = { { 0, 4, 5, 1 }, { 2, 6, 7, 3 } };
 constexpr int edgeTableY[2][4] = { { 0, 1, 3, 2 }, { 4, 5, 7, 6 } };
 constexpr int edgeTableZ[2][4] = { { 0, 2, 6, 4 }, { 1, 3, 7, 5 } };
 
-void edgeProcX (std::array<const DMC_OctreeNode *, 4> nodes, VertexMap &vtx_map, Mesh &mesh) {
+void edgeProcX (std::array<const DMC_OctreeNode *, 4> nodes, VertexMap &vtx_map, ComponentCuller &mesh) {
 	constexpr int subTable[8][2] = {
 		{ 0, 5 }, { 3, 4 }, { 0, 7 }, { 3, 6 },
 		{ 1, 1 }, { 2, 0 }, { 1, 3 }, { 2, 2 }
@@ -142,7 +169,7 @@ void edgeProcX (std::array<const DMC_OctreeNode *, 4> nodes, VertexMap &vtx_map,
 	vertProc ({ sub[0], sub[1], sub[2], sub[3], sub[4], sub[5], sub[6], sub[7] }, vtx_map, mesh);
 }
 
-void edgeProcY (std::array<const DMC_OctreeNode *, 4> nodes, VertexMap &vtx_map, Mesh &mesh) {
+void edgeProcY (std::array<const DMC_OctreeNode *, 4> nodes, VertexMap &vtx_map, ComponentCuller &mesh) {
 	constexpr int subTable[8][2] = {
 		{ 0, 3 }, { 1, 2 }, { 3, 1 }, { 2, 0 },
 		{ 0, 7 }, { 1, 6 }, { 3, 5 }, { 2, 4 }
@@ -170,7 +197,7 @@ void edgeProcY (std::array<const DMC_OctreeNode *, 4> nodes, VertexMap &vtx_map,
 	vertProc ({ sub[0], sub[1], sub[2], sub[3], sub[4], sub[5], sub[6], sub[7] }, vtx_map, mesh);
 }
 
-void edgeProcZ (std::array<const DMC_OctreeNode *, 4> nodes, VertexMap &vtx_map, Mesh &mesh) {
+void edgeProcZ (std::array<const DMC_OctreeNode *, 4> nodes, VertexMap &vtx_map, ComponentCuller &mesh) {
 	constexpr int subTable[8][2] = {
 		{ 0, 6 }, { 0, 7 }, { 1, 4 }, { 1, 5 },
 		{ 3, 2 }, { 3, 3 }, { 2, 0 }, { 2, 1 }
@@ -202,7 +229,7 @@ constexpr int faceTableX[4][2] = { { 0, 2 }, { 4, 6 }, { 5, 7 }, { 1, 3 } };
 constexpr int faceTableY[4][2] = { { 0, 4 }, { 1, 5 }, { 3, 7 }, { 2, 6 } };
 constexpr int faceTableZ[4][2] = { { 0, 1 }, { 2, 3 }, { 6, 7 }, { 4, 5 } };
 
-void faceProcX (std::array<const DMC_OctreeNode *, 2> nodes, VertexMap &vtx_map, Mesh &mesh) {
+void faceProcX (std::array<const DMC_OctreeNode *, 2> nodes, VertexMap &vtx_map, ComponentCuller &mesh) {
 	constexpr int subTable[8][2] = {
 		{ 0, 2 }, { 0, 3 }, { 1, 0 }, { 1, 1 },
 		{ 0, 6 }, { 0, 7 }, { 1, 4 }, { 1, 5 }
@@ -243,7 +270,7 @@ void faceProcX (std::array<const DMC_OctreeNode *, 2> nodes, VertexMap &vtx_map,
 }
 
 
-void faceProcY (std::array<const DMC_OctreeNode *, 2> nodes, VertexMap &vtx_map, Mesh &mesh) {
+void faceProcY (std::array<const DMC_OctreeNode *, 2> nodes, VertexMap &vtx_map, ComponentCuller &mesh) {
 	constexpr int subTable[8][2] = {
 		{ 0, 4 }, { 0, 5 }, { 0, 6 }, { 0, 7 },
 		{ 1, 0 }, { 1, 1 }, { 1, 2 }, { 1, 3 }
@@ -283,7 +310,7 @@ void faceProcY (std::array<const DMC_OctreeNode *, 2> nodes, VertexMap &vtx_map,
 	vertProc ({ sub[0], sub[1], sub[2], sub[3], sub[4], sub[5], sub[6], sub[7] }, vtx_map, mesh);
 }
 
-void faceProcZ (std::array<const DMC_OctreeNode *, 2> nodes, VertexMap &vtx_map, Mesh &mesh) {
+void faceProcZ (std::array<const DMC_OctreeNode *, 2> nodes, VertexMap &vtx_map, ComponentCuller &mesh) {
 	constexpr int subTable[8][2] = {
 		{ 0, 1 }, { 1, 0 }, { 0, 3 }, { 1, 2 },
 		{ 0, 5 }, { 1, 4 }, { 0, 7 }, { 1, 6 }
@@ -323,7 +350,7 @@ void faceProcZ (std::array<const DMC_OctreeNode *, 2> nodes, VertexMap &vtx_map,
 	vertProc ({ sub[0], sub[1], sub[2], sub[3], sub[4], sub[5], sub[6], sub[7] }, vtx_map, mesh);
 }
 
-void cellProc (const DMC_OctreeNode *node, VertexMap &vtx_map, Mesh &mesh) {
+void cellProc (const DMC_OctreeNode *node, VertexMap &vtx_map, ComponentCuller &mesh) {
 	assert (node);
 	if (!node->isSubdivided ())
 		return;
@@ -352,13 +379,15 @@ void cellProc (const DMC_OctreeNode *node, VertexMap &vtx_map, Mesh &mesh) {
 
 using namespace dmc_detail;
 
-Mesh DMC_Octree::contour () const {
-	Mesh mesh;
+Mesh DMC_Octree::contour (const ComponentCulling &culling) const {
+	Mesh result;
+	ComponentCuller mesh (result, culling);
 	VertexMap vertex_map;
 	cellProc (&m_root, vertex_map, mesh);
-	mesh.setGlobalPos (m_globalPos);
-	mesh.setGlobalScale (m_globalScale);
-	return mesh;
+	mesh.finish ();
+	result.setGlobalPos (m_globalPos);
+	result.setGlobalScale (m_globalScale);
+	return result;
 }
 
 void DMC_Octree::buildNode (DMC_OctreeNode *node, glm::ivec3 min_corner,
@@ -366,11 +395,14 @@ void DMC_Octree::buildNode (DMC_OctreeNode *node, glm::ivec3 min_corner,
 	assert (node);
 	if (size == 1) {
 		generateDualVertex (node, min_corner, size, args);
+		addLeafProgress (args.control, size);
 		return;
 	}
+	checkCancelled (args.control);
 	if (args.use_early_split_stop) {
 		if (shouldStopSplitting (min_corner, size, args)) {
 			generateDualVertex (node, min_corner, size, args);
+			addLeafProgress (args.control, size);
 			return;
 		}
 	}
@@ -385,12 +417,15 @@ void DMC_Octree::buildNode (DMC_OctreeNode *node, glm::ivec3 min_corner,
 			return;
 		}
 		generateDualVertex (node, min_corner, size, args);
+		addLeafProgress (args.control, size);
 	}
 	else {
 		// Perform dual vertex generation only after some unconditional subdivison
 		if (size * 8 < m_rootSize)
-			if (generateDualVertex (node, min_corner, size, args))
+			if (generateDualVertex (node, min_corner, size, args)) {
+				addLeafProgress (args.control, size);
 				return;
+			}
 		node->subdivide ();
 		int32_t child_size = size / 2;
 		for (int i = 0; i < 8; i++) {
@@ -408,21 +443,62 @@ bool DMC_Octree::generateDualVertex (DMC_OctreeNode *node, glm::ivec3 min_corner
 	const glm::vec3 base_point { min_corner };
 	solver.reset ();
 	glm::dvec3 avg_normal { 0 };
+	auto addSample = [&] (const glm::vec3 &offset) {
+		glm::vec3 point_local = base_point + offset;
+		glm::dvec3 point_global = localToGlobal (point_local);
+		double value_global = field (point_global);
+		float value_local = float (value_global / m_globalScale);
+		glm::dvec3 grad = field.grad (point_global);
+		glm::vec4 point_4d { point_local, value_local };
+		glm::vec4 normal_4d { grad, -1.0f };
+		solver.addPlane (point_4d, normal_4d);
+		avg_normal += grad;
+	};
+	// Tries vertex on the surface first (W = 0), then anywhere in the node
+	glm::vec4 vertex;
+	float error;
+	auto solveVertex = [&] () {
+		glm::vec4 lower_bound (min_corner, 0);
+		glm::vec4 upper_bound (min_corner + size, 0);
+		vertex = solver.solve (lower_bound, upper_bound);
+		error = solver.eval (vertex);
+		if (error > args.epsilon) {
+			// Solver keeps its decomposition, so retrying with free W is cheap
+			lower_bound.w = std::numeric_limits<float>::lowest ();
+			upper_bound.w = std::numeric_limits<float>::max ();
+			vertex = solver.solve (lower_bound, upper_bound);
+			error = solver.eval (vertex);
+		}
+	};
 
 	if (args.use_random_sampling) {
 		const int points_cnt = int (6.0 * glm::sqrt (size));
 		std::uniform_real_distribution<float> odist (0, float (size));
-		for (int i = 0; i < points_cnt; i++) {
-			glm::vec3 offset (odist (args.rng), odist (args.rng), odist (args.rng));
-			glm::vec3 point_local = base_point + offset;
-			glm::dvec3 point_global = localToGlobal (point_local);
-			double value_global = field (point_global);
-			float value_local = float (value_global / m_globalScale);
-			glm::dvec3 grad = field.grad (point_global);
-			glm::vec4 point_4d { point_local, value_local };
-			glm::vec4 normal_4d { grad, -1.0f };
-			solver.addPlane (point_4d, normal_4d);
-			avg_normal += grad;
+		// Cranley-Patterson rotation makes Halton points differ between nodes
+		glm::vec3 shift (0);
+		if (m_lowDiscrepancySampling)
+			shift = glm::vec3 (odist (args.rng), odist (args.rng), odist (args.rng));
+		auto sampleOffset = [&] (int i) {
+			if (!m_lowDiscrepancySampling)
+				return glm::vec3 (odist (args.rng), odist (args.rng), odist (args.rng));
+			glm::vec3 offset = shift + float (size) * haltonPoint (uint32_t (i + 1));
+			for (int k = 0; k < 3; k++)
+				if (offset[k] >= float (size))
+					offset[k] -= float (size);
+			return offset;
+		};
+		int added = 0;
+		int target = m_adaptiveSampling ? glm::min (kAdaptiveInitialSamples, points_cnt) : points_cnt;
+		while (true) {
+			for (; added < target; added++)
+				addSample (sampleOffset (added));
+			solveVertex ();
+			if (added == points_cnt || error > args.epsilon)
+				break;
+			// Error is roughly proportional to the sample count
+			if (error * float (points_cnt) <= kAdaptiveAcceptFraction * args.epsilon * float (added))
+				break;
+			target = glm::min (2 * added, points_cnt);
 		}
 	}
 	else {
@@ -438,31 +514,12 @@ bool DMC_Octree::generateDualVertex (DMC_OctreeNode *node, glm::ivec3 min_corner
 			glm::vec3 (max_offset, max_offset, min_offset),
 			glm::vec3 (max_offset, max_offset, max_offset)
 		};
-		const int points_cnt = int (sizeof (sample_offset_table) / sizeof (sample_offset_table[0]));
-		for (int i = 0; i < points_cnt; i++) {
-			glm::vec3 point_local = base_point + sample_offset_table[i];
-			glm::dvec3 point_global = localToGlobal (point_local);
-			double value_global = field (point_global);
-			float value_local = float (value_global / m_globalScale);
-			glm::dvec3 grad = field.grad (point_global);
-			glm::vec4 point_4d { point_local, value_local };
-			glm::vec4 normal_4d { grad, -1.0f };
-			solver.addPlane (point_4d, normal_4d);
-			avg_normal += grad;
-		}
+		for (const auto &offset : sample_offset_table)
+			addSample (offset);
+		solveVertex ();
 	}
 
 	node->normal = glm::vec3 (glm::normalize (avg_normal));
-	glm::vec4 lower_bound (min_corner, 0);
-	glm::vec4 upper_bound (min_corner + size, 0);
-	glm::vec4 vertex = solver.solve (lower_bound, upper_bound);
-	float error = solver.eval (vertex);
-	if (error > args.epsilon) {
-		lower_bound.w = std::numeric_limits<float>::lowest ();
-		upper_bound.w = std::numeric_limits<float>::max ();
-		vertex = solver.solve (lower_bound, upper_bound);
-		error = solver.eval (vertex);
-	}
 	node->dualVertex = vertex;
 	glm::dvec3 vertex_global = localToGlobal (vertex);
 	//node->normal = glm::vec3 (glm::normalize (field.grad (vertex_global)));
@@ -1,16 +1,71 @@
 /* This file is part of Isomesh library, released under MIT license.
   Copyright (c) 2018-2019 Pavel Asyutchenko (sventeam@yandex.ru) */
 #include <isomesh/data/grid.hpp>
+#include <isomesh/util/tables.hpp>
 
 #include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <fstream>
 #include <stdexcept>
+#include <tuple>
+#include <type_traits>
 
 namespace isomesh
 {
 
-UniformGrid::UniformGrid (uint32_t size, const glm::dvec3 &globalPos, double gridStep) :
-	m_size (size), m_halfSize (int32_t (size) / 2), m_globalPos (globalPos), m_gridStep (gridStep) {
+namespace grid_detail
+{
+
+/* Numbers of an edge in its adjacent cells, listed in the same order
+ as UniformGrid::adjacentCellsForEdge returns the cells */
+constexpr uint8_t kEdgeNumberInCell[3][4] = {
+	{ 3, 1, 0, 2 },   // X
+	{ 7, 6, 4, 5 },   // Y
+	{ 11, 10, 8, 9 }  // Z
+};
+
+// Allowed mismatch of boundary plane step and position, relative to the grid step
+constexpr double kPlaneTolerance = 1e-6;
+
+// Axes spanning boundary planes orthogonal to X, Y and Z, in the order of plane points storage
+constexpr int kPlaneAxes[3][2] = { { 1, 2 }, { 0, 2 }, { 1, 0 } };
+
+// Tiled layout brick size (along each axis), must be a power of two
+constexpr uint32_t kBrickSize = 4;
+constexpr uint32_t kBrickVolume = kBrickSize * kBrickSize * kBrickSize;
+
+/* Grid file starts with this header, followed by materials (padded to a multiple
+ of 8 bytes to keep edges aligned) and arrays of X, Y and Z edges */
+struct FileHeader {
+	char magic[8];
+	uint32_t version;
+	// Record sizes, file is readable only on platforms where they match
+	uint32_t headerSize;
+	uint32_t edgeSize;
+	uint32_t gridSize;
+	uint32_t layout;
+	uint32_t flags;
+	double globalPos[3];
+	double gridStep;
+	uint64_t edgeCount[3];
+};
+
+constexpr char kFileMagic[8] = { 'I', 'S', 'O', 'G', 'R', 'I', 'D', '\0' };
+constexpr uint32_t kFileVersion = 1;
+// Set in flags if surface cells were tracked
+constexpr uint32_t kFileSurfaceCells = 1;
+
+static_assert (std::is_trivially_copyable<UniformGridEdge>::value, "Edges must be trivially copyable to be saved");
+
+size_t alignedMaterialsSize (uint32_t data_size) noexcept { return (size_t (data_size) + 7) & ~size_t (7); }
+
+}
+
+using namespace grid_detail;
+
+UniformGrid::UniformGrid (uint32_t size, const glm::dvec3 &globalPos, double gridStep, UniformGridLayout layout) :
+	m_size (size), m_halfSize (int32_t (size) / 2), m_layout (layout), m_globalPos (globalPos), m_gridStep (gridStep) {
 	if (size < 2)
 		throw std::invalid_argument ("Grid size should be at least two");
 	if (size & (size - 1))
@@ -18,43 +73,162 @@ UniformGrid::UniformGrid (uint32_t size, const glm::dvec3 &globalPos, double gri
 	if (size > 1024)
 		throw std::length_error ("Too large grid size (> 1024)");
 
-	m_mat.reset (new Material[(size + 1) * (size + 1) * (size + 1)]);
+	// Strides along X, Y and Z axes (between points for linear layout, between bricks for tiled)
+	uint32_t points = size + 1;
+	uint32_t row = (layout == UniformGridLayout::Tiled) ? (points + kBrickSize - 1) / kBrickSize : points;
+	uint32_t unit = (layout == UniformGridLayout::Tiled) ? kBrickVolume : 1;
+	const uint32_t strides[3] = { row * unit, row * row * unit, unit };
+	// Strides between points inside a brick
+	const uint32_t inner_strides[3] = { kBrickSize, kBrickSize * kBrickSize, 1 };
+	for (int axis = 0; axis < 3; axis++) {
+		m_axisOffset[axis].resize (points);
+		for (uint32_t i = 0; i < points; i++) {
+			if (layout == UniformGridLayout::Tiled)
+				m_axisOffset[axis][i] = i / kBrickSize * strides[axis] + i % kBrickSize * inner_strides[axis];
+			else m_axisOffset[axis][i] = i * strides[axis];
+		}
+	}
+	m_dataSize = row * row * row * unit;
+	// Padding must have valid materials too
+	m_mat.reset (new Material[m_dataSize] ());
 }
 
-void UniformGrid::fill (const ScalarField &f, const ZeroFinder &solver) {
+void UniformGrid::fill (const ScalarField &f, const ZeroFinder &solver, JobControl *control) {
+	fill (f, solver, {}, {}, control);
+}
+
+void UniformGrid::fill (const ScalarField &f, const ZeroFinder &solver,
+                        const std::array<const UniformGridBoundary *, 6> &imported,
+                        const std::array<UniformGridBoundary *, 6> &exported, JobControl *control) {
+	const size_t plane_points = size_t (m_size + 1) * size_t (m_size + 1);
+	// Global position of the center of a face plane
+	auto planeOrigin = [this] (int face) {
+		glm::dvec3 p (0.0);
+		p[face / 2] = (face & 1) ? m_halfSize : -m_halfSize;
+		return localToGlobal (p);
+	};
+	const double tolerance = kPlaneTolerance * m_gridStep;
+	for (int face = 0; face < 6; face++) {
+		const UniformGridBoundary *plane = imported[face];
+		if (!plane)
+			continue;
+		if (plane->axis != face / 2 || plane->size != m_size ||
+		    plane->values.size () != plane_points || plane->materials.size () != plane_points)
+			throw std::invalid_argument ("Boundary plane doesn't match grid face");
+		glm::dvec3 origin_delta = glm::abs (plane->origin - planeOrigin (face));
+		if (glm::abs (plane->step - m_gridStep) > tolerance ||
+		    origin_delta.x > tolerance || origin_delta.y > tolerance || origin_delta.z > tolerance)
+			throw std::invalid_argument ("Boundary plane doesn't lie on grid face");
+	}
+	// One work unit is one Y slab of a pass (sampling or edges along one axis)
+	auto finishSlab = [control] () {
+		if (control) {
+			control->addProgress (1);
+			control->checkCancelled ();
+		}
+	};
+	// Slabs lying on imported planes are skipped
+	auto skipSlabs = [control] (int32_t count) {
+		if (control && count > 0)
+			control->addProgress (uint64_t (count));
+	};
+	if (control) {
+		control->checkCancelled ();
+		control->resetProgress (4 * uint64_t (m_size + 1));
+	}
+	// Values are stored in the same layout as materials
 	std::vector<double> values (dataSize ());
-	// Compute function values over the whole grid
-	uint32_t idx = 0;
-	glm::dvec3 lowest_point = localToGlobal (glm::dvec3 (-m_halfSize));
+	// Per-axis index offsets, indexed by local coordinates
+	const uint32_t *offset_x = m_axisOffset[0].data () + m_halfSize;
+	const uint32_t *offset_y = m_axisOffset[1].data () + m_halfSize;
+	const uint32_t *offset_z = m_axisOffset[2].data () + m_halfSize;
+	// Copy points of imported planes, the rest of points lie inside [first; last] box
+	glm::ivec3 first (-m_halfSize), last (m_halfSize);
+	for (int face = 0; face < 6; face++) {
+		const UniformGridBoundary *plane = imported[face];
+		if (!plane)
+			continue;
+		const int axis = face / 2;
+		if (face & 1)
+			last[axis] = m_halfSize - 1;
+		else first[axis] = -m_halfSize + 1;
+		glm::ivec3 p;
+		p[axis] = (face & 1) ? m_halfSize : -m_halfSize;
+		size_t plane_idx = 0;
+		for (p[kPlaneAxes[axis][0]] = -m_halfSize; p[kPlaneAxes[axis][0]] <= m_halfSize; p[kPlaneAxes[axis][0]]++) {
+			for (p[kPlaneAxes[axis][1]] = -m_halfSize; p[kPlaneAxes[axis][1]] <= m_halfSize; p[kPlaneAxes[axis][1]]++) {
+				uint32_t idx = offset_y[p.y] + offset_x[p.x] + offset_z[p.z];
+				values[idx] = plane->values[plane_idx];
+				m_mat[idx] = plane->materials[plane_idx];
+				plane_idx++;
+			}
+		}
+	}
+	// Compute function values over the rest of the grid
+	glm::dvec3 lowest_point = localToGlobal (glm::dvec3 (first));
 	glm::dvec3 call_pos = lowest_point;
-	for (int32_t y = -m_halfSize; y <= m_halfSize; y++) {
+	skipSlabs (first.y + m_halfSize);
+	for (int32_t y = first.y; y <= last.y; y++) {
 		call_pos.x = lowest_point.x;
-		for (int32_t x = -m_halfSize; x <= m_halfSize; x++) {
+		for (int32_t x = first.x; x <= last.x; x++) {
 			call_pos.z = lowest_point.z;
-			for (int32_t z = -m_halfSize; z <= m_halfSize; z++) {
+			for (int32_t z = first.z; z <= last.z; z++) {
+				uint32_t idx = offset_y[y] + offset_x[x] + offset_z[z];
 				values[idx] = f (call_pos);
 				if (values[idx] > 0)
 					m_mat[idx] = Material::Empty;
 				else
 					m_mat[idx] = f.material (call_pos, values[idx]);
-				idx++;
 				call_pos.z += m_gridStep;
 			}
 			call_pos.x += m_gridStep;
 		}
 		call_pos.y += m_gridStep;
+		finishSlab ();
 	}
+	skipSlabs (m_halfSize - last.y);
+	/* Adds in-plane edges along given axis from imported planes. An edge lying on
+	 two imported planes is taken from the first one. Storage is sorted afterwards */
+	auto importEdges = [&] (UniformGridEdgeStorage &storage, int edgeAxis) {
+		bool added = false;
+		for (int face = 0; face < 6; face++) {
+			const UniformGridBoundary *plane = imported[face];
+			const int axis = face / 2;
+			if (!plane || axis == edgeAxis)
+				continue;
+			glm::ivec3 shift (0);
+			shift[axis] = (face & 1) ? m_halfSize : -m_halfSize;
+			for (const auto &plane_edge : plane->edges[edgeAxis]) {
+				UniformGridEdge edge = plane_edge.translated (shift);
+				glm::ivec3 p = edge.lesserEndpoint ();
+				bool taken = false;
+				for (int prev = 0; prev < face && !taken; prev++) {
+					int prev_axis = prev / 2;
+					if (imported[prev] && prev_axis != axis && prev_axis != edgeAxis)
+						taken = (p[prev_axis] == ((prev & 1) ? m_halfSize : -m_halfSize));
+				}
+				if (!taken) {
+					storage.addEdge (edge);
+					added = true;
+				}
+			}
+		}
+		if (added)
+			storage.sortEdges ();
+	};
 	/* Find zero intersections on grid edges.
 	 Different signs on edge endpoints means there is at least
 	 one zero intersection on this edge. We assume that there is
-	 exactly one and find it using the provided solver. */
+	 exactly one and find it using the provided solver.
+	 Edges lying on imported planes are not searched for. */
 	// Along X
 	m_edgeX.clear ();
-	uint32_t idx1 = 0;
-	uint32_t idx2 = m_size + 1;
-	for (int32_t y = -m_halfSize; y <= m_halfSize; y++) {
+	skipSlabs (first.y + m_halfSize);
+	for (int32_t y = first.y; y <= last.y; y++) {
 		for (int32_t x = -m_halfSize; x < m_halfSize; x++) { // x < -m_halfSize, this is intended
-			for (int32_t z = -m_halfSize; z <= m_halfSize; z++) {
+			for (int32_t z = first.z; z <= last.z; z++) {
+				uint32_t idx1 = offset_y[y] + offset_x[x] + offset_z[z];
+				uint32_t idx2 = offset_y[y] + offset_x[x + 1] + offset_z[z];
 				bool sign1 = (values[idx1] <= 0.0);
 				bool sign2 = (values[idx2] <= 0.0);
 				if (sign1 != sign2) {
@@ -67,20 +241,19 @@ void UniformGrid::fill (const ScalarField &f, const ZeroFinder &solver) {
 					Material mat = sign1 ? m_mat[idx1] : m_mat[idx2];
 					m_edgeX.addEdge (x, y, z, grad, offset, 0, sign1, mat);
 				}
-				idx1++;
-				idx2++;
 			}
 		}
-		idx1 += m_size + 1;
-		idx2 += m_size + 1;
+		finishSlab ();
 	}
+	skipSlabs (m_halfSize - last.y);
+	importEdges (m_edgeX, 0);
 	// Along Y
 	m_edgeY.clear ();
-	idx1 = 0;
-	idx2 = (m_size + 1) * (m_size + 1);
 	for (int32_t y = -m_halfSize; y < m_halfSize; y++) { // y < -m_halfSize, this is intended
-		for (int32_t x = -m_halfSize; x <= m_halfSize; x++) {
-			for (int32_t z = -m_halfSize; z <= m_halfSize; z++) {
+		for (int32_t x = first.x; x <= last.x; x++) {
+			for (int32_t z = first.z; z <= last.z; z++) {
+				uint32_t idx1 = offset_y[y] + offset_x[x] + offset_z[z];
+				uint32_t idx2 = offset_y[y + 1] + offset_x[x] + offset_z[z];
 				bool sign1 = (values[idx1] <= 0.0);
 				bool sign2 = (values[idx2] <= 0.0);
 				if (sign1 != sign2) {
@@ -93,18 +266,21 @@ void UniformGrid::fill (const ScalarField &f, const ZeroFinder &solver) {
 					Material mat = sign1 ? m_mat[idx1] : m_mat[idx2];
 					m_edgeY.addEdge (x, y, z, grad, offset, 1, sign1, mat);
 				}
-				idx1++;
-				idx2++;
 			}
 		}
+		finishSlab ();
 	}
+	// The last slab has no Y edges
+	finishSlab ();
+	importEdges (m_edgeY, 1);
 	// Along Z
 	m_edgeZ.clear ();
-	idx1 = 0;
-	idx2 = 1;
-	for (int32_t y = -m_halfSize; y <= m_halfSize; y++) {
-		for (int32_t x = -m_halfSize; x <= m_halfSize; x++) {
+	skipSlabs (first.y + m_halfSize);
+	for (int32_t y = first.y; y <= last.y; y++) {
+		for (int32_t x = first.x; x <= last.x; x++) {
 			for (int32_t z = -m_halfSize; z < m_halfSize; z++) { // z < -m_halfSize, this is intended
+				uint32_t idx1 = offset_y[y] + offset_x[x] + offset_z[z];
+				uint32_t idx2 = offset_y[y] + offset_x[x] + offset_z[z + 1];
 				bool sign1 = (values[idx1] <= 0.0);
 				bool sign2 = (values[idx2] <= 0.0);
 				if (sign1 != sign2) {
@@ -117,15 +293,406 @@ void UniformGrid::fill (const ScalarField &f, const ZeroFinder &solver) {
 					Material mat = sign1 ? m_mat[idx1] : m_mat[idx2];
 					m_edgeZ.addEdge (x, y, z, grad, offset, 2, sign1, mat);
 				}
-				idx1++;
-				idx2++;
 			}
-			idx1++;
-			idx2++;
 		}
+		finishSlab ();
+	}
+	skipSlabs (m_halfSize - last.y);
+	importEdges (m_edgeZ, 2);
+	// Export boundary planes
+	const UniformGridEdgeStorage *storages[3] = { &m_edgeX, &m_edgeY, &m_edgeZ };
+	for (int face = 0; face < 6; face++) {
+		UniformGridBoundary *plane = exported[face];
+		if (!plane)
+			continue;
+		const int axis = face / 2;
+		const int32_t coord = (face & 1) ? m_halfSize : -m_halfSize;
+		plane->axis = axis;
+		plane->size = m_size;
+		plane->step = m_gridStep;
+		plane->origin = planeOrigin (face);
+		plane->values.resize (plane_points);
+		plane->materials.resize (plane_points);
+		glm::ivec3 p;
+		p[axis] = coord;
+		size_t plane_idx = 0;
+		for (p[kPlaneAxes[axis][0]] = -m_halfSize; p[kPlaneAxes[axis][0]] <= m_halfSize; p[kPlaneAxes[axis][0]]++) {
+			for (p[kPlaneAxes[axis][1]] = -m_halfSize; p[kPlaneAxes[axis][1]] <= m_halfSize; p[kPlaneAxes[axis][1]]++) {
+				uint32_t idx = offset_y[p.y] + offset_x[p.x] + offset_z[p.z];
+				plane->values[plane_idx] = values[idx];
+				plane->materials[plane_idx] = m_mat[idx];
+				plane_idx++;
+			}
+		}
+		glm::ivec3 shift (0);
+		shift[axis] = -coord;
+		for (int edge_axis = 0; edge_axis < 3; edge_axis++) {
+			plane->edges[edge_axis].clear ();
+			if (edge_axis == axis)
+				continue;
+			for (const auto &edge : *storages[edge_axis])
+				if (edge.lesserEndpoint ()[axis] == coord)
+					plane->edges[edge_axis].push_back (edge.translated (shift));
+		}
+	}
+	if (m_trackSurfaceCells)
+		buildSurfaceCells ();
+}
+
+void UniformGrid::refill (const ScalarField &f, const ZeroFinder &solver,
+                          const glm::ivec3 &minPoint, const glm::ivec3 &maxPoint) {
+	glm::ivec3 box_min = glm::max (minPoint, glm::ivec3 (-m_halfSize));
+	glm::ivec3 box_max = glm::min (maxPoint, glm::ivec3 (m_halfSize));
+	if (box_min.x > box_max.x || box_min.y > box_max.y || box_min.z > box_max.z)
+		return;
+	// Sample the box extended by one point, as edges crossing its border are recomputed too
+	glm::ivec3 ext_min = glm::max (box_min - 1, glm::ivec3 (-m_halfSize));
+	glm::ivec3 ext_max = glm::min (box_max + 1, glm::ivec3 (m_halfSize));
+	glm::ivec3 ext_size = ext_max - ext_min + 1;
+	auto extIndex = [&] (const glm::ivec3 &p) {
+		return uint32_t (((p.y - ext_min.y) * ext_size.x + (p.x - ext_min.x)) * ext_size.z + (p.z - ext_min.z));
+	};
+	std::vector<double> values (size_t (ext_size.x) * size_t (ext_size.y) * size_t (ext_size.z));
+	for (int32_t y = ext_min.y; y <= ext_max.y; y++) {
+		for (int32_t x = ext_min.x; x <= ext_max.x; x++) {
+			for (int32_t z = ext_min.z; z <= ext_max.z; z++) {
+				glm::ivec3 p (x, y, z);
+				glm::dvec3 call_pos = localToGlobal (glm::dvec3 (p));
+				double value = f (call_pos);
+				values[extIndex (p)] = value;
+				if (x < box_min.x || x > box_max.x || y < box_min.y || y > box_max.y || z < box_min.z || z > box_max.z)
+					continue;
+				if (value > 0)
+					m_mat[pointToIndex (p)] = Material::Empty;
+				else
+					m_mat[pointToIndex (p)] = f.material (call_pos, value);
+			}
+		}
+	}
+	UniformGridEdgeStorage *storages[3] = { &m_edgeX, &m_edgeY, &m_edgeZ };
+	const size_t old_edge_count[3] = { m_edgeX.size (), m_edgeY.size (), m_edgeZ.size () };
+	std::vector<UniformGridEdge> edges;
+	for (int axis = 0; axis < 3; axis++) {
+		// Lesser endpoints of edges touching the box
+		glm::ivec3 edge_min = box_min;
+		glm::ivec3 edge_max = box_max;
+		edge_min[axis] = glm::max (edge_min[axis] - 1, -m_halfSize);
+		edge_max[axis] = glm::min (edge_max[axis], m_halfSize - 1);
+		glm::ivec3 step (0);
+		step[axis] = 1;
+		edges.clear ();
+		// YXZ traversal keeps new edges sorted
+		for (int32_t y = edge_min.y; y <= edge_max.y; y++) {
+			for (int32_t x = edge_min.x; x <= edge_max.x; x++) {
+				for (int32_t z = edge_min.z; z <= edge_max.z; z++) {
+					glm::ivec3 p1 (x, y, z);
+					glm::ivec3 p2 = p1 + step;
+					double value1 = values[extIndex (p1)];
+					double value2 = values[extIndex (p2)];
+					bool sign1 = (value1 <= 0.0);
+					bool sign2 = (value2 <= 0.0);
+					if (sign1 == sign2)
+						continue;
+					glm::dvec3 p = localToGlobal (glm::dvec3 (p1));
+					double c0 = p[axis];
+					double c1 = c0 + m_gridStep;
+					if (axis == 0)
+						p.x = solver.findAlongX (c0, p.y, p.z, c1, value1, value2, f);
+					else if (axis == 1)
+						p.y = solver.findAlongY (p.x, c0, p.z, c1, value1, value2, f);
+					else p.z = solver.findAlongZ (p.x, p.y, c0, c1, value1, value2, f);
+					glm::dvec3 grad = f.grad (p);
+					double offset = (p[axis] - c0) / m_gridStep;
+					Material mat = m_mat[pointToIndex (sign1 ? p1 : p2)];
+					edges.emplace_back (x, y, z, grad, offset, axis, sign1, mat);
+				}
+			}
+		}
+		storages[axis]->replaceEdges (edge_min, edge_max, edges);
+	}
+	// Only cells adjacent to replaced edges change, but edge positions in storages have shifted
+	if (m_trackSurfaceCells)
+		updateSurfaceCells (glm::max (box_min - 1, glm::ivec3 (-m_halfSize)),
+		                    glm::min (box_max, glm::ivec3 (m_halfSize - 1)), old_edge_count);
+}
+
+UniformGrid UniformGrid::downsample () const {
+	if (m_size < 4)
+		throw std::invalid_argument ("Grid is too small to downsample");
+	UniformGrid G (m_size / 2, m_globalPos, 2.0 * m_gridStep, m_layout);
+	const int32_t half = G.m_halfSize;
+	for (int32_t y = -half; y <= half; y++)
+		for (int32_t x = -half; x <= half; x++)
+			for (int32_t z = -half; z <= half; z++)
+				G.m_mat[G.pointToIndex (x, y, z)] = m_mat[pointToIndex (2 * x, 2 * y, 2 * z)];
+	const UniformGridEdgeStorage *fine_storages[3] = { &m_edgeX, &m_edgeY, &m_edgeZ };
+	UniformGridEdgeStorage *storages[3] = { &G.m_edgeX, &G.m_edgeY, &G.m_edgeZ };
+	for (int axis = 0; axis < 3; axis++) {
+		const int axis1 = (axis + 1) % 3;
+		const int axis2 = (axis + 2) % 3;
+		for (const auto &edge : *fine_storages[axis]) {
+			glm::ivec3 p = edge.lesserEndpoint ();
+			// Skip edges not lying on coarse grid lines
+			if ((p[axis1] & 1) || (p[axis2] & 1))
+				continue;
+			// Endpoints of the coarse edge containing this one
+			glm::ivec3 c1 = p;
+			c1[axis] -= (p[axis] & 1);
+			glm::ivec3 c2 = c1;
+			c2[axis] += 2;
+			Material mat1 = m_mat[pointToIndex (c1)];
+			Material mat2 = m_mat[pointToIndex (c2)];
+			bool solid1 = (mat1 != Material::Empty);
+			// The surface crosses both halves of the coarse edge (or neither of them)
+			if (solid1 == (mat2 != Material::Empty))
+				continue;
+			double offset = 0.5 * (double (edge.surfacePoint ()[axis]) - c1[axis]);
+			storages[axis]->addEdge (c1.x / 2, c1.y / 2, c1.z / 2, glm::dvec3 (edge.surfaceNormal ()),
+			                         offset, axis, solid1, solid1 ? mat1 : mat2);
+		}
+		/* Both halves of a coarse edge map to the same coarse coordinate along its axis,
+		 so YXZ order of fine edges is not preserved for X and Y edges */
+		storages[axis]->sortEdges ();
+	}
+	if (m_trackSurfaceCells)
+		G.trackSurfaceCells (true);
+	return G;
+}
+
+void UniformGrid::save (const std::string &path) const {
+	FileHeader header {};
+	std::copy (std::begin (kFileMagic), std::end (kFileMagic), header.magic);
+	header.version = kFileVersion;
+	header.headerSize = uint32_t (sizeof (FileHeader));
+	header.edgeSize = uint32_t (sizeof (UniformGridEdge));
+	header.gridSize = m_size;
+	header.layout = uint32_t (m_layout);
+	header.flags = m_trackSurfaceCells ? kFileSurfaceCells : 0;
+	for (int i = 0; i < 3; i++)
+		header.globalPos[i] = m_globalPos[i];
+	header.gridStep = m_gridStep;
+	const UniformGridEdgeStorage *storages[3] = { &m_edgeX, &m_edgeY, &m_edgeZ };
+	size_t file_size = sizeof (FileHeader) + alignedMaterialsSize (m_dataSize);
+	for (int i = 0; i < 3; i++) {
+		header.edgeCount[i] = storages[i]->size ();
+		file_size += storages[i]->size () * sizeof (UniformGridEdge);
+	}
+	// Assemble the whole file in memory to write it at once
+	std::vector<char> buffer (file_size, 0);
+	char *ptr = buffer.data ();
+	std::memcpy (ptr, &header, sizeof (FileHeader));
+	ptr += sizeof (FileHeader);
+	std::memcpy (ptr, m_mat.get (), m_dataSize);
+	ptr += alignedMaterialsSize (m_dataSize);
+	for (int i = 0; i < 3; i++) {
+		size_t bytes = storages[i]->size () * sizeof (UniformGridEdge);
+		if (bytes > 0)
+			std::memcpy (ptr, storages[i]->data (), bytes);
+		ptr += bytes;
+	}
+	std::ofstream file (path, std::ios::binary | std::ios::trunc);
+	if (!file.write (buffer.data (), std::streamsize (buffer.size ())))
+		throw std::runtime_error ("Failed to write grid file '" + path + "'");
+}
+
+UniformGrid UniformGrid::load (const std::string &path) {
+	std::ifstream file (path, std::ios::binary | std::ios::ate);
+	if (!file)
+		throw std::runtime_error ("Failed to open grid file '" + path + "'");
+	std::streamoff file_size = file.tellg ();
+	file.seekg (0);
+	// Read the whole file at once, vector storage is aligned enough for the header and edges
+	std::vector<char> buffer (size_t (std::max<std::streamoff> (file_size, 0)));
+	if (file_size < std::streamoff (sizeof (FileHeader)) || !file.read (buffer.data (), file_size))
+		throw std::runtime_error ("Failed to read grid file '" + path + "'");
+	FileHeader header;
+	std::memcpy (&header, buffer.data (), sizeof (FileHeader));
+	if (!std::equal (std::begin (kFileMagic), std::end (kFileMagic), header.magic))
+		throw std::runtime_error ("File '" + path + "' is not a grid file");
+	if (header.version != kFileVersion || header.headerSize != sizeof (FileHeader) ||
+	    header.edgeSize != sizeof (UniformGridEdge))
+		throw std::runtime_error ("Grid file '" + path + "' has incompatible version or platform");
+	if (header.gridSize < 2 || header.gridSize > 1024 || (header.gridSize & (header.gridSize - 1)) ||
+	    header.layout > uint32_t (UniformGridLayout::Tiled))
+		throw std::runtime_error ("Grid file '" + path + "' is damaged");
+	UniformGrid G (header.gridSize, glm::dvec3 (header.globalPos[0], header.globalPos[1], header.globalPos[2]),
+	               header.gridStep, UniformGridLayout (header.layout));
+	size_t expected_size = sizeof (FileHeader) + alignedMaterialsSize (G.m_dataSize);
+	for (int i = 0; i < 3; i++) {
+		// Each edge storage can't hold more edges than the grid has
+		if (header.edgeCount[i] > G.m_dataSize)
+			throw std::runtime_error ("Grid file '" + path + "' is damaged");
+		expected_size += size_t (header.edgeCount[i]) * sizeof (UniformGridEdge);
+	}
+	if (size_t (file_size) != expected_size)
+		throw std::runtime_error ("Grid file '" + path + "' is damaged");
+	const char *ptr = buffer.data () + sizeof (FileHeader);
+	std::memcpy (G.m_mat.get (), ptr, G.m_dataSize);
+	ptr += alignedMaterialsSize (G.m_dataSize);
+	UniformGridEdgeStorage *storages[3] = { &G.m_edgeX, &G.m_edgeY, &G.m_edgeZ };
+	std::vector<UniformGridEdge> edges;
+	for (int i = 0; i < 3; i++) {
+		size_t count = size_t (header.edgeCount[i]);
+		edges.resize (count);
+		std::memcpy (edges.data (), ptr, count * sizeof (UniformGridEdge));
+		ptr += count * sizeof (UniformGridEdge);
+		// Extraction trusts edges to lie inside the grid and be sorted without duplicates
+		for (size_t k = 0; k < count; k++) {
+			const UniformGridEdge &edge = edges[k];
+			if (edge.edgeAxis () != i || !G.isVertexInGrid (edge.lesserEndpoint ()) ||
+			    !G.isVertexInGrid (edge.biggerEndpoint ()))
+				throw std::runtime_error ("Grid file '" + path + "' is damaged");
+			if (k > 0) {
+				glm::ivec3 p = edges[k - 1].lesserEndpoint (), q = edge.lesserEndpoint ();
+				if (std::make_tuple (p.y, p.x, p.z) >= std::make_tuple (q.y, q.x, q.z))
+					throw std::runtime_error ("Grid file '" + path + "' is damaged");
+			}
+		}
+		storages[i]->assign (edges.data (), count);
+	}
+	if (header.flags & kFileSurfaceCells)
+		G.trackSurfaceCells (true);
+	return G;
+}
+
+void UniformGrid::trackSurfaceCells (bool value) {
+	m_trackSurfaceCells = value;
+	if (value)
+		buildSurfaceCells ();
+	else {
+		m_surfaceCells.clear ();
+		m_surfaceCells.shrink_to_fit ();
 	}
 }
 
+const UniformGridSurfaceCell *UniformGrid::findSurfaceCell (uint32_t cellIdx) const noexcept {
+	auto iter = std::lower_bound (m_surfaceCells.begin (), m_surfaceCells.end (), cellIdx,
+	                              [] (const UniformGridSurfaceCell &cell, uint32_t idx) { return cell.cellIndex < idx; });
+	if (iter == m_surfaceCells.end () || iter->cellIndex != cellIdx)
+		return nullptr;
+	return &*iter;
+}
+
+void UniformGrid::buildSurfaceCells () {
+	m_surfaceCells.clear ();
+	// Position of each cell in the list, cells are first marked and then numbered in index order
+	std::vector<uint32_t> slots (dataSize (), kBadIndex);
+	auto forEachEdge = [this] (auto &&func) {
+		for (uint32_t i = 0; i < m_edgeX.size (); i++)
+			func (0, i, adjacentCellsForEdge<0> (m_edgeX[i].lesserEndpoint ()));
+		for (uint32_t i = 0; i < m_edgeY.size (); i++)
+			func (1, i, adjacentCellsForEdge<1> (m_edgeY[i].lesserEndpoint ()));
+		for (uint32_t i = 0; i < m_edgeZ.size (); i++)
+			func (2, i, adjacentCellsForEdge<2> (m_edgeZ[i].lesserEndpoint ()));
+	};
+	forEachEdge ([&] (int, uint32_t, const std::array<uint32_t, 4> &cells) {
+		for (uint32_t cell : cells)
+			if (cell != kBadIndex)
+				slots[cell] = 0;
+	});
+	for (uint32_t i = 0; i < slots.size (); i++) {
+		if (slots[i] == kBadIndex)
+			continue;
+		slots[i] = uint32_t (m_surfaceCells.size ());
+		m_surfaceCells.emplace_back ();
+		UniformGridSurfaceCell &cell = m_surfaceCells.back ();
+		cell.cellIndex = i;
+		cell.edgeMask = 0;
+		std::fill (std::begin (cell.edgeIndex), std::end (cell.edgeIndex), kBadIndex);
+	}
+	forEachEdge ([&] (int axis, uint32_t edge_idx, const std::array<uint32_t, 4> &cells) {
+		for (int k = 0; k < 4; k++) {
+			if (cells[k] == kBadIndex)
+				continue;
+			UniformGridSurfaceCell &cell = m_surfaceCells[slots[cells[k]]];
+			int edge_number = kEdgeNumberInCell[axis][k];
+			cell.edgeMask |= uint16_t (1 << edge_number);
+			cell.edgeIndex[edge_number] = edge_idx;
+		}
+	});
+}
+
+void UniformGrid::updateSurfaceCells (const glm::ivec3 &minCell, const glm::ivec3 &maxCell,
+                                      const size_t oldEdgeCount[3]) {
+	const UniformGridEdgeStorage *storages[3] = { &m_edgeX, &m_edgeY, &m_edgeZ };
+	auto isInBox = [&] (const glm::ivec3 &p) {
+		return p.x >= minCell.x && p.y >= minCell.y && p.z >= minCell.z &&
+		       p.x <= maxCell.x && p.y <= maxCell.y && p.z <= maxCell.z;
+	};
+	auto cellLess = [] (const UniformGridSurfaceCell &a, const UniformGridSurfaceCell &b) {
+		return a.cellIndex < b.cellIndex;
+	};
+	m_surfaceCells.erase (std::remove_if (m_surfaceCells.begin (), m_surfaceCells.end (),
+		[&] (const UniformGridSurfaceCell &cell) { return isInBox (indexToPoint (cell.cellIndex)); }),
+		m_surfaceCells.end ());
+	/* Replaced edges have Y inside [minCell.y, maxCell.y + 1], which is a contiguous range of
+	 each storage. Edges below it keep their positions, edges above it are shifted by the change
+	 of storage size, and edges inside it (but outside the box) have to be found again */
+	for (auto &cell : m_surfaceCells) {
+		glm::ivec3 cell_pos = indexToPoint (cell.cellIndex);
+		if (cell_pos.y + 1 < minCell.y)
+			continue;
+		for (int i = 0; i < 12; i++) {
+			if (!(cell.edgeMask & (1 << i)))
+				continue;
+			int axis = kCellEdgeDirection[i];
+			glm::ivec3 p = cell_pos + kCellCornerOffset[kCellEdgeEndpoint[i][0]];
+			if (p.y > maxCell.y + 1)
+				cell.edgeIndex[i] = uint32_t (cell.edgeIndex[i] + storages[axis]->size () - oldEdgeCount[axis]);
+			else if (p.y >= minCell.y) {
+				auto iter = storages[axis]->findEdge (p.x, p.y, p.z);
+				assert (iter != storages[axis]->cend ());
+				cell.edgeIndex[i] = uint32_t (iter - storages[axis]->cbegin ());
+			}
+		}
+	}
+	// Rebuild cells inside the box from the edges of the same range
+	glm::ivec3 box_size = maxCell - minCell + 1;
+	auto boxIndex = [&] (const glm::ivec3 &p) {
+		return size_t ((p.y - minCell.y) * box_size.x + (p.x - minCell.x)) * size_t (box_size.z) + size_t (p.z - minCell.z);
+	};
+	std::vector<uint32_t> slots (size_t (box_size.x) * size_t (box_size.y) * size_t (box_size.z), kBadIndex);
+	auto forEachEdge = [&] (auto &&func) {
+		for (int axis = 0; axis < 3; axis++) {
+			const UniformGridEdgeStorage &storage = *storages[axis];
+			auto iter = std::partition_point (storage.cbegin (), storage.cend (),
+				[&] (const UniformGridEdge &e) { return e.lesserEndpoint ().y < minCell.y; });
+			for (; iter != storage.cend () && iter->lesserEndpoint ().y <= maxCell.y + 1; ++iter) {
+				glm::ivec3 p = iter->lesserEndpoint ();
+				for (int k = 0; k < 4; k++) {
+					int edge_number = kEdgeNumberInCell[axis][k];
+					glm::ivec3 cell_pos = p - kCellCornerOffset[kCellEdgeEndpoint[edge_number][0]];
+					if (isInBox (cell_pos))
+						func (edge_number, uint32_t (iter - storage.cbegin ()), cell_pos);
+				}
+			}
+		}
+	};
+	std::vector<UniformGridSurfaceCell> fresh;
+	forEachEdge ([&] (int, uint32_t, const glm::ivec3 &cell_pos) {
+		uint32_t &slot = slots[boxIndex (cell_pos)];
+		if (slot != kBadIndex)
+			return;
+		slot = 0;
+		fresh.emplace_back ();
+		UniformGridSurfaceCell &cell = fresh.back ();
+		cell.cellIndex = pointToIndex (cell_pos);
+		cell.edgeMask = 0;
+		std::fill (std::begin (cell.edgeIndex), std::end (cell.edgeIndex), kBadIndex);
+	});
+	// Box traversal order differs from index order with tiled layout
+	std::sort (fresh.begin (), fresh.end (), cellLess);
+	for (uint32_t i = 0; i < fresh.size (); i++)
+		slots[boxIndex (indexToPoint (fresh[i].cellIndex))] = i;
+	forEachEdge ([&] (int edge_number, uint32_t edge_idx, const glm::ivec3 &cell_pos) {
+		UniformGridSurfaceCell &cell = fresh[slots[boxIndex (cell_pos)]];
+		cell.edgeMask |= uint16_t (1 << edge_number);
+		cell.edgeIndex[edge_number] = edge_idx;
+	});
+	auto mid = m_surfaceCells.insert (m_surfaceCells.end (), fresh.begin (), fresh.end ());
+	std::inplace_merge (m_surfaceCells.begin (), mid, m_surfaceCells.end (), cellLess);
+}
+
 Material UniformGrid::at (int32_t x, int32_t y, int32_t z) const {
 	assert (isVertexInGrid ({ x, y, z }));
 	return m_mat[pointToIndex (x, y, z)];
@@ -141,14 +708,20 @@ Material UniformGrid::operator [] (const glm::ivec3 &v) const {
 
 uint32_t UniformGrid::pointToIndex (int32_t x, int32_t y, int32_t z) const noexcept {
 	assert (isVertexInGrid ({ x, y, z }));
-	uint32_t idx = uint32_t (y + m_halfSize) * (m_size + 1);
-	idx = (idx + uint32_t (x + m_halfSize)) * (m_size + 1);
-	idx += uint32_t (z + m_halfSize);
-	return idx;
+	return m_axisOffset[1][y + m_halfSize] + m_axisOffset[0][x + m_halfSize] + m_axisOffset[2][z + m_halfSize];
 }
 
 glm::ivec3 UniformGrid::indexToPoint (uint32_t idx) const noexcept {
-	assert (idx < (m_size + 1) * (m_size + 1) * (m_size + 1));
+	assert (idx < m_dataSize);
+	if (m_layout == UniformGridLayout::Tiled) {
+		const uint32_t row = (m_size + kBrickSize) / kBrickSize;
+		uint32_t brick = idx / kBrickVolume;
+		uint32_t inner = idx % kBrickVolume;
+		int32_t z = int32_t (brick % row * kBrickSize + inner % kBrickSize) - m_halfSize;
+		int32_t x = int32_t (brick / row % row * kBrickSize + inner / kBrickSize % kBrickSize) - m_halfSize;
+		int32_t y = int32_t (brick / row / row * kBrickSize + inner / (kBrickSize * kBrickSize)) - m_halfSize;
+		return glm::ivec3 (x, y, z);
+	}
 	int32_t z = int32_t (idx % (m_size + 1)) - m_halfSize;
 	idx /= (m_size + 1);
 	int32_t x = int32_t (idx % (m_size + 1)) - m_halfSize;
@@ -247,8 +820,8 @@ bool UniformGrid::isEdgeOnBorder<2> (const glm::ivec3 &edgePos) const noexcept {
 
 template<>
 std::array<uint32_t, 4> UniformGrid::adjacentCellsForEdge<0> (const glm::ivec3 &edgePos) const noexcept {
-	const uint32_t dy = (m_size + 1) * (m_size + 1);
-	const uint32_t dz = 1;
+	const uint32_t dy = backwardStep (1, edgePos.y);
+	const uint32_t dz = backwardStep (2, edgePos.z);
 	std::array<uint32_t, 4> cells;
 	cells[2] = pointToIndex (edgePos);
 	cells[0] = cells[2] - dy - dz;
@@ -267,8 +840,8 @@ std::array<uint32_t, 4> UniformGrid::adjacentCellsForEdge<0> (const glm::ivec3 &
 
 template<>
 std::array<uint32_t, 4> UniformGrid::adjacentCellsForEdge<1> (const glm::ivec3 &edgePos) const noexcept {
-	const uint32_t dx = (m_size + 1);
-	const uint32_t dz = 1;
+	const uint32_t dx = backwardStep (0, edgePos.x);
+	const uint32_t dz = backwardStep (2, edgePos.z);
 	std::array<uint32_t, 4> cells;
 	cells[2] = pointToIndex (edgePos);
 	cells[0] = cells[2] - dx - dz;
@@ -287,8 +860,8 @@ std::array<uint32_t, 4> UniformGrid::adjacentCellsForEdge<1> (const glm::ivec3 &
 
 template<>
 std::array<uint32_t, 4> UniformGrid::adjacentCellsForEdge<2> (const glm::ivec3 &edgePos) const noexcept {
-	const uint32_t dx = (m_size + 1);
-	const uint32_t dy = (m_size + 1) * (m_size + 1);
+	const uint32_t dx = backwardStep (0, edgePos.x);
+	const uint32_t dy = backwardStep (1, edgePos.y);
 	std::array<uint32_t, 4> cells;
 	cells[2] = pointToIndex (edgePos);
 	cells[0] = cells[2] - dx - dy;
@@ -384,6 +957,8 @@ bool UniformGrid::isCellOnBorder (const glm::ivec3 &cellPos) const noexcept {
 }
 
 std::array<uint32_t, 8> UniformGrid::adjacentVerticesForCell (uint32_t cellIdx) const noexcept {
+	if (m_layout != UniformGridLayout::Linear)
+		return adjacentVerticesForCell (indexToPoint (cellIdx));
 	const uint32_t dx = (m_size + 1);
 	const uint32_t dy = (m_size + 1) * (m_size + 1);
 	const uint32_t dz = 1;
@@ -400,6 +975,8 @@ std::array<uint32_t, 8> UniformGrid::adjacentVerticesForCell (uint32_t cellIdx)
 }
 
 std::array<Material, 8> UniformGrid::materialsOfCell (uint32_t cellIdx) const noexcept {
+	if (m_layout != UniformGridLayout::Linear)
+		return materialsOfCell (indexToPoint (cellIdx));
 	const uint32_t dx = (m_size + 1);
 	const uint32_t dy = (m_size + 1) * (m_size + 1);
 	const uint32_t dz = 1;
@@ -415,4 +992,27 @@ std::array<Material, 8> UniformGrid::materialsOfCell (uint32_t cellIdx) const no
 	return mats;
 }
 
+std::array<uint32_t, 8> UniformGrid::adjacentVerticesForCell (const glm::ivec3 &cellPos) const noexcept {
+	assert (isCellInGrid (cellPos));
+	// Offsets of lesser and greater cell corners along each axis
+	uint32_t ox[2], oy[2], oz[2];
+	for (int i = 0; i < 2; i++) {
+		ox[i] = m_axisOffset[0][cellPos.x + m_halfSize + i];
+		oy[i] = m_axisOffset[1][cellPos.y + m_halfSize + i];
+		oz[i] = m_axisOffset[2][cellPos.z + m_halfSize + i];
+	}
+	std::array<uint32_t, 8> vertices;
+	for (int i = 0; i < 8; i++)
+		vertices[i] = oy[i >> 2] + ox[(i >> 1) & 1] + oz[i & 1];
+	return vertices;
+}
+
+std::array<Material, 8> UniformGrid::materialsOfCell (const glm::ivec3 &cellPos) const noexcept {
+	auto vertices = adjacentVerticesForCell (cellPos);
+	std::array<Material, 8> mats;
+	for (int i = 0; i < 8; i++)
+		mats[i] = m_mat[vertices[i]];
+	return mats;
+}
+
 }
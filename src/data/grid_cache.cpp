@@ -0,0 +1,63 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+#include <isomesh/data/grid_cache.hpp>
+
+namespace isomesh
+{
+
+bool GridCache::put (const glm::ivec3 &key, const UniformGrid &grid) {
+	remove (key);
+	CompressedGrid compressed (grid);
+	size_t bytes = compressed.memoryUsage ();
+	if (bytes > m_budget)
+		return false;
+	evict (m_budget - bytes);
+	m_entries.push_front (Entry { key, std::move (compressed) });
+	m_index.emplace (key, m_entries.begin ());
+	m_usage += bytes;
+	return true;
+}
+
+std::unique_ptr<UniformGrid> GridCache::get (const glm::ivec3 &key) {
+	auto iter = m_index.find (key);
+	if (iter == m_index.end ()) {
+		m_stats.misses++;
+		return nullptr;
+	}
+	m_stats.hits++;
+	// Move the entry to the front of LRU list
+	m_entries.splice (m_entries.begin (), m_entries, iter->second);
+	return std::unique_ptr<UniformGrid> (new UniformGrid (iter->second->grid.decompress ()));
+}
+
+void GridCache::remove (const glm::ivec3 &key) noexcept {
+	auto iter = m_index.find (key);
+	if (iter == m_index.end ())
+		return;
+	m_usage -= iter->second->grid.memoryUsage ();
+	m_entries.erase (iter->second);
+	m_index.erase (iter);
+}
+
+void GridCache::clear () noexcept {
+	m_entries.clear ();
+	m_index.clear ();
+	m_usage = 0;
+}
+
+void GridCache::setMemoryBudget (size_t memoryBudget) noexcept {
+	m_budget = memoryBudget;
+	evict (m_budget);
+}
+
+void GridCache::evict (size_t budget) noexcept {
+	while (m_usage > budget) {
+		const Entry &entry = m_entries.back ();
+		m_usage -= entry.grid.memoryUsage ();
+		m_index.erase (entry.key);
+		m_entries.pop_back ();
+		m_stats.evictions++;
+	}
+}
+
+}
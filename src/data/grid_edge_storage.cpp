@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <cassert>
 #include <limits>
+#include <stdexcept>
 
 namespace isomesh
 {
@@ -56,6 +57,17 @@ glm::ivec3 UniformGridEdge::biggerEndpoint () const noexcept {
 	return point;
 }
 
+UniformGridEdge UniformGridEdge::translated (const glm::ivec3 &delta) const noexcept {
+	glm::ivec3 point = lesserEndpoint () + delta;
+	assert (point == glm::clamp (point, glm::ivec3 (std::numeric_limits<int16_t>::min ()),
+	                             glm::ivec3 (std::numeric_limits<int16_t>::max ())));
+	UniformGridEdge edge = *this;
+	edge.lesserX = int16_t (point.x);
+	edge.lesserY = int16_t (point.y);
+	edge.lesserZ = int16_t (point.z);
+	return edge;
+}
+
 bool UniformGridEdgeStorage::edgeLess (const UniformGridEdge &a, const UniformGridEdge &b) noexcept {
 	// Compare as (Y, X, Z) tuples
 	if (a.lesserY < b.lesserY)
@@ -73,6 +85,38 @@ void UniformGridEdgeStorage::sortEdges () noexcept {
 	std::sort (m_edges.begin (), m_edges.end (), edgeLess);
 }
 
+void UniformGridEdgeStorage::replaceEdges (const glm::ivec3 &minPoint, const glm::ivec3 &maxPoint,
+                                           const std::vector<UniformGridEdge> &edges) {
+	assert (std::is_sorted (edges.begin (), edges.end (), edgeLess));
+	constexpr int32_t max16 = std::numeric_limits<int16_t>::max ();
+	constexpr int32_t min16 = std::numeric_limits<int16_t>::min ();
+	// Edges with Y coordinate inside the box form a contiguous range
+	UniformGridEdge sample;
+	sample.lesserX = sample.lesserZ = int16_t (min16);
+	sample.lesserY = int16_t (glm::clamp (minPoint.y, min16, max16));
+	auto first = std::lower_bound (m_edges.begin (), m_edges.end (), sample, edgeLess);
+	sample.lesserX = sample.lesserZ = int16_t (max16);
+	sample.lesserY = int16_t (glm::clamp (maxPoint.y, min16, max16));
+	auto last = std::upper_bound (first, m_edges.end (), sample, edgeLess);
+	std::vector<UniformGridEdge> kept;
+	kept.reserve (size_t (last - first));
+	std::remove_copy_if (first, last, std::back_inserter (kept), [&] (const UniformGridEdge &e) {
+		return e.lesserX >= minPoint.x && e.lesserX <= maxPoint.x &&
+		       e.lesserY >= minPoint.y && e.lesserY <= maxPoint.y &&
+		       e.lesserZ >= minPoint.z && e.lesserZ <= maxPoint.z;
+	});
+	std::vector<UniformGridEdge> merged (kept.size () + edges.size ());
+	std::merge (kept.begin (), kept.end (), edges.begin (), edges.end (), merged.begin (), edgeLess);
+	auto pos = m_edges.erase (first, last);
+	m_edges.insert (pos, merged.begin (), merged.end ());
+}
+
+void UniformGridEdgeStorage::assign (const UniformGridEdge *edges, size_type count) {
+	if (!std::is_sorted (edges, edges + count, edgeLess))
+		throw std::invalid_argument ("Edges must be sorted");
+	m_edges.assign (edges, edges + count);
+}
+
 UniformGridEdgeStorage::iterator UniformGridEdgeStorage::findEdge
 	(int32_t x, int32_t y, int32_t z) noexcept {
 	constexpr int32_t max16 = std::numeric_limits<int16_t>::max ();
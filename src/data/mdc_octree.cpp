@@ -4,9 +4,13 @@
 #include <isomesh/util/material_filter.hpp>
 #include <isomesh/util/tables.hpp>
 
+#include "../private/component_culler.hpp"
 #include "../private/disjoint_set_union.hpp"
+#include "../private/worker_pool.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <exception>
 
 namespace isomesh
 {
@@ -23,14 +27,14 @@ namespace mdc_detail
 using std::array;
 
 template<int D>
-void edgeProcLeaves (array<const MDC_OctreeNode *, 4> nodes, Mesh &mesh) {
+void edgeProcLeaves (array<const MDC_OctreeNode *, 4> nodes, ComponentCuller &mesh) {
 	const MDC_Vertex *vertices[4];
 	for (int i = 0; i < 4; i++) {
 		int myedge = kEdgeProcSharedEdge[D][i];
 		int idx = kMdcEdgeSetIndex[nodes[i]->vertexMask ()][myedge];
 		if (idx < 0 || nodes[i]->m_vertices.size () <= idx)
 			return;
-		vertices[i] = nodes[i]->m_vertices[idx].highestCollapsibleAncestor ();
+		vertices[i] = nodes[i]->m_vertices[idx].m_representative;
 		if (!vertices[i])
 			return;
 	}
@@ -83,7 +87,7 @@ void edgeProcLeaves (array<const MDC_OctreeNode *, 4> nodes, Mesh &mesh) {
 	}
 
 template<int D>
-void edgeProc (array<const MDC_OctreeNode *, 4> nodes, Mesh &mesh) {
+void edgeProc (array<const MDC_OctreeNode *, 4> nodes, ComponentCuller &mesh) {
 	const MDC_OctreeNode *sub[8];
 	bool all_leaves = true;
 	for (int i = 0; i < 8; i++) {
@@ -102,7 +106,7 @@ void edgeProc (array<const MDC_OctreeNode *, 4> nodes, Mesh &mesh) {
 }
 
 template<int D>
-void faceProc (array<const MDC_OctreeNode *, 2> nodes, Mesh &mesh) {
+void faceProc (array<const MDC_OctreeNode *, 2> nodes, ComponentCuller &mesh) {
 	const MDC_OctreeNode *sub[8];
 	bool all_leaves = true;
 	for (int i = 0; i < 8; i++) {
@@ -122,7 +126,7 @@ void faceProc (array<const MDC_OctreeNode *, 2> nodes, Mesh &mesh) {
 	callSubEdgeProc (D3);
 }
 
-void cellProc (const MDC_OctreeNode *node, Mesh &mesh) {
+void cellProc (const MDC_OctreeNode *node, ComponentCuller &mesh) {
 	assert (node);
 	if (node->isLeaf ())
 		return;
@@ -139,13 +143,17 @@ void cellProc (const MDC_OctreeNode *node, Mesh &mesh) {
 	callSubEdgeProc (2);
 }
 
-void addVerticesToMesh (MDC_OctreeNode *node, Mesh &mesh, float epsilon) {
+/* Traverses the tree top-down, so parents have their representatives ready
+ before children, and representative of every vertex is found in O(1) */
+void addVerticesToMesh (MDC_OctreeNode *node, ComponentCuller &mesh, float epsilon) {
 	for (auto &v : node->m_vertices) {
 		if (node->isLeaf ())
 			v.m_collapsible = true;
 		else
 			v.m_collapsible = v.m_error <= epsilon;
-		if (v.m_collapsible && !v.hasCollapsibleAncestor ()) {
+		MDC_Vertex *collapsible_ancestor = v.m_parent ? v.m_parent->m_representative : nullptr;
+		v.m_representative = collapsible_ancestor ? collapsible_ancestor : (v.m_collapsible ? &v : nullptr);
+		if (v.m_collapsible && !collapsible_ancestor) {
 			glm::vec3 vertex = v.m_position;
 			glm::vec3 normal = v.m_normal;
 			Material mat = v.m_material;
@@ -236,19 +244,31 @@ void clusterFace (array<MDC_OctreeNode *, 2> nodes, DSU &dsu, VertexArray &verti
 	callSubClusterEdge (D3);
 }
 
-void clusterCell (MDC_OctreeNode *node, glm::ivec3 min_corner, int32_t size, QefSolver3D &orig_solver) {
-	assert (node);
-	if (node->isLeaf ())
-		return;
-	MDC_OctreeNode *sub[8];
-	for (int i = 0; i < 8; i++) {
-		sub[i] = node->child (i);
-		int32_t sub_size = size / 2;
-		glm::ivec3 sub_pos = min_corner + sub_size * kCellCornerOffset[i];
-		clusterCell (sub[i], sub_pos, sub_size, orig_solver);
-	}
+/* Buffers reused by clusterNode calls. Children are clustered before their parent
+ starts using the buffers, so a single instance serves the whole tree (or every
+ node processed by one thread in parallel clustering). */
+struct ClusterScratch {
+	explicit ClusterScratch (const QefSolver3D::Config &config) : config (config) {}
+
+	const QefSolver3D::Config config;
 	DSU dsu;
 	VertexArray vertices;
+	std::vector<uint32_t> set_idx;
+	// Solvers are only added, never reallocated when the next node needs less of them
+	std::vector<QefSolver3D> solvers;
+	std::vector<MaterialFilter> filters;
+	std::vector<glm::vec3> avg_normals;
+};
+
+// Clusters vertices of a subdivided node, its children must be already clustered
+void clusterNode (MDC_OctreeNode *node, glm::ivec3 min_corner, int32_t size, ClusterScratch &scratch) {
+	MDC_OctreeNode *sub[8];
+	for (int i = 0; i < 8; i++)
+		sub[i] = node->child (i);
+	DSU &dsu = scratch.dsu;
+	VertexArray &vertices = scratch.vertices;
+	dsu.clear ();
+	vertices.clear ();
 	callSubClusterFace (0);
 	callSubClusterFace (1);
 	callSubClusterFace (2);
@@ -256,7 +276,8 @@ void clusterCell (MDC_OctreeNode *node, glm::ivec3 min_corner, int32_t size, Qef
 	callSubClusterEdge (1);
 	callSubClusterEdge (2);
 	uint32_t new_cnt = 0;
-	std::vector<uint32_t> set_idx (dsu.size (), kBadIndex);
+	auto &set_idx = scratch.set_idx;
+	set_idx.assign (dsu.size (), kBadIndex);
 	for (uint32_t i = 0; i < dsu.size (); i++) {
 		uint32_t leader = dsu.getSetLeader (i);
 		if (set_idx[leader] == kBadIndex) {
@@ -266,12 +287,15 @@ void clusterCell (MDC_OctreeNode *node, glm::ivec3 min_corner, int32_t size, Qef
 		set_idx[i] = set_idx[leader];
 	}
 	node->m_vertices.resize (new_cnt);
-	orig_solver.reset ();
-	std::vector<QefSolver3D> solver (new_cnt);
-	for (auto &s : solver)
-		s = orig_solver;
-	std::vector<MaterialFilter> filter (new_cnt);
-	std::vector<glm::vec3> avg_normal (new_cnt, glm::vec3 (0.0f));
+	auto &solver = scratch.solvers;
+	auto &filter = scratch.filters;
+	auto &avg_normal = scratch.avg_normals;
+	while (solver.size () < new_cnt)
+		solver.emplace_back (scratch.config);
+	for (uint32_t i = 0; i < new_cnt; i++)
+		solver[i].reset ();
+	filter.assign (new_cnt, MaterialFilter ());
+	avg_normal.assign (new_cnt, glm::vec3 (0.0f));
 	for (MDC_Vertex *v : vertices) {
 		uint32_t idx = set_idx[v->m_surfaceIdx];
 		v->m_surfaceIdx = kBadIndex;
@@ -292,17 +316,82 @@ void clusterCell (MDC_OctreeNode *node, glm::ivec3 min_corner, int32_t size, Qef
 	}
 }
 
+void clusterCell (MDC_OctreeNode *node, glm::ivec3 min_corner, int32_t size, ClusterScratch &scratch) {
+	assert (node);
+	if (node->isLeaf ())
+		return;
+	for (int i = 0; i < 8; i++) {
+		int32_t sub_size = size / 2;
+		glm::ivec3 sub_pos = min_corner + sub_size * kCellCornerOffset[i];
+		clusterCell (node->child (i), sub_pos, sub_size, scratch);
+	}
+	clusterNode (node, min_corner, size, scratch);
+}
+
+struct ClusterTask {
+	MDC_OctreeNode *node;
+	glm::ivec3 min_corner;
+	int32_t size;
+};
+
+// Groups subdivided nodes by depth, nodes of the same depth can be clustered independently
+void collectClusterTasks (MDC_OctreeNode *node, glm::ivec3 min_corner, int32_t size, size_t depth,
+                          std::vector<std::vector<ClusterTask>> &levels) {
+	if (node->isLeaf ())
+		return;
+	if (levels.size () <= depth)
+		levels.resize (depth + 1);
+	levels[depth].push_back ({ node, min_corner, size });
+	for (int i = 0; i < 8; i++) {
+		int32_t sub_size = size / 2;
+		glm::ivec3 sub_pos = min_corner + sub_size * kCellCornerOffset[i];
+		collectClusterTasks (node->child (i), sub_pos, sub_size, depth + 1, levels);
+	}
+}
+
+/* Clustering of a node only touches vertices of its subtree, so subtrees are independent
+ until their parent is clustered. Levels are processed bottom-up, nodes of each level are
+ distributed between workers with their own scratch buffers. */
+void clusterParallel (MDC_OctreeNode *root, glm::ivec3 min_corner, int32_t size,
+                      const QefSolver3D::Config &config, WorkerPool &workers) {
+	std::vector<std::vector<ClusterTask>> levels;
+	collectClusterTasks (root, min_corner, size, 0, levels);
+	std::vector<ClusterScratch> scratches;
+	scratches.reserve (workers.threadCount ());
+	for (uint32_t i = 0; i < workers.threadCount (); i++)
+		scratches.emplace_back (config);
+	for (size_t depth = levels.size (); depth-- > 0;) {
+		const auto &tasks = levels[depth];
+		workers.run (tasks.size (), [&] (size_t id, uint32_t worker) {
+			clusterNode (tasks[id].node, tasks[id].min_corner, tasks[id].size, scratches[worker]);
+		});
+	}
+}
+
 }
 
 using namespace mdc_detail;
 
-void MDC_Octree::build (const UniformGrid &G, QefSolver3D &solver) {
-	BuildArgs args { G, solver };
+void MDC_Octree::build (const UniformGrid &G, QefSolver3D &solver, JobControl *control) {
+	BuildArgs args { G, solver, control };
+	for (auto &leaf_solver : args.leafSolvers)
+		leaf_solver.setConfig (solver.config ());
+	if (control)
+		control->resetProgress (uint64_t (m_rootSize) * uint64_t (m_rootSize) * uint64_t (m_rootSize));
 	try {
 		m_root.collapse ();
 		glm::ivec3 min_corner (-m_rootSize / 2);
 		buildNode (&m_root, min_corner, m_rootSize, args);
-		clusterCell (&m_root, min_corner, m_rootSize, solver);
+		uint32_t threads = WorkerPool::resolveThreadCount (m_threadCount);
+		if (threads > 1) {
+			// Workers are started once and reused by all octree levels
+			WorkerPool workers (threads);
+			clusterParallel (&m_root, min_corner, m_rootSize, solver.config (), workers);
+		}
+		else {
+			ClusterScratch scratch (solver.config ());
+			clusterCell (&m_root, min_corner, m_rootSize, scratch);
+		}
 	}
 	catch (...) {
 		auto e = std::current_exception ();
@@ -311,24 +400,28 @@ void MDC_Octree::build (const UniformGrid &G, QefSolver3D &solver) {
 	}
 }
 
-Mesh MDC_Octree::contour (float epsilon) {
+Mesh MDC_Octree::contour (float epsilon, const ComponentCulling &culling) {
 	// Scale epsilon according to QEF scale (when translating from global coordinates to
 	// local the QEF value is scaled by 1/(scale^2))
 	float scaled_epsilon = epsilon / float (m_globalScale * m_globalScale);
-	Mesh mesh;
+	Mesh result;
+	ComponentCuller mesh (result, culling);
 	addVerticesToMesh (&m_root, mesh, scaled_epsilon);
 	cellProc (&m_root, mesh);
-	mesh.setGlobalPos (m_globalPos);
-	mesh.setGlobalScale (m_globalScale);
-	return mesh;
+	mesh.finish ();
+	result.setGlobalPos (m_globalPos);
+	result.setGlobalScale (m_globalScale);
+	return result;
 }
 
 void MDC_Octree::buildNode (MDC_OctreeNode *node, glm::ivec3 min_corner, int32_t size, BuildArgs &args) {
 	assert (node);
 	if (size == 1) {
 		buildLeaf (node, min_corner, size, args);
+		addLeafProgress (args.control, size);
 		return;
 	}
+	checkCancelled (args.control);
 	node->subdivide ();
 	int32_t child_size = size / 2;
 	for (int i = 0; i < 8; i++) {
@@ -339,7 +432,7 @@ void MDC_Octree::buildNode (MDC_OctreeNode *node, glm::ivec3 min_corner, int32_t
 
 void MDC_Octree::buildLeaf (MDC_OctreeNode *node, glm::ivec3 min_corner, int32_t size, BuildArgs &args) {
 	// Obtain solid/empty vertex mask for the grid cell
-	auto corners = args.grid.materialsOfCell (args.grid.pointToIndex (min_corner));
+	auto corners = args.grid.materialsOfCell (min_corner);
 	uint8_t vertex_mask = 0;
 	for (uint8_t i = 0; i < 8; i++)
 		if (corners[i] != Material::Empty)
@@ -348,14 +441,16 @@ void MDC_Octree::buildLeaf (MDC_OctreeNode *node, glm::ivec3 min_corner, int32_t
 	node->setVertexMask (vertex_mask);
 	// Up to four vertices will be generated, so we'll need to keep up to four
 	// solver states, material filters and average normals simultaneously
-	args.solver.reset ();
-	QefSolver3D solver[4];
+	int surface_cnt = 0;
+	for (int i = 0; i < 12; i++)
+		surface_cnt = std::max (surface_cnt, kMdcEdgeSetIndex[vertex_mask][i] + 1);
+	QefSolver3D *solver = args.leafSolvers;
+	for (int i = 0; i < surface_cnt; i++)
+		solver[i].reset ();
 	MaterialFilter filter[4];
 	glm::vec3 avg_normal[4];
-	for (int i = 0; i < 4; i++) {
-		solver[i] = args.solver;
+	for (int i = 0; i < 4; i++)
 		avg_normal[i] = glm::vec3 (0);
-	}
 	// This flag array prevents adding the same vertex to the filter
 	// multiple times (from multiple edges), thus making material filtering fair
 	std::array<bool, 8> corner_used;
@@ -363,16 +458,24 @@ void MDC_Octree::buildLeaf (MDC_OctreeNode *node, glm::ivec3 min_corner, int32_t
 	const UniformGridEdgeStorage *storages[3] = {
 		&args.grid.edges<0> (), &args.grid.edges<1> (), &args.grid.edges<2> ()
 	};
-	int surface_cnt = 0;
+	const UniformGridSurfaceCell *surface_cell = nullptr;
+	if (args.grid.surfaceCellsTracked ())
+		surface_cell = args.grid.findSurfaceCell (args.grid.pointToIndex (min_corner));
 	for (int i = 0; i < 12; i++) {
 		int idx = kMdcEdgeSetIndex[vertex_mask][i];
 		if (idx < 0)
 			continue;
-		surface_cnt = std::max (surface_cnt, idx + 1);
 		const auto &storage = *storages[kCellEdgeDirection[i]];
-		auto edge_pos = min_corner + kCellCornerOffset[kCellEdgeEndpoint[i][0]];
-		auto iter = storage.findEdge (edge_pos.x, edge_pos.y, edge_pos.z);
-		assert (iter != storage.end ());
+		UniformGridEdgeStorage::const_iterator iter;
+		if (surface_cell) {
+			assert (surface_cell->edgeMask & (1 << i));
+			iter = storage.cbegin () + surface_cell->edgeIndex[i];
+		}
+		else {
+			auto edge_pos = min_corner + kCellCornerOffset[kCellEdgeEndpoint[i][0]];
+			iter = storage.findEdge (edge_pos.x, edge_pos.y, edge_pos.z);
+			assert (iter != storage.end ());
+		}
 		glm::vec3 point = iter->surfacePoint ();
 		glm::vec3 normal = iter->surfaceNormal ();
 		solver[idx].addPlane (point, normal);
@@ -38,6 +38,23 @@ void Mesh::clear () noexcept {
 	m_indices.clear ();
 }
 
+void Mesh::removeUnusedVertices () {
+	constexpr uint32_t kUnused = std::numeric_limits<uint32_t>::max ();
+	std::vector<uint32_t> new_ids (m_vertices.size (), kUnused);
+	for (uint32_t index : m_indices)
+		new_ids[index] = 0;
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < m_vertices.size (); i++) {
+		if (new_ids[i] == kUnused)
+			continue;
+		new_ids[i] = count;
+		m_vertices[count++] = m_vertices[i];
+	}
+	m_vertices.erase (m_vertices.begin () + count, m_vertices.end ());
+	for (uint32_t &index : m_indices)
+		index = new_ids[index];
+}
+
 // TODO: implement switching to 16-bit indices when there are <= 2^16 vertices
 
 }
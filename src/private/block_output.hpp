@@ -0,0 +1,30 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+#pragma once
+
+#include <isomesh/common.hpp>
+
+#include <vector>
+
+namespace isomesh
+{
+
+// Vertex of a block mesh prepared for committing
+struct BlockVertex {
+	// Global position
+	glm::vec3 position;
+	glm::vec3 normal;
+	// Key of this vertex in the boundary map
+	uint64_t key;
+	// Number of blocks producing this vertex (zero if it lies outside the domain)
+	uint32_t refs;
+};
+
+// Mesh of one block produced by block-wise extraction
+struct BlockOutput {
+	std::vector<BlockVertex> vertices;
+	// Triangles referencing indices in the vertices array
+	std::vector<uint32_t> indices;
+};
+
+}
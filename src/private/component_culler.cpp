@@ -0,0 +1,124 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+#include "component_culler.hpp"
+
+#include <cassert>
+#include <cmath>
+
+namespace isomesh
+{
+
+ComponentCuller::ComponentCuller (Mesh &mesh, const ComponentCulling &options) :
+	m_mesh (mesh), m_options (options) {}
+
+void ComponentCuller::addTriangle (uint32_t i1, uint32_t i2, uint32_t i3) {
+	// Mesh skips degenerate triangles, so they must not be counted or recorded
+	if (i1 == i2 || i2 == i3 || i1 == i3)
+		return;
+	if (!m_options.enabled ()) {
+		if (m_origin)
+			m_origin->triangles.push_back (m_source);
+		m_mesh.addTriangle (i1, i2, i3);
+		return;
+	}
+	uint32_t vertex_count = uint32_t (m_mesh.vertexCount ());
+	if (m_dsu.size () < vertex_count) {
+		m_dsu.expand (vertex_count);
+		m_components.resize (vertex_count);
+	}
+	uint32_t root = merge (merge (i1, i2), i3);
+	glm::dvec3 a = m_mesh[i1].position;
+	glm::dvec3 b = m_mesh[i2].position;
+	glm::dvec3 c = m_mesh[i3].position;
+	Component &component = m_components[root];
+	component.triangles++;
+	component.volume += glm::dot (a, glm::cross (b, c)) / 6.0;
+	if (component.accepted) {
+		m_mesh.addTriangle (i1, i2, i3);
+		return;
+	}
+	uint32_t slot = m_freeTriangle;
+	if (slot != kBadIndex) {
+		m_freeTriangle = m_pending[slot].next;
+		m_pending[slot] = PendingTriangle { { i1, i2, i3 }, kBadIndex };
+	} else {
+		slot = uint32_t (m_pending.size ());
+		m_pending.push_back (PendingTriangle { { i1, i2, i3 }, kBadIndex });
+	}
+	if (component.tail == kBadIndex)
+		component.head = slot;
+	else
+		m_pending[component.tail].next = slot;
+	component.tail = slot;
+	// Volume of an incomplete component means nothing, so it is checked only by finish
+	if (m_options.minVolume <= 0 && passes (component))
+		accept (component);
+}
+
+void ComponentCuller::finish () {
+	if (!m_options.enabled ())
+		return;
+	for (uint32_t i = 0; i < m_components.size (); i++) {
+		Component &c = m_components[i];
+		if (m_dsu.getSetLeader (i) == i && !c.accepted && c.head != kBadIndex && passes (c))
+			accept (c);
+	}
+	m_components.clear ();
+	m_pending.clear ();
+	m_freeTriangle = kBadIndex;
+	m_dsu.clear ();
+	m_mesh.removeUnusedVertices ();
+}
+
+void ComponentCuller::recordOrigin (MeshOrigin &origin) {
+	assert (!m_options.enabled ());
+	m_origin = &origin;
+	m_origin->vertices.clear ();
+	m_origin->triangles.clear ();
+}
+
+uint32_t ComponentCuller::merge (uint32_t a, uint32_t b) {
+	a = m_dsu.getSetLeader (a);
+	b = m_dsu.getSetLeader (b);
+	if (a == b)
+		return a;
+	m_dsu.mergeSets (a, b);
+	uint32_t root = m_dsu.getSetLeader (a);
+	Component &to = m_components[root];
+	Component &from = m_components[(root == a) ? b : a];
+	to.triangles += from.triangles;
+	to.volume += from.volume;
+	// Lists of accepted components are empty, so just concatenate them
+	if (from.head != kBadIndex) {
+		if (to.tail == kBadIndex)
+			to.head = from.head;
+		else
+			m_pending[to.tail].next = from.head;
+		to.tail = from.tail;
+	}
+	// An accepted part makes the whole component accepted (triangle count only grows)
+	bool accepted = to.accepted || from.accepted;
+	from = Component ();
+	if (accepted)
+		accept (to);
+	return root;
+}
+
+bool ComponentCuller::passes (const Component &c) const noexcept {
+	return c.triangles >= m_options.minTriangles && std::abs (c.volume) >= m_options.minVolume;
+}
+
+void ComponentCuller::accept (Component &c) {
+	c.accepted = true;
+	for (uint32_t slot = c.head; slot != kBadIndex;) {
+		PendingTriangle &t = m_pending[slot];
+		m_mesh.addTriangle (t.indices[0], t.indices[1], t.indices[2]);
+		uint32_t next = t.next;
+		t.next = m_freeTriangle;
+		m_freeTriangle = slot;
+		slot = next;
+	}
+	c.head = c.tail = kBadIndex;
+}
+
+}
@@ -0,0 +1,75 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+#pragma once
+
+#include <isomesh/data/mesh.hpp>
+#include <isomesh/util/component_culling.hpp>
+
+#include "disjoint_set_union.hpp"
+#include "mesh_origin.hpp"
+
+#include <vector>
+
+namespace isomesh
+{
+
+/* Mesh output wrapper used by extraction algorithms. With culling disabled it just forwards
+ everything to the mesh. Otherwise components are labeled online with union-find over vertices
+ (accumulating triangle count and signed volume per component). Triangles of a component are
+ held in its pending list only until it is known to pass the thresholds, then they go to the mesh
+ and all later ones are added directly. Triangle count only grows, so with minTriangles alone
+ components are accepted as soon as they get big enough. Volume is final only for complete
+ components, so it is checked by finish (), which also drops unused vertices in place.
+ It can also record origins of mesh elements (see MeshOrigin), algorithms report the current
+ grid element with setSource before adding vertices and triangles produced by it. */
+class ComponentCuller {
+public:
+	ComponentCuller (Mesh &mesh, const ComponentCulling &options);
+
+	uint32_t addVertex (const glm::vec3 &pos, const glm::vec3 &normal, Material mat) {
+		if (m_origin)
+			m_origin->vertices.push_back (m_source);
+		return m_mesh.addVertex (pos, normal, mat);
+	}
+	void addTriangle (uint32_t i1, uint32_t i2, uint32_t i3);
+	const Mesh::Vertex &operator [] (uint32_t index) const { return m_mesh[index]; }
+	// Must be called after all triangles are added
+	void finish ();
+
+	// Starts recording origins, culling must be disabled
+	void recordOrigin (MeshOrigin &origin);
+	bool recordsOrigin () const noexcept { return m_origin != nullptr; }
+	// Sets grid element producing the following vertices and triangles
+	void setSource (const glm::ivec3 &pos, int32_t axis) noexcept { m_source = MeshOrigin::Source { pos, axis }; }
+
+private:
+	struct Component {
+		uint32_t triangles = 0;
+		double volume = 0;
+		// Pending triangles list, empty once the component is accepted
+		uint32_t head = kBadIndex;
+		uint32_t tail = kBadIndex;
+		bool accepted = false;
+	};
+	struct PendingTriangle {
+		uint32_t indices[3];
+		uint32_t next;
+	};
+
+	uint32_t merge (uint32_t a, uint32_t b);
+	bool passes (const Component &c) const noexcept;
+	void accept (Component &c);
+
+	Mesh &m_mesh;
+	const ComponentCulling m_options;
+	DisjointSetUnion<uint32_t> m_dsu;
+	// Per-component data, valid for set leaders only
+	std::vector<Component> m_components;
+	// Pending triangles of all components, freed slots are chained from m_freeTriangle
+	std::vector<PendingTriangle> m_pending;
+	uint32_t m_freeTriangle = kBadIndex;
+	MeshOrigin *m_origin = nullptr;
+	MeshOrigin::Source m_source {};
+};
+
+}
@@ -0,0 +1,258 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+#include "component_tracker.hpp"
+#include "ply_stream_writer.hpp"
+
+#include "../qef/jacobi.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace isomesh
+{
+
+namespace component_detail
+{
+
+// Fragment slots are compacted once unused ones outnumber open ones by this much
+constexpr uint32_t kMinCompactedSlots = 64;
+
+// Computes component metadata from its vertices and triangles
+ComponentRecord describeComponent (const std::vector<glm::dvec3> &points, const std::vector<uint32_t> &indices) {
+	ComponentRecord r;
+	r.vertexCount = points.size ();
+	r.triangleCount = indices.size () / 3;
+	r.aabbMin = glm::dvec3 (std::numeric_limits<double>::max ());
+	r.aabbMax = glm::dvec3 (std::numeric_limits<double>::lowest ());
+	glm::dvec3 mean (0);
+	for (const auto &p : points) {
+		r.aabbMin = glm::min (r.aabbMin, p);
+		r.aabbMax = glm::max (r.aabbMax, p);
+		mean += p;
+	}
+	mean /= double (points.size ());
+	// Coordinates relative to the mean are used to reduce rounding errors
+	for (size_t i = 0; i < indices.size (); i += 3) {
+		glm::dvec3 a = points[indices[i]] - mean;
+		glm::dvec3 b = points[indices[i + 1]] - mean;
+		glm::dvec3 c = points[indices[i + 2]] - mean;
+		r.area += 0.5 * glm::length (glm::cross (b - a, c - a));
+		r.volume += glm::dot (a, glm::cross (b, c)) / 6.0;
+	}
+	// Oriented bounding box from principal components
+	glm::dmat3 cov (0.0);
+	for (const auto &p : points) {
+		glm::dvec3 d = p - mean;
+		for (int i = 0; i < 3; i++)
+			for (int j = 0; j < 3; j++)
+				cov[i][j] += d[i] * d[j];
+	}
+	glm::mat3 fcov;
+	for (int i = 0; i < 3; i++)
+		for (int j = 0; j < 3; j++)
+			fcov[i][j] = float (cov[i][j] / double (points.size ()));
+	float tolerance = 1e-6f * glm::max (1e-20f, fcov[0][0] + fcov[1][1] + fcov[2][2]);
+	auto E = jacobi (fcov, tolerance, 32, false).second;
+	glm::dvec3 axes[3];
+	glm::dvec3 lo, hi;
+	for (int i = 0; i < 3; i++) {
+		axes[i] = glm::normalize (glm::dvec3 (E[i]));
+		lo[i] = std::numeric_limits<double>::max ();
+		hi[i] = std::numeric_limits<double>::lowest ();
+		for (const auto &p : points) {
+			double t = glm::dot (p - mean, axes[i]);
+			lo[i] = glm::min (lo[i], t);
+			hi[i] = glm::max (hi[i], t);
+		}
+	}
+	int order[3] = { 0, 1, 2 };
+	std::sort (order, order + 3, [&] (int a, int b) { return hi[a] - lo[a] > hi[b] - lo[b]; });
+	r.obbCenter = mean;
+	for (int i = 0; i < 3; i++) {
+		int k = order[i];
+		r.obbAxes[i] = axes[k];
+		r.obbHalfExtents[i] = 0.5 * (hi[k] - lo[k]);
+		r.obbCenter += axes[k] * (0.5 * (hi[k] + lo[k]));
+	}
+	// Every edge of a closed manifold is used by two triangles
+	std::unordered_map<uint64_t, uint32_t> edge_uses;
+	edge_uses.reserve (indices.size ());
+	for (size_t i = 0; i < indices.size (); i += 3) {
+		for (int k = 0; k < 3; k++) {
+			uint64_t v1 = indices[i + k];
+			uint64_t v2 = indices[i + (k + 1) % 3];
+			edge_uses[(glm::min (v1, v2) << 32) | glm::max (v1, v2)]++;
+		}
+	}
+	r.watertight = std::all_of (edge_uses.begin (), edge_uses.end (),
+	                            [] (const auto &e) { return e.second == 2; });
+	return r;
+}
+
+}
+
+using namespace component_detail;
+
+ComponentTracker::ComponentTracker (const std::string &indexFilename) :
+	m_indexFilename (indexFilename), m_index (indexFilename, std::ios::binary | std::ios::trunc) {
+	if (!m_index.is_open ())
+		throw std::runtime_error ("Can't create file " + indexFilename);
+	ComponentIndex::writeHeader (m_index);
+}
+
+void ComponentTracker::addBlock (const BlockOutput &block) {
+	const auto &V = block.vertices;
+	const uint32_t n = uint32_t (V.size ());
+	// Split block mesh into connected fragments
+	DisjointSetUnion<uint32_t> local (n);
+	std::vector<bool> used (n, false);
+	for (size_t i = 0; i < block.indices.size (); i += 3) {
+		local.mergeSets (block.indices[i], block.indices[i + 1]);
+		local.mergeSets (block.indices[i], block.indices[i + 2]);
+		used[block.indices[i]] = used[block.indices[i + 1]] = used[block.indices[i + 2]] = true;
+	}
+	std::vector<uint32_t> local_fragment (n, kBadIndex);
+	std::vector<uint32_t> created;
+	auto fragmentOf = [&] (uint32_t v) {
+		uint32_t root = local.getSetLeader (v);
+		if (local_fragment[root] == kBadIndex) {
+			local_fragment[root] = m_dsu.addSet ();
+			m_fragments.emplace_back ();
+			m_openFragments++;
+			created.push_back (local_fragment[root]);
+		}
+		return local_fragment[root];
+	};
+	std::vector<uint64_t> ids (n, UINT64_MAX);
+	for (uint32_t i = 0; i < n; i++) {
+		const BlockVertex &v = V[i];
+		// Vertices outside the domain or not connected to anything are of no interest
+		if (v.refs == 0 || (v.refs == 1 && !used[i]))
+			continue;
+		if (v.refs > 1) {
+			auto iter = m_pending.find (v.key);
+			if (iter != m_pending.end ()) {
+				ids[i] = iter->second.id;
+				uint32_t other = iter->second.fragment;
+				if (--iter->second.refsLeft == 0) {
+					m_fragments[leader (other)].openRefs--;
+					m_pending.erase (iter);
+				}
+				merge (fragmentOf (i), other);
+				continue;
+			}
+		}
+		ids[i] = m_nextVertexId++;
+		uint32_t fragment = fragmentOf (i);
+		Fragment &f = m_fragments[leader (fragment)];
+		f.vertices.push_back (Vertex { ids[i], v.position, v.normal });
+		if (v.refs > 1) {
+			m_pending.emplace (v.key, PendingVertex { ids[i], v.refs - 1, fragment });
+			f.openRefs++;
+		}
+	}
+	for (size_t i = 0; i < block.indices.size (); i += 3) {
+		Fragment &f = m_fragments[leader (fragmentOf (block.indices[i]))];
+		for (int k = 0; k < 3; k++)
+			f.indices.push_back (ids[block.indices[i + k]]);
+	}
+	// Only fragments touched by this block could become closed
+	for (uint32_t fragment : created) {
+		uint32_t l = leader (fragment);
+		if (!m_fragments[l].flushed && m_fragments[l].openRefs == 0)
+			flush (l);
+	}
+	if (m_fragments.size () > 2 * size_t (m_openFragments) + kMinCompactedSlots)
+		compact ();
+}
+
+void ComponentTracker::finish () {
+	for (uint32_t i = 0; i < m_fragments.size (); i++)
+		if (leader (i) == i && !m_fragments[i].flushed)
+			flush (i);
+	m_pending.clear ();
+	m_index.close ();
+	if (!m_index)
+		throw std::runtime_error ("Failed writing file " + m_indexFilename);
+}
+
+void ComponentTracker::merge (uint32_t a, uint32_t b) {
+	a = leader (a);
+	b = leader (b);
+	if (a == b)
+		return;
+	m_dsu.mergeSets (a, b);
+	uint32_t l = leader (a);
+	Fragment &to = m_fragments[l];
+	Fragment &from = m_fragments[l == a ? b : a];
+	to.vertices.insert (to.vertices.end (), from.vertices.begin (), from.vertices.end ());
+	to.indices.insert (to.indices.end (), from.indices.begin (), from.indices.end ());
+	to.openRefs += from.openRefs;
+	from = Fragment ();
+	m_openFragments--;
+}
+
+void ComponentTracker::flush (uint32_t fragment) {
+	Fragment &f = m_fragments[fragment];
+	f.flushed = true;
+	m_openFragments--;
+	if (!f.indices.empty ()) {
+		std::unordered_map<uint64_t, uint32_t> vertex_pos;
+		vertex_pos.reserve (f.vertices.size ());
+		for (uint32_t i = 0; i < f.vertices.size (); i++)
+			vertex_pos.emplace (f.vertices[i].id, i);
+		uint64_t id = m_nextComponentId++;
+		PlyStreamWriter writer (ComponentIndex::meshFilename (m_indexFilename, id));
+		// Renumber vertices, dropping ones not used by any triangle
+		std::unordered_map<uint64_t, uint32_t> local_ids;
+		std::vector<glm::dvec3> points;
+		std::vector<uint32_t> indices;
+		indices.reserve (f.indices.size ());
+		for (uint64_t vertex_id : f.indices) {
+			auto iter = local_ids.find (vertex_id);
+			if (iter == local_ids.end ()) {
+				const Vertex &v = f.vertices[vertex_pos.at (vertex_id)];
+				iter = local_ids.emplace (vertex_id, writer.addVertex (v.position, v.normal)).first;
+				points.push_back (glm::dvec3 (v.position));
+			}
+			indices.push_back (iter->second);
+		}
+		for (size_t i = 0; i < indices.size (); i += 3)
+			writer.addTriangle (indices[i], indices[i + 1], indices[i + 2]);
+		writer.finish ();
+		ComponentRecord record = describeComponent (points, indices);
+		record.id = id;
+		ComponentIndex::writeRecord (m_index, record);
+		m_vertexCount += record.vertexCount;
+		m_triangleCount += record.triangleCount;
+	}
+	// Release memory, but keep the flag
+	f = Fragment ();
+	f.flushed = true;
+}
+
+void ComponentTracker::compact () {
+	// Open fragments get new slots, merged ones are replaced by their leaders
+	std::vector<uint32_t> new_slots (m_fragments.size (), kBadIndex);
+	std::vector<Fragment> fragments;
+	fragments.reserve (m_openFragments);
+	for (uint32_t i = 0; i < m_fragments.size (); i++) {
+		if (leader (i) != i || m_fragments[i].flushed)
+			continue;
+		new_slots[i] = uint32_t (fragments.size ());
+		fragments.push_back (std::move (m_fragments[i]));
+	}
+	// Closed fragments are awaited by no one, so pending vertices refer to open ones only
+	for (auto &entry : m_pending) {
+		entry.second.fragment = new_slots[leader (entry.second.fragment)];
+		assert (entry.second.fragment != kBadIndex);
+	}
+	assert (fragments.size () == m_openFragments);
+	m_fragments = std::move (fragments);
+	m_dsu = DisjointSetUnion<uint32_t> (uint32_t (m_fragments.size ()));
+}
+
+}
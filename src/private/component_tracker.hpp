@@ -0,0 +1,76 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+#pragma once
+
+#include <isomesh/data/component_index.hpp>
+
+#include "block_output.hpp"
+#include "disjoint_set_union.hpp"
+
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace isomesh
+{
+
+/* Tracks connected surface components across blocks of block-wise extraction.
+ Each block is split into fragments (connected parts of its mesh), fragments sharing
+ boundary vertices are merged with union-find. A component is closed once none of its
+ boundary vertices is awaited by unprocessed blocks, then it's written into its own PLY
+ file and its metadata is appended to the index. Slots of flushed and merged fragments are
+ compacted away once they outnumber open ones, so memory stays bounded by open components. */
+class ComponentTracker {
+public:
+	explicit ComponentTracker (const std::string &indexFilename);
+
+	void addBlock (const BlockOutput &block);
+	// Flushes all components still open (e.g. because of blocks disagreeing on edge signs)
+	void finish ();
+
+	uint64_t vertexCount () const noexcept { return m_vertexCount; }
+	uint64_t triangleCount () const noexcept { return m_triangleCount; }
+	uint64_t componentCount () const noexcept { return m_nextComponentId; }
+	uint64_t pendingCount () const noexcept { return m_pending.size (); }
+
+private:
+	struct Vertex {
+		uint64_t id;
+		glm::vec3 position;
+		glm::vec3 normal;
+	};
+	// Data is stored only in fragments which are set leaders
+	struct Fragment {
+		std::vector<Vertex> vertices;
+		// Triangles referencing global vertex ids
+		std::vector<uint64_t> indices;
+		// Number of boundary vertices awaited by other blocks
+		uint64_t openRefs = 0;
+		bool flushed = false;
+	};
+	struct PendingVertex {
+		uint64_t id;
+		uint32_t refsLeft;
+		uint32_t fragment;
+	};
+
+	uint32_t leader (uint32_t fragment) { return m_dsu.getSetLeader (fragment); }
+	void merge (uint32_t a, uint32_t b);
+	void flush (uint32_t fragment);
+	void compact ();
+
+	std::string m_indexFilename;
+	std::ofstream m_index;
+	DisjointSetUnion<uint32_t> m_dsu;
+	std::vector<Fragment> m_fragments;
+	std::unordered_map<uint64_t, PendingVertex> m_pending;
+	// Number of open (not flushed) fragments which are set leaders
+	uint32_t m_openFragments = 0;
+	uint64_t m_nextVertexId = 0;
+	uint64_t m_nextComponentId = 0;
+	uint64_t m_vertexCount = 0;
+	uint64_t m_triangleCount = 0;
+};
+
+}
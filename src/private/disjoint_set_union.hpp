@@ -20,6 +20,11 @@ public:
 	}
 
 	T size () const noexcept { return T (m_parent.size ()); }
+	// Removes all sets, keeping allocated memory
+	void clear () noexcept {
+		m_parent.clear ();
+		m_size.clear ();
+	}
 
 	void expand (T new_size) {
 		T old_size = size ();
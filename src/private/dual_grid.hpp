@@ -0,0 +1,184 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2018-2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+#pragma once
+
+#include <isomesh/data/grid.hpp>
+#include <isomesh/qef/qef_solver_3d.hpp>
+#include <isomesh/util/material_filter.hpp>
+#include <isomesh/util/tables.hpp>
+
+#include "component_culler.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+namespace isomesh
+{
+
+/* Building blocks shared by dual methods over uniform grids (dual contouring, surface nets,
+ chunked meshing): grouping surface-crossing edges by cells, placing dual vertices and emitting
+ a quad for each edge. They are templated on grid type to use compile-time indexing of
+ FixedUniformGrid when it is available. */
+namespace dual_detail
+{
+
+/* Offsets of cells adjacent to an edge (relative to its lesser endpoint), listed
+ in the same order as UniformGrid::adjacentCellsForEdge returns them */
+const glm::ivec3 kEdgeCellOffset[3][4] = {
+	{ { 0, -1, -1 }, { 0, 0, -1 }, { 0, 0, 0 }, { 0, -1, 0 } },
+	{ { -1, 0, -1 }, { -1, 0, 0 }, { 0, 0, 0 }, { 0, 0, -1 } },
+	{ { -1, -1, 0 }, { 0, -1, 0 }, { 0, 0, 0 }, { -1, 0, 0 } }
+};
+
+struct DualVertex {
+	glm::vec3 position;
+	glm::vec3 normal;
+	Material material;
+};
+
+// Places dual vertex of a cell with QEF solver from surface-crossing edges of the cell
+class DualVertexBuilder {
+public:
+	explicit DualVertexBuilder (QefSolver3D &solver) noexcept : m_solver (solver) {}
+
+	void reset () {
+		m_solver.reset ();
+		m_normal = glm::vec3 (0);
+		m_edgeCount = 0;
+	}
+	void addEdge (const UniformGridEdge &edge) {
+		m_solver.addPlane (edge.surfacePoint (), edge.surfaceNormal ());
+		m_normal += edge.surfaceNormal ();
+		m_edgeCount++;
+	}
+	/* Looks up surface-crossing edges of a cell in the grid. They are added in storage order
+	 (as collectCellEdges groups them), so the vertex doesn't depend on the way edges are found */
+	template<typename Grid>
+	void addCellEdges (const Grid &G, const glm::ivec3 &cell) {
+		addCellEdges<0> (G.template edges<0> (), cell);
+		addCellEdges<1> (G.template edges<1> (), cell);
+		addCellEdges<2> (G.template edges<2> (), cell);
+	}
+	bool empty () const noexcept { return m_edgeCount == 0; }
+
+	DualVertex solve (const glm::ivec3 &cell, const std::array<Material, 8> &materials) {
+		assert (!empty ());
+		glm::vec3 lower_bound = cell;
+		glm::vec3 upper_bound = lower_bound + 1.0f;
+		m_filter.reset ();
+		m_filter.add (materials);
+		return DualVertex { m_solver.solve (lower_bound, upper_bound), glm::normalize (m_normal), m_filter.select () };
+	}
+
+private:
+	template<int D>
+	void addCellEdges (const UniformGridEdgeStorage &storage, const glm::ivec3 &cell) {
+		for (int i = 4 * D; i < 4 * D + 4; i++) {
+			glm::ivec3 pos = cell + kCellCornerOffset[kCellEdgeEndpoint[i][0]];
+			auto iter = storage.findEdge (pos.x, pos.y, pos.z);
+			if (iter != storage.end ())
+				addEdge (*iter);
+		}
+	}
+
+	QefSolver3D &m_solver;
+	MaterialFilter m_filter;
+	glm::vec3 m_normal { 0 };
+	uint32_t m_edgeCount = 0;
+};
+
+// Emits quad around an edge from dual vertices of its cells in adjacentCellsForEdge order
+template<typename MeshOutput>
+void addQuad (MeshOutput &mesh, const uint32_t vtx[4], bool flip) {
+	if (!flip) {
+		mesh.addTriangle (vtx[0], vtx[1], vtx[3]);
+		mesh.addTriangle (vtx[1], vtx[2], vtx[3]);
+	}
+	else {
+		mesh.addTriangle (vtx[0], vtx[3], vtx[1]);
+		mesh.addTriangle (vtx[1], vtx[3], vtx[2]);
+	}
+}
+
+// Edge-cell relationship information for surface-crossing edges
+struct EdgeEntry {
+	EdgeEntry (uint32_t cell_idx) noexcept :
+		cellIndex (cell_idx) {}
+	EdgeEntry (uint32_t cell_idx, UniformGridEdgeStorage::const_iterator edge_iter) noexcept :
+		cellIndex (cell_idx), edgeIter (edge_iter) {}
+	// Index of cell this edge belongs to
+	uint32_t cellIndex;
+	// Iterator to the edge
+	UniformGridEdgeStorage::const_iterator edgeIter;
+	// Sorting array of these structs will group them by cell id
+	bool operator < (const EdgeEntry &e) const noexcept { return cellIndex < e.cellIndex; }
+};
+
+template<int D, typename Grid>
+void collectCellEdges (std::vector<EdgeEntry> &cell_edges, const Grid &G) {
+	auto first = G.template edges<D> ().cbegin ();
+	auto last = G.template edges<D> ().cend ();
+	for (auto iter = first; iter != last; ++iter) {
+		glm::ivec3 edge_pos = iter->lesserEndpoint ();
+		auto cells = G.template adjacentCellsForEdge<D> (edge_pos);
+		for (uint32_t cell_idx : cells)
+			if (cell_idx != kBadIndex)
+				cell_edges.emplace_back (cell_idx, iter);
+	}
+}
+
+template<int D, typename Grid>
+void generateQuads (const std::vector<uint32_t> &dual_vertex_ids, ComponentCuller &mesh, const Grid &G) {
+	for (const auto &edge : G.template edges<D> ()) {
+		glm::ivec3 edge_pos = edge.lesserEndpoint ();
+		auto cells = G.template adjacentCellsForEdge<D> (edge_pos);
+		// Border edges lack some adjacent cells, skip them
+		if (cells[0] == kBadIndex || cells[1] == kBadIndex ||
+			 cells[2] == kBadIndex || cells[3] == kBadIndex)
+			continue;
+		uint32_t vtx[4];
+		for (int i = 0; i < 4; i++) {
+			vtx[i] = dual_vertex_ids[cells[i]];
+			assert (vtx[i] != kBadIndex);
+		}
+		mesh.setSource (edge_pos, D);
+		addQuad (mesh, vtx, !edge.isLesserEndpointSolid ());
+	}
+}
+
+// Collects surface-crossing edges of all cells, grouped by cell ids
+template<typename Grid>
+void collectCellEdges (std::vector<EdgeEntry> &cell_edges, const Grid &G) {
+	size_t edges_count = G.template edges<0> ().size () + G.template edges<1> ().size () + G.template edges<2> ().size ();
+	// Each edge provides up to four entries
+	cell_edges.reserve (4 * edges_count);
+	// Grid has already grouped them, emit edges of each cell in the same order as sorting does
+	if (G.surfaceCellsTracked ()) {
+		const UniformGridEdgeStorage *storages[3] = { &G.template edges<0> (), &G.template edges<1> (), &G.template edges<2> () };
+		for (const auto &cell : G.surfaceCells ())
+			for (int dim = 0; dim < 3; dim++) {
+				uint32_t indices[4];
+				int count = 0;
+				for (int i = 4 * dim; i < 4 * dim + 4; i++)
+					if (cell.edgeMask & (1 << i))
+						indices[count++] = cell.edgeIndex[i];
+				// Insertion sort, at most four entries
+				for (int i = 1; i < count; i++)
+					for (int j = i; j > 0 && indices[j - 1] > indices[j]; j--)
+						std::swap (indices[j - 1], indices[j]);
+				for (int i = 0; i < count; i++)
+					cell_edges.emplace_back (cell.cellIndex, storages[dim]->cbegin () + indices[i]);
+			}
+		return;
+	}
+	collectCellEdges<0> (cell_edges, G); // X
+	collectCellEdges<1> (cell_edges, G); // Y
+	collectCellEdges<2> (cell_edges, G); // Z
+	// Keep edges of each cell in storage order, so that dual vertices don't depend on sorting details
+	std::stable_sort (cell_edges.begin (), cell_edges.end ());
+}
+
+}
+
+}
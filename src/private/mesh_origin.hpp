@@ -0,0 +1,34 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+#pragma once
+
+#include <isomesh/data/grid.hpp>
+#include <isomesh/data/mesh.hpp>
+#include <isomesh/qef/qef_solver_3d.hpp>
+
+#include <vector>
+
+namespace isomesh
+{
+
+/* Grid elements which produced mesh vertices and triangles, reported by extraction algorithms
+ to drivers that need to map meshes back to grids (like block-wise extraction). Marching cubes
+ vertices come from edges and triangles from cells, dual contouring is the other way round.
+ Vertices added by transition cells are attributed to the minimal cell of their box. */
+struct MeshOrigin {
+	struct Source {
+		// Edge lesser endpoint or cell minimal corner (grid local coordinates)
+		glm::ivec3 position;
+		// Edge axis, -1 for cells
+		int32_t axis;
+	};
+	// Sources of vertices and triangles, indexed the same way as in the mesh
+	std::vector<Source> vertices;
+	std::vector<Source> triangles;
+};
+
+// Extraction entry points reporting origins of mesh elements, culling is not supported there
+Mesh marchingCubesWithOrigin (const UniformGrid &G, MeshOrigin &origin);
+Mesh dualContouringWithOrigin (const UniformGrid &G, QefSolver3D &solver, MeshOrigin &origin);
+
+}
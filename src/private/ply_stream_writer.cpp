@@ -0,0 +1,88 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+#include "ply_stream_writer.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <limits>
+#include <stdexcept>
+
+namespace isomesh
+{
+
+PlyStreamWriter::PlyStreamWriter (const std::string &filename) :
+	m_filename (filename), m_vertexFilename (filename + ".vtx.tmp"), m_faceFilename (filename + ".face.tmp") {
+	m_vertexStream.open (m_vertexFilename, std::ios::binary | std::ios::trunc);
+	m_faceStream.open (m_faceFilename, std::ios::binary | std::ios::trunc);
+	if (!m_vertexStream.is_open () || !m_faceStream.is_open ())
+		throw std::runtime_error ("Can't create temporary files for " + filename);
+}
+
+PlyStreamWriter::~PlyStreamWriter () {
+	if (!m_finished) {
+		m_vertexStream.close ();
+		m_faceStream.close ();
+		std::remove (m_vertexFilename.c_str ());
+		std::remove (m_faceFilename.c_str ());
+	}
+}
+
+uint32_t PlyStreamWriter::addVertex (const glm::vec3 &pos, const glm::vec3 &normal) {
+	assert (m_vertexCount < std::numeric_limits<uint32_t>::max ());
+	const float data[6] = { pos.x, pos.y, pos.z, normal.x, normal.y, normal.z };
+	m_vertexStream.write (reinterpret_cast<const char *> (data), sizeof (data));
+	return m_vertexCount++;
+}
+
+void PlyStreamWriter::addTriangle (uint32_t i1, uint32_t i2, uint32_t i3) {
+	assert (i1 < m_vertexCount && i2 < m_vertexCount && i3 < m_vertexCount);
+	const uint8_t count = 3;
+	const uint32_t ids[3] = { i1, i2, i3 };
+	m_faceStream.write (reinterpret_cast<const char *> (&count), sizeof (count));
+	m_faceStream.write (reinterpret_cast<const char *> (ids), sizeof (ids));
+	m_triangleCount++;
+}
+
+void PlyStreamWriter::finish () {
+	if (m_finished)
+		return;
+	m_vertexStream.close ();
+	m_faceStream.close ();
+	if (!m_vertexStream || !m_faceStream)
+		throw std::runtime_error ("Failed writing temporary files for " + m_filename);
+	std::ofstream out (m_filename, std::ios::binary | std::ios::trunc);
+	if (!out.is_open ())
+		throw std::runtime_error ("Can't create file " + m_filename);
+	// Binary PLY data is written in host byte order, which is little endian on all supported platforms
+	out << "ply\n"
+	    << "format binary_little_endian 1.0\n"
+	    << "comment generated by isomesh library\n"
+	    << "element vertex " << m_vertexCount << '\n'
+	    << "property float x\n"
+	    << "property float y\n"
+	    << "property float z\n"
+	    << "property float nx\n"
+	    << "property float ny\n"
+	    << "property float nz\n"
+	    << "element face " << m_triangleCount << '\n'
+	    << "property list uchar uint vertex_indices\n"
+	    << "end_header\n";
+	{
+		std::ifstream vertices (m_vertexFilename, std::ios::binary);
+		if (m_vertexCount > 0)
+			out << vertices.rdbuf ();
+	}
+	{
+		std::ifstream faces (m_faceFilename, std::ios::binary);
+		if (m_triangleCount > 0)
+			out << faces.rdbuf ();
+	}
+	out.close ();
+	if (!out)
+		throw std::runtime_error ("Failed writing file " + m_filename);
+	std::remove (m_vertexFilename.c_str ());
+	std::remove (m_faceFilename.c_str ());
+	m_finished = true;
+}
+
+}
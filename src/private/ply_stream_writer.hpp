@@ -0,0 +1,44 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+#pragma once
+
+#include <isomesh/common.hpp>
+
+#include <fstream>
+#include <string>
+
+namespace isomesh
+{
+
+/* Writes a triangle mesh into binary PLY file without keeping it in memory.
+ PLY header needs element counts, which are not known until the end, so vertex
+ and face records are spooled into two temporary files next to the target one.
+ They are concatenated with the header when finish () is called. */
+class PlyStreamWriter {
+public:
+	explicit PlyStreamWriter (const std::string &filename);
+	~PlyStreamWriter ();
+
+	PlyStreamWriter (const PlyStreamWriter &) = delete;
+	PlyStreamWriter &operator = (const PlyStreamWriter &) = delete;
+
+	uint32_t addVertex (const glm::vec3 &pos, const glm::vec3 &normal);
+	void addTriangle (uint32_t i1, uint32_t i2, uint32_t i3);
+	// Writes the final file and removes temporary ones
+	void finish ();
+
+	uint32_t vertexCount () const noexcept { return m_vertexCount; }
+	uint64_t triangleCount () const noexcept { return m_triangleCount; }
+
+private:
+	std::string m_filename;
+	std::string m_vertexFilename;
+	std::string m_faceFilename;
+	std::ofstream m_vertexStream;
+	std::ofstream m_faceStream;
+	uint32_t m_vertexCount = 0;
+	uint64_t m_triangleCount = 0;
+	bool m_finished = false;
+};
+
+}
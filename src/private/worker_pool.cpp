@@ -0,0 +1,108 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+#include "worker_pool.hpp"
+
+namespace isomesh
+{
+
+WorkerPool::WorkerPool (uint32_t threads) {
+	threads = resolveThreadCount (threads);
+	m_threads.reserve (threads - 1);
+	try {
+		for (uint32_t i = 1; i < threads; i++)
+			m_threads.emplace_back (&WorkerPool::threadMain, this, i);
+	}
+	catch (...) {
+		stop ();
+		throw;
+	}
+}
+
+WorkerPool::~WorkerPool () {
+	stop ();
+}
+
+uint32_t WorkerPool::resolveThreadCount (uint32_t threads) noexcept {
+	if (threads == 0)
+		threads = glm::max (1u, std::thread::hardware_concurrency ());
+	return threads;
+}
+
+void WorkerPool::run (size_t count, const Task &task) {
+	if (m_threads.empty ()) {
+		for (size_t i = 0; i < count; i++)
+			task (i, 0);
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock (m_mutex);
+		m_task = &task;
+		m_count = count;
+		m_next = 0;
+		m_failed = false;
+		m_error = nullptr;
+		m_busy = uint32_t (m_threads.size ());
+		m_batch++;
+	}
+	m_started.notify_all ();
+	work (task, count, 0);
+	std::exception_ptr error;
+	{
+		std::unique_lock<std::mutex> lock (m_mutex);
+		m_finished.wait (lock, [this] () { return m_busy == 0; });
+		m_task = nullptr;
+		std::swap (error, m_error);
+	}
+	if (error)
+		std::rethrow_exception (error);
+}
+
+void WorkerPool::threadMain (uint32_t worker) {
+	uint64_t done_batch = 0;
+	while (true) {
+		const Task *task;
+		size_t count;
+		{
+			std::unique_lock<std::mutex> lock (m_mutex);
+			m_started.wait (lock, [&] () { return m_stopping || m_batch != done_batch; });
+			if (m_stopping)
+				return;
+			done_batch = m_batch;
+			task = m_task;
+			count = m_count;
+		}
+		work (*task, count, worker);
+		std::lock_guard<std::mutex> lock (m_mutex);
+		if (--m_busy == 0)
+			m_finished.notify_one ();
+	}
+}
+
+void WorkerPool::work (const Task &task, size_t count, uint32_t worker) {
+	while (!m_failed) {
+		size_t index = m_next++;
+		if (index >= count)
+			break;
+		try {
+			task (index, worker);
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> lock (m_mutex);
+			if (!m_failed.exchange (true))
+				m_error = std::current_exception ();
+		}
+	}
+}
+
+void WorkerPool::stop () noexcept {
+	{
+		std::lock_guard<std::mutex> lock (m_mutex);
+		m_stopping = true;
+	}
+	m_started.notify_all ();
+	for (auto &t : m_threads)
+		t.join ();
+	m_threads.clear ();
+}
+
+}
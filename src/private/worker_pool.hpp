@@ -0,0 +1,62 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+#pragma once
+
+#include <isomesh/common.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace isomesh
+{
+
+/* Fixed set of worker threads running batches of independent tasks. Threads are started once
+ and reused by every batch, so algorithms working in dependent stages (e.g. octree levels) don't
+ create threads at each stage. The calling thread takes part in each batch as worker 0, so a pool
+ of one thread runs everything in place. Tasks are handed out one by one, the first exception stops
+ handing them out and is rethrown from run () after all workers finish their current tasks. */
+class WorkerPool {
+public:
+	// Task receives its index and index of the worker running it (in [0; threadCount ()))
+	using Task = std::function<void (size_t, uint32_t)>;
+
+	// Zero threads means using all hardware threads
+	explicit WorkerPool (uint32_t threads);
+	~WorkerPool ();
+
+	WorkerPool (const WorkerPool &) = delete;
+	WorkerPool &operator = (const WorkerPool &) = delete;
+
+	uint32_t threadCount () const noexcept { return uint32_t (m_threads.size ()) + 1; }
+	// Runs tasks with indices in [0; count) and waits for them
+	void run (size_t count, const Task &task);
+
+	// Replaces zero with the number of hardware threads
+	static uint32_t resolveThreadCount (uint32_t threads) noexcept;
+
+private:
+	void threadMain (uint32_t worker);
+	void work (const Task &task, size_t count, uint32_t worker);
+	void stop () noexcept;
+
+	std::vector<std::thread> m_threads;
+	std::mutex m_mutex;
+	std::condition_variable m_started;
+	std::condition_variable m_finished;
+	// Current batch, guarded by the mutex
+	const Task *m_task = nullptr;
+	size_t m_count = 0;
+	uint64_t m_batch = 0;
+	uint32_t m_busy = 0;
+	bool m_stopping = false;
+	std::exception_ptr m_error;
+	std::atomic<size_t> m_next { 0 };
+	std::atomic<bool> m_failed { false };
+};
+
+}
@@ -6,6 +6,7 @@
 #include "jacobi.hpp"
 
 #include <cassert>
+#include <cmath>
 #include <cstring>
 #include <limits>
 #include <stdexcept>
@@ -13,6 +14,24 @@
 namespace isomesh
 {
 
+namespace qef_detail
+{
+
+// Index of element (i, j) of symmetric 4x4 matrix in packed upper triangle storage
+constexpr int kPacked[4][4] = {
+	{ 0, 1, 2, 3 },
+	{ 1, 4, 5, 6 },
+	{ 2, 5, 7, 8 },
+	{ 3, 6, 8, 9 }
+};
+
+// Cholesky pivots below this fraction of original diagonal element are considered to be zero
+constexpr double kCholeskyEpsilon = 1e-10;
+
+}
+
+using namespace qef_detail;
+
 QefSolver3D::QefSolver3D () noexcept {
 	reset ();
 }
@@ -22,8 +41,31 @@ QefSolver3D::QefSolver3D (const State &data) noexcept {
 	merge (data);
 }
 
+QefSolver3D::QefSolver3D (const Config &config) noexcept {
+	reset ();
+	setConfig (config);
+}
+
+void QefSolver3D::setConfig (const Config &value) noexcept {
+	setPinvTolerance (value.pinvTolerance);
+	setJacobiTolerance (value.jacobiTolerance);
+	setMaxJacobiIters (value.maxJacobiIters);
+	useFastFormulas (value.useFastFormulas);
+	useNormalEquations (value.useNormalEquations);
+}
+
+void QefSolver3D::useNormalEquations (bool value) noexcept {
+	if (value == m_config.useNormalEquations)
+		return;
+	State data = state ();
+	m_config.useNormalEquations = value;
+	reset ();
+	merge (data);
+}
+
 void QefSolver3D::reset () noexcept {
 	memset (A, 0, sizeof (A));
+	memset (m_normal, 0, sizeof (m_normal));
 	m_pointsSum = glm::vec3 { 0 };
 	m_pointsCount = 0;
 	m_usedRows = 0;
@@ -43,6 +85,17 @@ void QefSolver3D::merge (const State &data) noexcept {
 		m_pointsCount += data.mp_cnt;
 	}
 	// When mergee is of lesser dimension its mass point may be dismissed
+	if (m_config.useNormalEquations) {
+		const double rows[4][4] = {
+			{ data.a_11, data.a_12, data.a_13, data.b_1 },
+			{         0, data.a_22, data.a_23, data.b_2 },
+			{         0,         0, data.a_33, data.b_3 },
+			{         0,         0,         0,  data.r2 }
+		};
+		for (int i = 0; i < 4; i++)
+			addNormalRow (rows[i]);
+		return;
+	}
 	// We need four free rows
 	if (m_usedRows > kMaxRows - 4)
 		compressMatrix ();
@@ -58,12 +111,16 @@ void QefSolver3D::merge (const State &data) noexcept {
 }
 
 QefSolver3D::State QefSolver3D::state () noexcept {
-	compressMatrix ();
 	State data;
-	data.a_11 = A[0][0]; data.a_12 = A[1][0]; data.a_13 = A[2][0]; data.b_1 = A[3][0];
-	data.a_22 = A[1][1]; data.a_23 = A[2][1]; data.b_2 = A[3][1];
-	data.a_33 = A[2][2]; data.b_3 = A[3][2];
-	data.r2 = A[3][3];
+	if (m_config.useNormalEquations)
+		normalToState (data);
+	else {
+		compressMatrix ();
+		data.a_11 = A[0][0]; data.a_12 = A[1][0]; data.a_13 = A[2][0]; data.b_1 = A[3][0];
+		data.a_22 = A[1][1]; data.a_23 = A[2][1]; data.b_2 = A[3][1];
+		data.a_33 = A[2][2]; data.b_3 = A[3][2];
+		data.r2 = A[3][3];
+	}
 	data.mpx = m_pointsSum.x;
 	data.mpy = m_pointsSum.y;
 	data.mpz = m_pointsSum.z;
@@ -75,6 +132,13 @@ QefSolver3D::State QefSolver3D::state () noexcept {
 }
 
 void QefSolver3D::addPlane (glm::vec3 point, glm::vec3 normal) noexcept {
+	m_pointsSum += point;
+	m_pointsCount++;
+	if (m_config.useNormalEquations) {
+		const double row[4] = { normal.x, normal.y, normal.z, glm::dot (normal, point) };
+		addNormalRow (row);
+		return;
+	}
 	if (m_usedRows == kMaxRows)
 		compressMatrix ();
 	int id = m_usedRows;
@@ -83,11 +147,20 @@ void QefSolver3D::addPlane (glm::vec3 point, glm::vec3 normal) noexcept {
 	A[2][id] = normal.z;
 	A[3][id] = glm::dot (normal, point);
 	m_usedRows++;
-	m_pointsSum += point;
-	m_pointsCount++;
 }
 
 float QefSolver3D::eval (glm::vec3 point) const noexcept {
+	if (m_config.useNormalEquations) {
+		// x^T (A^T A) x - 2 x^T (A^T b) + b^T b, with x extended to (x, -1)
+		const double x[4] = { point.x, point.y, point.z, -1.0 };
+		double error = 0;
+		for (int i = 0; i < 4; i++) {
+			error += m_normal[kPacked[i][i]] * x[i] * x[i];
+			for (int j = i + 1; j < 4; j++)
+				error += 2.0 * m_normal[kPacked[i][j]] * x[i] * x[j];
+		}
+		return float (glm::max (error, 0.0));
+	}
 	float error = 0;
 	for (int i = 0; i < m_usedRows; i++) {
 		float dot = A[0][i] * point.x + A[1][i] * point.y + A[2][i] * point.z;
@@ -98,28 +171,36 @@ float QefSolver3D::eval (glm::vec3 point) const noexcept {
 }
 
 glm::vec3 QefSolver3D::solve (glm::vec3 min_point, glm::vec3 max_point) {
-	compressMatrix ();
-	glm::mat3 AT, ATA;
-	{
+	glm::mat3 ATA;
+	glm::vec3 ATb;
+	if (m_config.useNormalEquations) {
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++)
+				ATA[i][j] = float (m_normal[kPacked[i][j]]);
+			ATb[i] = float (m_normal[kPacked[i][3]]);
+		}
+	}
+	else {
+		compressMatrix ();
 		glm::mat3 M;
 		M[0] = glm::vec3 (A[0][0], A[0][1], A[0][2]);
 		M[1] = glm::vec3 (A[1][0], A[1][1], A[1][2]);
 		M[2] = glm::vec3 (A[2][0], A[2][1], A[2][2]);
-		AT = glm::transpose (M);
+		glm::mat3 AT = glm::transpose (M);
 		ATA = AT * M;
+		ATb = AT * glm::vec3 (A[3][0], A[3][1], A[3][2]);
 	}
-	auto[e, E] = jacobi (ATA, m_jacobiTolerance, m_maxJacobiIters, m_useFastFormulas);
+	auto[e, E] = jacobi (ATA, m_config.jacobiTolerance, m_config.maxJacobiIters, m_config.useFastFormulas);
 	glm::mat3 sigma { 0.0f };
 	m_featureDim = 3;
 	for (int i = 0; i < 3; i++) {
-		if (std::abs (e[i]) >= m_pinvTolerance)
+		if (std::abs (e[i]) >= m_config.pinvTolerance)
 			sigma[i][i] = 1.0f / e[i];
 		else m_featureDim--;
 	}
 	glm::mat3 ATAp = E * sigma * glm::transpose (E);
 	glm::vec3 p = m_pointsSum / float (m_pointsCount);
-	glm::vec3 b (A[3][0], A[3][1], A[3][2]);
-	glm::vec3 c = ATAp * (AT * b - ATA * p);
+	glm::vec3 c = ATAp * (ATb - ATA * p);
 	// TODO: replace this hack with proper bounded solver
 	return glm::clamp (c + p, min_point, max_point);
 }
@@ -129,4 +210,36 @@ void QefSolver3D::compressMatrix () noexcept {
 	m_usedRows = 4;
 }
 
+void QefSolver3D::addNormalRow (const double row[4]) noexcept {
+	for (int i = 0; i < 4; i++)
+		for (int j = i; j < 4; j++)
+			m_normal[kPacked[i][j]] += row[i] * row[j];
+}
+
+void QefSolver3D::normalToState (State &data) const noexcept {
+	// Cholesky decomposition (A b)^T (A b) = R^T R gives the same upper triangular
+	// matrix as QR decomposition of (A b) does (up to signs of rows)
+	double R[4][4] = {};
+	for (int i = 0; i < 4; i++) {
+		double diag = m_normal[kPacked[i][i]];
+		double pivot = diag;
+		for (int k = 0; k < i; k++)
+			pivot -= R[k][i] * R[k][i];
+		// Matrix is only positive semidefinite, zero pivot means the whole row is zero
+		if (pivot <= diag * kCholeskyEpsilon)
+			continue;
+		R[i][i] = std::sqrt (pivot);
+		for (int j = i + 1; j < 4; j++) {
+			double value = m_normal[kPacked[i][j]];
+			for (int k = 0; k < i; k++)
+				value -= R[k][i] * R[k][j];
+			R[i][j] = value / R[i][i];
+		}
+	}
+	data.a_11 = float (R[0][0]); data.a_12 = float (R[0][1]); data.a_13 = float (R[0][2]); data.b_1 = float (R[0][3]);
+	data.a_22 = float (R[1][1]); data.a_23 = float (R[1][2]); data.b_2 = float (R[1][3]);
+	data.a_33 = float (R[2][2]); data.b_3 = float (R[2][3]);
+	data.r2 = float (R[3][3]);
+}
+
 }
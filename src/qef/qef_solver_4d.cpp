@@ -21,15 +21,30 @@ QefSolver4D::QefSolver4D (const State &data) noexcept {
 	merge (data);
 }
 
+QefSolver4D::QefSolver4D (const Config &config) noexcept {
+	reset ();
+	setConfig (config);
+}
+
+void QefSolver4D::setConfig (const Config &value) noexcept {
+	setPinvTolerance (value.pinvTolerance);
+	setJacobiTolerance (value.jacobiTolerance);
+	setMaxJacobiIters (value.maxJacobiIters);
+	useFastFormulas (value.useFastFormulas);
+	useSimd (value.useSimd);
+}
+
 void QefSolver4D::reset () noexcept {
 	memset (A, 0, sizeof (A));
 	m_pointsSum = glm::vec4 { 0 };
 	m_pointsCount = 0;
 	m_usedRows = 0;
 	m_featureDim = 0;
+	m_solved = false;
 }
 
 void QefSolver4D::merge (const State &data) noexcept {
+	m_solved = false;
 	// Mergee is of higher dimension, our mass point may be dismissed
 	if (data.dim > m_featureDim) {
 		m_featureDim = data.dim;
@@ -78,6 +93,7 @@ QefSolver4D::State QefSolver4D::state () noexcept {
 }
 
 void QefSolver4D::addPlane (glm::vec4 point, glm::vec4 normal) noexcept {
+	m_solved = false;
 	if (m_usedRows == kMaxRows)
 		compressMatrix ();
 	int id = m_usedRows;
@@ -102,6 +118,8 @@ float QefSolver4D::eval (glm::vec4 point) const noexcept {
 }
 
 glm::vec4 QefSolver4D::solve (glm::vec4 min_point, glm::vec4 max_point) {
+	if (m_solved)
+		return glm::clamp (m_minimizer, min_point, max_point);
 	compressMatrix ();
 	glm::mat4 AT, ATA;
 	{
@@ -113,11 +131,11 @@ glm::vec4 QefSolver4D::solve (glm::vec4 min_point, glm::vec4 max_point) {
 		AT = glm::transpose (M);
 		ATA = AT * M;
 	}
-	auto[e, E] = jacobi (ATA, m_jacobiTolerance, m_maxJacobiIters, m_useFastFormulas);
+	auto[e, E] = jacobi (ATA, m_config.jacobiTolerance, m_config.maxJacobiIters, m_config.useFastFormulas);
 	glm::mat4 sigma { 0.0f };
 	m_featureDim = 4;
 	for (int i = 0; i < 4; i++) {
-		if (std::abs (e[i]) >= m_pinvTolerance)
+		if (std::abs (e[i]) >= m_config.pinvTolerance)
 			sigma[i][i] = 1.0f / e[i];
 		else m_featureDim--;
 	}
@@ -125,12 +143,23 @@ glm::vec4 QefSolver4D::solve (glm::vec4 min_point, glm::vec4 max_point) {
 	glm::vec4 p = m_pointsSum / float (m_pointsCount);
 	glm::vec4 b (A[4][0], A[4][1], A[4][2], A[4][3]);
 	glm::vec4 c = ATAp * (AT * b - ATA * p);
+	m_minimizer = c + p;
+	m_solved = true;
 	// TODO: replace this hack with proper bounded solver
-	return glm::clamp (c + p, min_point, max_point);
+	return glm::clamp (m_minimizer, min_point, max_point);
 }
 
 void QefSolver4D::compressMatrix () noexcept {
-	householder<float, 5, kMaxRows> (A, m_usedRows);
+#ifdef ISOMESH_HOUSEHOLDER_SSE
+	if (m_config.useSimd)
+		householderSse<5, kMaxRows> (A, m_usedRows);
+	else
+#endif
+		householder<float, 5, kMaxRows> (A, m_usedRows);
+	// Only upper triangle is meaningful now, leftovers in other rows are rounding errors
+	for (int i = 0; i < 5; i++)
+		for (int j = 5; j < m_usedRows; j++)
+			A[i][j] = 0;
 	m_usedRows = 5;
 }
 
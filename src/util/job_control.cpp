@@ -0,0 +1,37 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+#include <isomesh/util/job_control.hpp>
+
+namespace isomesh
+{
+
+float JobControl::progress () const noexcept {
+	uint64_t total = m_total.load (std::memory_order_relaxed);
+	if (total == 0)
+		return 0.0f;
+	return float (glm::min (1.0, double (m_done.load (std::memory_order_relaxed)) / double (total)));
+}
+
+void JobControl::resetProgress (uint64_t totalWork) noexcept {
+	m_done.store (0, std::memory_order_relaxed);
+	m_total.store (totalWork, std::memory_order_relaxed);
+	m_reportedPercent.store (0, std::memory_order_relaxed);
+}
+
+void JobControl::addProgress (uint64_t work) {
+	uint64_t done = m_done.fetch_add (work, std::memory_order_relaxed) + work;
+	if (!m_callback)
+		return;
+	uint64_t total = m_total.load (std::memory_order_relaxed);
+	uint32_t percent = total ? uint32_t (glm::min (done, total) * 100 / total) : 100;
+	// Only one thread reports each percent
+	uint32_t reported = m_reportedPercent.load (std::memory_order_relaxed);
+	while (percent > reported) {
+		if (m_reportedPercent.compare_exchange_weak (reported, percent, std::memory_order_relaxed)) {
+			m_callback (float (percent) / 100.0f);
+			break;
+		}
+	}
+}
+
+}
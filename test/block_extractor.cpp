@@ -0,0 +1,139 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+// Tests for block-wise extraction driver
+#include <isomesh/isomesh.hpp>
+
+#include <cstdio>
+#include <iostream>
+
+using std::cerr;
+using std::endl;
+
+// Same field as in marching cubes test
+class WavesScalarField : public isomesh::ScalarField {
+public:
+	virtual double value (double x, double y, double z) const noexcept override {
+		return sin (freq_x * x) + y - sin (freq_z1 * z) * cos (freq_z2 * z);
+	}
+	virtual glm::dvec3 grad (double x, double y, double z) const noexcept override {
+		double dx = freq_x * cos (freq_x * x);
+		double dy = 1;
+		double dz = freq_z2 * sin (freq_z1 * z) * sin (freq_z2 * z)
+			- freq_z1 * cos (freq_z1 * z) * cos (freq_z2 * z);
+		return glm::dvec3 (dx, dy, dz);
+	}
+private:
+	constexpr static double freq_x = 0.3;
+	constexpr static double freq_z1 = 0.4;
+	constexpr static double freq_z2 = 0.2;
+};
+
+// Union of an ellipsoid elongated along X and a smaller sphere above it
+class TwoBlobsScalarField : public isomesh::ScalarField {
+public:
+	virtual double value (double x, double y, double z) const noexcept override {
+		return glm::min (ellipsoid (glm::dvec3 (x, y, z)), sphere (glm::dvec3 (x, y, z)));
+	}
+	virtual glm::dvec3 grad (double x, double y, double z) const noexcept override {
+		glm::dvec3 p (x, y, z);
+		if (ellipsoid (p) < sphere (p)) {
+			glm::dvec3 q = (p - kEllipsoidCenter) / kEllipsoidAxes;
+			return q / glm::length (q) / kEllipsoidAxes * kEllipsoidAxes.y;
+		}
+		return glm::normalize (p - kSphereCenter);
+	}
+	static double sphereVolume () { return 4.0 / 3.0 * glm::pi<double> () * kSphereRadius * kSphereRadius * kSphereRadius; }
+private:
+	double ellipsoid (const glm::dvec3 &p) const noexcept {
+		return (glm::length ((p - kEllipsoidCenter) / kEllipsoidAxes) - 1.0) * kEllipsoidAxes.y;
+	}
+	double sphere (const glm::dvec3 &p) const noexcept {
+		return glm::length (p - kSphereCenter) - kSphereRadius;
+	}
+	static constexpr double kSphereRadius = 4.0;
+	static const glm::dvec3 kEllipsoidCenter, kEllipsoidAxes, kSphereCenter;
+};
+
+const glm::dvec3 TwoBlobsScalarField::kEllipsoidCenter (0.25, -5.75, 0.25);
+const glm::dvec3 TwoBlobsScalarField::kEllipsoidAxes (10, 3, 3);
+const glm::dvec3 TwoBlobsScalarField::kSphereCenter (0.25, 7.25, 0.25);
+
+static const char *kFilename = "test-block-extractor.ply";
+
+// Block-wise result must be exactly the same (up to ordering) as result on one big grid
+bool checkCounts (const char *name, const isomesh::BlockExtractor &E, const isomesh::Mesh &reference) {
+	if (E.vertexCount () != reference.vertexCount () || 3 * E.triangleCount () != reference.indexCount ()) {
+		cerr << name << " with block size " << E.blockSize () << " differs from single grid!" << endl;
+		cerr << "Expected " << reference.vertexCount () << " vertices and "
+		     << reference.indexCount () / 3 << " triangles" << endl;
+		cerr << "Got " << E.vertexCount () << " vertices and " << E.triangleCount () << " triangles" << endl;
+		return false;
+	}
+	return true;
+}
+
+int main () {
+	WavesScalarField F;
+	isomesh::BisectionZeroFinder zero_finder;
+	isomesh::QefSolver3D solver;
+	const int sz = 16;
+	isomesh::UniformGrid G (sz);
+	G.fill (F, zero_finder);
+	auto mc_mesh = isomesh::marchingCubes (G);
+	auto dc_mesh = isomesh::dualContouring (G, solver);
+
+	for (uint32_t block_size : { 2u, 4u, 8u, 16u, 32u }) {
+		isomesh::BlockExtractor E (glm::ivec3 (sz), block_size, glm::dvec3 (-sz / 2));
+		E.setThreadCount (3);
+		E.extractMarchingCubes (F, zero_finder, kFilename);
+		if (!checkCounts ("Marching cubes", E, mc_mesh))
+			return 1;
+		E.extractDualContouring (F, zero_finder, solver, kFilename);
+		if (!checkCounts ("Dual contouring", E, dc_mesh))
+			return 2;
+		if (E.peakPendingVertices () == 0 && block_size < uint32_t (sz) / 2) {
+			cerr << "No vertices were shared between blocks" << endl;
+			return 3;
+		}
+	}
+	std::remove (kFilename);
+
+	// Component splitting, both blobs must become separate closed components
+	TwoBlobsScalarField blobs;
+	isomesh::BlockExtractor E (glm::ivec3 (32), 8, glm::dvec3 (-16));
+	E.setThreadCount (2);
+	E.setComponentsSplit (true);
+	E.extractDualContouring (blobs, zero_finder, solver, kFilename);
+	isomesh::ComponentIndex index (kFilename);
+	for (const auto &r : index.records ())
+		std::remove (index.meshFilename (r).c_str ());
+	std::remove (kFilename);
+	if (E.componentCount () != 2 || index.records ().size () != 2) {
+		cerr << "Expected 2 components, got " << index.records ().size () << endl;
+		return 4;
+	}
+	for (const auto &r : index.records ()) {
+		if (!r.watertight) {
+			cerr << "Component " << r.id << " is not watertight" << endl;
+			return 5;
+		}
+	}
+	auto big = index.withMinVolume (1.2 * TwoBlobsScalarField::sphereVolume ());
+	if (big.size () != 1 || big[0].obbHalfExtents.x < 9.0 || big[0].obbHalfExtents.x > 11.0) {
+		cerr << "Ellipsoid component is not found by volume" << endl;
+		return 6;
+	}
+	auto aligned = index.alignedWith (glm::dvec3 (1, 0, 0), 0.1);
+	if (aligned.size () != 1 || aligned[0].id != big[0].id) {
+		cerr << "Ellipsoid component is not found by orientation" << endl;
+		return 7;
+	}
+	const auto &small = index.records ()[index.records ()[0].id == big[0].id ? 1 : 0];
+	double sphere_volume = small.volume;
+	if (glm::abs (sphere_volume / TwoBlobsScalarField::sphereVolume () - 1.0) > 0.05) {
+		cerr << "Wrong sphere volume " << sphere_volume << ", expected " << TwoBlobsScalarField::sphereVolume () << endl;
+		return 8;
+	}
+
+	return 0;
+}
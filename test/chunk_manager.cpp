@@ -0,0 +1,88 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+// Tests for chunk manager seams stitching
+#include <isomesh/isomesh.hpp>
+
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <tuple>
+
+using std::cerr;
+using std::endl;
+
+// Sphere centered at the common corner of eight chunks
+class SphereScalarField : public isomesh::ScalarField {
+public:
+	virtual double value (double x, double y, double z) const noexcept override {
+		return glm::length (glm::dvec3 (x, y, z) - kCenter) - 5.3;
+	}
+	virtual glm::dvec3 grad (double x, double y, double z) const noexcept override {
+		return glm::normalize (glm::dvec3 (x, y, z) - kCenter);
+	}
+private:
+	static const glm::dvec3 kCenter;
+};
+
+const glm::dvec3 SphereScalarField::kCenter (0.1, -0.2, 0.3);
+
+int main () {
+	SphereScalarField F;
+	isomesh::BisectionZeroFinder zero_finder;
+	isomesh::QefSolver3D solver;
+	const int sz = 8;
+	isomesh::ChunkManager world (sz);
+	for (int i = 0; i < 8; i++)
+		world.fillChunk (glm::ivec3 (-(i & 1), -((i >> 1) & 1), -((i >> 2) & 1)), F, zero_finder);
+	if (world.chunkCount () != 8) {
+		cerr << "Wrong chunks count" << endl;
+		return 1;
+	}
+	// Weld chunk meshes by global vertex positions
+	std::map<std::tuple<long, long, long>, uint32_t> welded;
+	std::map<std::pair<uint32_t, uint32_t>, int> edge_uses;
+	size_t triangles = 0;
+	for (int i = 0; i < 8; i++) {
+		auto mesh = world.meshChunk (glm::ivec3 (-(i & 1), -((i >> 1) & 1), -((i >> 2) & 1)), solver);
+		std::vector<uint32_t> ids (mesh.vertexCount ());
+		for (uint32_t k = 0; k < mesh.vertexCount (); k++) {
+			glm::dvec3 p = glm::dvec3 (mesh[k].position) * mesh.globalScale () + mesh.globalPos ();
+			auto key = std::make_tuple (std::lround (p.x * 1e4), std::lround (p.y * 1e4), std::lround (p.z * 1e4));
+			ids[k] = welded.emplace (key, uint32_t (welded.size ())).first->second;
+		}
+		const uint32_t *indices = static_cast<const uint32_t *> (mesh.indexData ());
+		for (size_t k = 0; k < mesh.indexCount (); k += 3) {
+			for (int e = 0; e < 3; e++) {
+				uint32_t a = ids[indices[k + e]];
+				uint32_t b = ids[indices[k + (e + 1) % 3]];
+				edge_uses[std::make_pair (glm::min (a, b), glm::max (a, b))]++;
+			}
+		}
+		triangles += mesh.indexCount () / 3;
+	}
+	for (const auto &e : edge_uses) {
+		if (e.second != 2) {
+			cerr << "Chunk meshes are not watertight, edge is used " << e.second << " times" << endl;
+			return 2;
+		}
+	}
+	// The same surface on a single grid
+	isomesh::UniformGrid G (2 * sz);
+	G.fill (F, zero_finder);
+	auto reference = isomesh::dualContouring (G, solver);
+	if (3 * triangles != reference.indexCount () || welded.size () != reference.vertexCount ()) {
+		cerr << "Chunked mesh differs from single grid mesh" << endl;
+		cerr << "Expected " << reference.vertexCount () << " vertices and " << reference.indexCount () / 3
+		     << " triangles, got " << welded.size () << " and " << triangles << endl;
+		return 3;
+	}
+	// Seams towards missing neighbours are not generated
+	size_t stitched = world.meshChunk (glm::ivec3 (-1, -1, -1), solver).indexCount ();
+	world.removeChunk (glm::ivec3 (0, -1, -1));
+	size_t lonely = world.meshChunk (glm::ivec3 (-1, -1, -1), solver).indexCount ();
+	if (lonely == 0 || lonely >= stitched) {
+		cerr << "Wrong seams towards missing neighbour" << endl;
+		return 4;
+	}
+	return 0;
+}
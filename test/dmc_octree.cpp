@@ -0,0 +1,80 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+// Tests for DMC octree sampling options
+#include <isomesh/isomesh.hpp>
+
+#include <iostream>
+
+using std::cerr;
+using std::clog;
+using std::endl;
+
+class SphereScalarField : public isomesh::ScalarField {
+public:
+	virtual double value (double x, double y, double z) const noexcept override {
+		m_samples++;
+		return glm::length (glm::dvec3 (x, y, z) - kCenter) - kRadius;
+	}
+	virtual glm::dvec3 grad (double x, double y, double z) const noexcept override {
+		return glm::normalize (glm::dvec3 (x, y, z) - kCenter);
+	}
+	size_t samples () const noexcept { return m_samples; }
+	void resetSamples () noexcept { m_samples = 0; }
+
+	static constexpr double kRadius = 45.3;
+	static const glm::dvec3 kCenter;
+
+private:
+	mutable size_t m_samples = 0;
+};
+
+const glm::dvec3 SphereScalarField::kCenter (0.3, -0.2, 0.1);
+
+struct BuildResult {
+	size_t samples;
+	size_t triangles;
+	double max_deviation;
+};
+
+BuildResult build (bool low_discrepancy, bool adaptive) {
+	SphereScalarField F;
+	isomesh::QefSolver4D solver;
+	isomesh::DMC_Octree octree (128);
+	octree.useLowDiscrepancySampling (low_discrepancy);
+	octree.useAdaptiveSampling (adaptive);
+	octree.build (F, solver, 0.01f);
+	BuildResult result;
+	result.samples = F.samples ();
+	isomesh::Mesh mesh = octree.contour ();
+	result.triangles = mesh.indexCount () / 3;
+	result.max_deviation = 0;
+	for (size_t i = 0; i < mesh.vertexCount (); i++) {
+		double dist = glm::length (glm::dvec3 (mesh[uint32_t (i)].position) - SphereScalarField::kCenter);
+		result.max_deviation = glm::max (result.max_deviation, glm::abs (dist - SphereScalarField::kRadius));
+	}
+	return result;
+}
+
+int main () {
+	const BuildResult reference = build (false, false);
+	const BuildResult halton = build (true, false);
+	const BuildResult adaptive = build (true, true);
+	auto print = [] (const char *name, const BuildResult &r) {
+		clog << name << ": " << r.samples << " field samples, " << r.triangles << " triangles, "
+		     << "max deviation " << r.max_deviation << endl;
+	};
+	print ("Uniform random", reference);
+	print ("Halton", halton);
+	print ("Adaptive Halton", adaptive);
+	for (const BuildResult *r : { &reference, &halton, &adaptive }) {
+		if (r->triangles == 0 || r->max_deviation > 0.5) {
+			cerr << "Mesh does not approximate the sphere" << endl;
+			return 1;
+		}
+	}
+	if (adaptive.samples * 10 > reference.samples * 9) {
+		cerr << "Adaptive sampling does not save field evaluations" << endl;
+		return 2;
+	}
+	return 0;
+}
@@ -0,0 +1,103 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+// Tests for compile-time sized uniform grid
+#include <isomesh/isomesh.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+using std::cerr;
+using std::clog;
+using std::endl;
+
+class WavySphereScalarField : public isomesh::ScalarField {
+public:
+	virtual double value (double x, double y, double z) const noexcept override {
+		return glm::length (glm::dvec3 (x, y, z)) - 11.3 + 1.5 * std::sin (0.7 * x);
+	}
+	virtual glm::dvec3 grad (double x, double y, double z) const noexcept override {
+		return glm::normalize (glm::dvec3 (x, y, z)) + glm::dvec3 (1.05 * std::cos (0.7 * x), 0, 0);
+	}
+};
+
+bool sameMeshes (const isomesh::Mesh &m1, const isomesh::Mesh &m2) {
+	return m1.vertexCount () == m2.vertexCount () && m1.indexCount () == m2.indexCount () &&
+	       memcmp (m1.vertexData (), m2.vertexData (), m1.vertexBytes ()) == 0 &&
+	       memcmp (m1.indexData (), m2.indexData (), m1.indexBytes ()) == 0;
+}
+
+// Fixed grid indexing must agree with the generic one
+template<uint32_t N>
+int testIndexing () {
+	isomesh::FixedUniformGrid<N> F;
+	const isomesh::UniformGrid &G = F;
+	if (F.dataSize () != G.dataSize () || F.maxCoord () != G.maxCoord ())
+		return 1;
+	for (uint32_t idx = 0; idx < F.dataSize (); idx++) {
+		glm::ivec3 p = G.indexToPoint (idx);
+		if (F.indexToPoint (idx) != p || F.pointToIndex (p) != idx)
+			return 1;
+		if (F.isCellInGrid (p) != G.isCellInGrid (p))
+			return 1;
+		if (F.template adjacentCellsForEdge<0> (p) != G.adjacentCellsForEdge<0> (p) && G.isEdgeInGrid<0> (p))
+			return 1;
+		if (F.template adjacentCellsForEdge<1> (p) != G.adjacentCellsForEdge<1> (p) && G.isEdgeInGrid<1> (p))
+			return 1;
+		if (F.template adjacentCellsForEdge<2> (p) != G.adjacentCellsForEdge<2> (p) && G.isEdgeInGrid<2> (p))
+			return 1;
+		if (G.isCellInGrid (p) && (F.adjacentVerticesForCell (idx) != G.adjacentVerticesForCell (idx) ||
+		                           F.materialsOfCell (idx) != G.materialsOfCell (idx)))
+			return 1;
+	}
+	return 0;
+}
+
+int main () {
+	if (testIndexing<2> () || testIndexing<8> () || testIndexing<32> ()) {
+		cerr << "Fixed grid indexing differs from generic one" << endl;
+		return 1;
+	}
+	WavySphereScalarField field;
+	isomesh::BisectionZeroFinder zero_finder;
+	isomesh::QefSolver3D solver;
+	isomesh::FixedUniformGrid<32> F;
+	isomesh::UniformGrid G (32);
+	F.fill (field, zero_finder);
+	G.fill (field, zero_finder);
+
+	auto time = [] (const char *name, auto &&extract) {
+		const int kRuns = 20;
+		isomesh::Mesh mesh;
+		auto start = std::chrono::steady_clock::now ();
+		for (int i = 0; i < kRuns; i++)
+			mesh = extract ();
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now () - start;
+		clog << name << ": " << elapsed.count () / kRuns << " ms" << endl;
+		return mesh;
+	};
+	isomesh::Mesh mc = time ("Marching cubes (fixed)", [&] () { return isomesh::marchingCubes (F); });
+	isomesh::Mesh mc_ref = time ("Marching cubes (generic)", [&] () { return isomesh::marchingCubes (G); });
+	if (mc.vertexCount () == 0) {
+		cerr << "Mesh is empty" << endl;
+		return 2;
+	}
+	if (!sameMeshes (mc, mc_ref)) {
+		cerr << "Marching cubes over fixed grid gives different mesh" << endl;
+		return 3;
+	}
+	isomesh::Mesh dc = time ("Dual contouring (fixed)", [&] () { return isomesh::dualContouring (F, solver); });
+	isomesh::Mesh dc_ref = time ("Dual contouring (generic)", [&] () { return isomesh::dualContouring (G, solver); });
+	if (!sameMeshes (dc, dc_ref)) {
+		cerr << "Dual contouring over fixed grid gives different mesh" << endl;
+		return 4;
+	}
+	isomesh::Mesh sn = time ("Surface nets (fixed)", [&] () { return isomesh::surfaceNets (F, 2); });
+	isomesh::Mesh sn_ref = time ("Surface nets (generic)", [&] () { return isomesh::surfaceNets (G, 2); });
+	if (!sameMeshes (sn, sn_ref)) {
+		cerr << "Surface nets over fixed grid give different mesh" << endl;
+		return 5;
+	}
+	return 0;
+}
@@ -3,8 +3,19 @@
 // Tests for uniform grid
 #include <isomesh/util/zero_finder.hpp>
 #include <isomesh/data/grid.hpp>
+#include <isomesh/data/dc_octree.hpp>
+#include <isomesh/data/mdc_octree.hpp>
+#include <isomesh/algo/marching_cubes.hpp>
+#include <isomesh/algo/uniform_dual_contouring.hpp>
+#include <isomesh/util/tables.hpp>
 
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
 
 using std::cerr;
 using std::clog;
@@ -97,6 +108,517 @@ public:
 	}
 };
 
+// Sphere with a spherical dent (dug by a "player") around the given point
+class DentedSphereScalarField : public isomesh::ScalarField {
+public:
+	explicit DentedSphereScalarField (double dentRadius) noexcept : m_dentRadius (dentRadius) {}
+	virtual double value (double x, double y, double z) const noexcept override {
+		glm::dvec3 p (x, y, z);
+		double sphere = glm::length (p) - 6.3;
+		double dent = m_dentRadius - glm::length (p - kDentCenter);
+		return glm::max (sphere, dent);
+	}
+	virtual glm::dvec3 grad (double x, double y, double z) const noexcept override {
+		glm::dvec3 p (x, y, z);
+		if (glm::length (p) - 6.3 >= m_dentRadius - glm::length (p - kDentCenter))
+			return glm::normalize (p);
+		return glm::normalize (kDentCenter - p);
+	}
+	static const glm::dvec3 kDentCenter;
+private:
+	const double m_dentRadius;
+};
+
+const glm::dvec3 DentedSphereScalarField::kDentCenter (5.2, 2.1, -1.3);
+
+template<int D>
+bool compareEdges (const UniformGrid &G1, const UniformGrid &G2) {
+	if (G1.edges<D> ().size () != G2.edges<D> ().size ())
+		return false;
+	auto iter = G2.edges<D> ().begin ();
+	for (const auto &edge : G1.edges<D> ()) {
+		if (edge.lesserEndpoint () != iter->lesserEndpoint ())
+			return false;
+		if (glm::length (edge.surfacePoint () - iter->surfacePoint ()) > 1e-5f)
+			return false;
+		if (edge.isLesserEndpointSolid () != iter->isLesserEndpointSolid ())
+			return false;
+		++iter;
+	}
+	return true;
+}
+
+// Check that partial refill gives the same grid as full one
+int testRefill () {
+	isomesh::BisectionZeroFinder solver;
+	isomesh::QefSolver3D qef_solver;
+	DentedSphereScalarField F_old (0.0), F_new (2.5);
+	const int sz = 16;
+	UniformGrid G (sz), G_ref (sz);
+	G.fill (F_old, solver);
+	G_ref.fill (F_new, solver);
+	isomesh::DC_Octree octree (sz), octree_ref (sz);
+	octree.build (G, qef_solver, 0.01f);
+	// Dent bounding box, rounded outwards to grid points
+	glm::ivec3 dirty_min = glm::ivec3 (glm::floor (DentedSphereScalarField::kDentCenter - 2.5));
+	glm::ivec3 dirty_max = glm::ivec3 (glm::ceil (DentedSphereScalarField::kDentCenter + 2.5));
+	G.refill (F_new, solver, dirty_min, dirty_max);
+	for (uint32_t i = 0; i < G.dataSize (); i++) {
+		if (G.data ()[i] != G_ref.data ()[i]) {
+			cerr << "Refilled grid materials differ from filled ones" << endl;
+			return 3;
+		}
+	}
+	if (!compareEdges<0> (G, G_ref) || !compareEdges<1> (G, G_ref) || !compareEdges<2> (G, G_ref)) {
+		cerr << "Refilled grid edges differ from filled ones" << endl;
+		return 4;
+	}
+	octree.update (G, qef_solver, 0.01f, dirty_min, dirty_max);
+	octree_ref.build (G_ref, qef_solver, 0.01f);
+	auto mesh = octree.contour ();
+	auto mesh_ref = octree_ref.contour ();
+	if (mesh.vertexCount () != mesh_ref.vertexCount () || mesh.indexCount () != mesh_ref.indexCount ()) {
+		cerr << "Updated octree differs from built one" << endl;
+		return 5;
+	}
+	return 0;
+}
+
+// Check that building octree from the field gives the same result as building from a grid
+int testFieldBuild () {
+	isomesh::BisectionZeroFinder solver;
+	isomesh::QefSolver3D qef_solver;
+	DentedSphereScalarField F (2.5);
+	const int sz = 32;
+	const glm::dvec3 pos (0.27, -0.19, 0.13);
+	const double step = 0.5;
+	UniformGrid G (sz, pos, step);
+	G.fill (F, solver);
+	isomesh::DC_Octree octree_ref (sz, pos, step);
+	octree_ref.build (G, qef_solver, 0.01f);
+	auto mesh_ref = octree_ref.contour ();
+	// Both fields making up F are distance fields, so their maximum has Lipschitz constant 1
+	for (double lipschitz : { 1.0, 0.0 }) {
+		isomesh::DC_Octree octree (sz, pos, step);
+		octree.build (F, solver, qef_solver, 0.01f, lipschitz);
+		auto mesh = octree.contour ();
+		if (mesh.vertexCount () != mesh_ref.vertexCount () || mesh.indexCount () != mesh_ref.indexCount ()) {
+			cerr << "Octree built from field (Lipschitz constant " << lipschitz << ") differs from built from grid" << endl;
+			return 6;
+		}
+		for (uint32_t i = 0; i < mesh.vertexCount (); i++) {
+			if (glm::length (mesh[i].position - mesh_ref[i].position) > 1e-5f) {
+				cerr << "Octree built from field has different vertices" << endl;
+				return 7;
+			}
+		}
+	}
+	return 0;
+}
+
+bool compareMeshes (const isomesh::Mesh &m1, const isomesh::Mesh &m2, float tolerance = 1e-5f) {
+	if (m1.vertexCount () != m2.vertexCount () || m1.indexCount () != m2.indexCount ())
+		return false;
+	for (uint32_t i = 0; i < m1.vertexCount (); i++)
+		if (glm::length (m1[i].position - m2[i].position) > tolerance)
+			return false;
+	const uint32_t *idx1 = static_cast<const uint32_t *> (m1.indexData ());
+	const uint32_t *idx2 = static_cast<const uint32_t *> (m2.indexData ());
+	return std::equal (idx1, idx1 + m1.indexCount (), idx2);
+}
+
+// Check surface cells list and that extractors give the same results with it
+int testSurfaceCells () {
+	isomesh::BisectionZeroFinder solver;
+	isomesh::QefSolver3D qef_solver;
+	DentedSphereScalarField F (2.5);
+	const int sz = 16;
+	UniformGrid G (sz), G_ref (sz);
+	G.trackSurfaceCells (true);
+	G.fill (F, solver);
+	G_ref.fill (F, solver);
+	if (!G_ref.surfaceCells ().empty ()) {
+		cerr << "Surface cells are built without tracking" << endl;
+		return 8;
+	}
+	// Every cell with the surface must be listed, with correct edges
+	size_t expected_count = 0;
+	for (uint32_t idx = 0; idx < G.dataSize (); idx++) {
+		glm::ivec3 cell_pos = G.indexToPoint (idx);
+		if (!G.isCellInGrid (cell_pos))
+			continue;
+		auto materials = G.materialsOfCell (idx);
+		uint32_t vertex_mask = 0;
+		for (int i = 0; i < 8; i++)
+			if (materials[i] != isomesh::Material::Empty)
+				vertex_mask |= 1u << i;
+		uint16_t edge_mask = isomesh::kMcVertexMaskToEdgeMask[vertex_mask];
+		const auto *cell = G.findSurfaceCell (idx);
+		if (edge_mask == 0) {
+			if (cell) {
+				cerr << "Cell without surface is listed" << endl;
+				return 9;
+			}
+			continue;
+		}
+		expected_count++;
+		if (!cell || cell->edgeMask != edge_mask) {
+			cerr << "Surface cell is missing or has wrong edge mask" << endl;
+			return 10;
+		}
+		const isomesh::UniformGridEdgeStorage *storages[3] = { &G.edges<0> (), &G.edges<1> (), &G.edges<2> () };
+		for (int i = 0; i < 12; i++) {
+			if (!(edge_mask & (1 << i)))
+				continue;
+			const auto &edge = (*storages[isomesh::kCellEdgeDirection[i]])[cell->edgeIndex[i]];
+			if (edge.lesserEndpoint () != cell_pos + isomesh::kCellCornerOffset[isomesh::kCellEdgeEndpoint[i][0]]) {
+				cerr << "Surface cell refers to a wrong edge" << endl;
+				return 11;
+			}
+		}
+	}
+	if (G.surfaceCells ().size () != expected_count) {
+		cerr << "Surface cells list has extra entries" << endl;
+		return 12;
+	}
+	if (!compareMeshes (isomesh::marchingCubes (G), isomesh::marchingCubes (G_ref)) ||
+	    !compareMeshes (isomesh::dualContouring (G, qef_solver), isomesh::dualContouring (G_ref, qef_solver))) {
+		cerr << "Extracting with surface cells gives different mesh" << endl;
+		return 13;
+	}
+	isomesh::DC_Octree dc (sz), dc_ref (sz);
+	dc.build (G, qef_solver, 0.01f);
+	dc_ref.build (G_ref, qef_solver, 0.01f);
+	isomesh::MDC_Octree mdc (sz), mdc_ref (sz);
+	mdc.build (G, qef_solver);
+	mdc_ref.build (G_ref, qef_solver);
+	if (!compareMeshes (dc.contour (), dc_ref.contour ()) || !compareMeshes (mdc.contour (0.01f), mdc_ref.contour (0.01f))) {
+		cerr << "Octree built with surface cells gives different mesh" << endl;
+		return 14;
+	}
+	// Refill must keep the list up to date, with any layout
+	DentedSphereScalarField F_new (3.5);
+	PlaneScalarField F_plane;
+	for (auto layout : { isomesh::UniformGridLayout::Linear, isomesh::UniformGridLayout::Tiled }) {
+		UniformGrid G_edit (sz, glm::dvec3 (0.0), 1.0, layout);
+		G_edit.trackSurfaceCells (true);
+		G_edit.fill (F, solver);
+		G_edit.refill (F_new, solver, glm::ivec3 (1, -2, -5), glm::ivec3 (8, 6, 3));
+		UniformGrid G_new (sz, glm::dvec3 (0.0), 1.0, layout);
+		G_new.fill (F_new, solver);
+		G_new.trackSurfaceCells (true);
+		// Plane crosses the whole grid, so edges above and below the edited box are reindexed too
+		G_edit.refill (F_plane, solver, glm::ivec3 (-3, -1, -4), glm::ivec3 (2, 3, 1));
+		G_new.refill (F_plane, solver, glm::ivec3 (-3, -1, -4), glm::ivec3 (2, 3, 1));
+		G_new.trackSurfaceCells (false);
+		G_new.trackSurfaceCells (true);
+		const auto &cells = G_edit.surfaceCells (), &cells_new = G_new.surfaceCells ();
+		if (cells.size () != cells_new.size () || !std::equal (cells.begin (), cells.end (), cells_new.begin (),
+			[] (const isomesh::UniformGridSurfaceCell &a, const isomesh::UniformGridSurfaceCell &b) {
+				return a.cellIndex == b.cellIndex && a.edgeMask == b.edgeMask &&
+				       std::equal (a.edgeIndex, a.edgeIndex + 12, b.edgeIndex);
+			})) {
+			cerr << "Surface cells are not updated by refill" << endl;
+			return 15;
+		}
+	}
+	return 0;
+}
+
+// Tiled layout must store the same grid, only point indices differ
+int testTiledLayout () {
+	isomesh::BisectionZeroFinder solver;
+	isomesh::QefSolver3D qef_solver;
+	DentedSphereScalarField F (2.5);
+	const int sz = 16;
+	UniformGrid G (sz, glm::dvec3 (0), 1.0, isomesh::UniformGridLayout::Tiled), G_ref (sz);
+	G.fill (F, solver);
+	G_ref.fill (F, solver);
+	std::vector<bool> used (G.dataSize (), false);
+	const int32_t h = G.maxCoord ();
+	for (int32_t y = -h; y <= h; y++)
+		for (int32_t x = -h; x <= h; x++)
+			for (int32_t z = -h; z <= h; z++) {
+				glm::ivec3 p (x, y, z);
+				uint32_t idx = G.pointToIndex (p);
+				if (idx >= G.dataSize () || used[idx] || G.indexToPoint (idx) != p) {
+					cerr << "Tiled layout indexing is not a bijection" << endl;
+					return 16;
+				}
+				used[idx] = true;
+				if (G[p] != G_ref[p]) {
+					cerr << "Tiled layout grid has different materials" << endl;
+					return 17;
+				}
+				if (G.isCellInGrid (p) && (G.materialsOfCell (idx) != G_ref.materialsOfCell (G_ref.pointToIndex (p)) ||
+				                           G.materialsOfCell (idx) != G.materialsOfCell (p))) {
+					cerr << "Tiled layout cell has different materials" << endl;
+					return 18;
+				}
+			}
+	auto sameCells = [&] (auto D, const glm::ivec3 &edge_pos) {
+		auto cells = G.adjacentCellsForEdge<decltype (D)::value> (edge_pos);
+		auto cells_ref = G_ref.adjacentCellsForEdge<decltype (D)::value> (edge_pos);
+		for (int i = 0; i < 4; i++) {
+			if ((cells[i] == isomesh::kBadIndex) != (cells_ref[i] == isomesh::kBadIndex))
+				return false;
+			if (cells[i] != isomesh::kBadIndex && G.indexToPoint (cells[i]) != G_ref.indexToPoint (cells_ref[i]))
+				return false;
+		}
+		return true;
+	};
+	bool same_edges = G.edges<0> ().size () == G_ref.edges<0> ().size () &&
+	                  G.edges<1> ().size () == G_ref.edges<1> ().size () &&
+	                  G.edges<2> ().size () == G_ref.edges<2> ().size ();
+	for (const auto &edge : G.edges<0> ())
+		same_edges = same_edges && sameCells (std::integral_constant<int, 0> (), edge.lesserEndpoint ());
+	for (const auto &edge : G.edges<1> ())
+		same_edges = same_edges && sameCells (std::integral_constant<int, 1> (), edge.lesserEndpoint ());
+	for (const auto &edge : G.edges<2> ())
+		same_edges = same_edges && sameCells (std::integral_constant<int, 2> (), edge.lesserEndpoint ());
+	if (!same_edges) {
+		cerr << "Tiled layout grid has different edges" << endl;
+		return 19;
+	}
+	// Octree output does not depend on cell indices
+	isomesh::DC_Octree dc (sz), dc_ref (sz);
+	dc.build (G, qef_solver, 0.01f);
+	dc_ref.build (G_ref, qef_solver, 0.01f);
+	isomesh::MDC_Octree mdc (sz), mdc_ref (sz);
+	mdc.build (G, qef_solver);
+	mdc_ref.build (G_ref, qef_solver);
+	if (!compareMeshes (dc.contour (), dc_ref.contour ()) || !compareMeshes (mdc.contour (0.01f), mdc_ref.contour (0.01f))) {
+		cerr << "Octree built from tiled layout grid gives different mesh" << endl;
+		return 20;
+	}
+	// Uniform extractors emit cells in index order, so only sizes are compared
+	isomesh::Mesh mc = isomesh::marchingCubes (G), mc_ref = isomesh::marchingCubes (G_ref);
+	isomesh::Mesh udc = isomesh::dualContouring (G, qef_solver), udc_ref = isomesh::dualContouring (G_ref, qef_solver);
+	if (mc.vertexCount () != mc_ref.vertexCount () || mc.indexCount () != mc_ref.indexCount () ||
+	    udc.vertexCount () != udc_ref.vertexCount () || udc.indexCount () != udc_ref.indexCount ()) {
+		cerr << "Extracting from tiled layout grid gives different mesh" << endl;
+		return 21;
+	}
+	return 0;
+}
+
+// Saved and loaded grid must be identical to the original one
+int testSaveLoad () {
+	isomesh::BisectionZeroFinder solver;
+	isomesh::QefSolver3D qef_solver;
+	DentedSphereScalarField F (2.5);
+	const char *path = "test-grid-save.bin";
+	const isomesh::UniformGridLayout layouts[2] = { isomesh::UniformGridLayout::Linear, isomesh::UniformGridLayout::Tiled };
+	for (auto layout : layouts) {
+		UniformGrid G (16, glm::dvec3 (1.5, -2.0, 7.25), 0.5, layout);
+		G.trackSurfaceCells (layout == isomesh::UniformGridLayout::Tiled);
+		G.fill (F, solver);
+		G.save (path);
+		UniformGrid L = UniformGrid::load (path);
+		if (L.gridSize () != G.gridSize () || L.layout () != G.layout () || L.gridStep () != G.gridStep () ||
+		    L.globalPosition () != G.globalPosition () || L.surfaceCellsTracked () != G.surfaceCellsTracked () ||
+		    L.surfaceCells ().size () != G.surfaceCells ().size () ||
+		    !std::equal (G.data (), G.data () + G.dataSize (), L.data ())) {
+			cerr << "Loaded grid differs from saved one" << endl;
+			return 22;
+		}
+		bool same_edges = true;
+		auto compareEdges = [&] (const isomesh::UniformGridEdgeStorage &e1, const isomesh::UniformGridEdgeStorage &e2) {
+			if (e1.size () != e2.size ()) {
+				same_edges = false;
+				return;
+			}
+			for (size_t i = 0; i < e1.size (); i++)
+				if (e1[i].lesserEndpoint () != e2[i].lesserEndpoint () || e1[i].surfacePoint () != e2[i].surfacePoint () ||
+				    e1[i].surfaceNormal () != e2[i].surfaceNormal () ||
+				    e1[i].solidEndpointMaterial () != e2[i].solidEndpointMaterial () ||
+				    e1[i].isLesserEndpointSolid () != e2[i].isLesserEndpointSolid ())
+					same_edges = false;
+		};
+		compareEdges (G.edges<0> (), L.edges<0> ());
+		compareEdges (G.edges<1> (), L.edges<1> ());
+		compareEdges (G.edges<2> (), L.edges<2> ());
+		if (!same_edges) {
+			cerr << "Loaded grid has different edges" << endl;
+			return 23;
+		}
+		isomesh::DC_Octree dc (16), dc_loaded (16);
+		dc.build (G, qef_solver, 0.01f);
+		dc_loaded.build (L, qef_solver, 0.01f);
+		if (!compareMeshes (dc.contour (), dc_loaded.contour ())) {
+			cerr << "Loaded grid gives different mesh" << endl;
+			return 24;
+		}
+	}
+	// Edges out of the grid or out of order must be rejected too
+	UniformGrid G (16, glm::dvec3 (0.0), 1.0);
+	G.fill (F, solver);
+	const size_t edge_size = sizeof (isomesh::UniformGridEdge);
+	const auto &edges = G.edges<2> ();
+	for (int damage = 0; damage < 2; damage++) {
+		G.save (path);
+		{
+			std::fstream file (path, std::ios::binary | std::ios::in | std::ios::out);
+			file.seekp (-std::streamoff ((edges.size () - 2) * edge_size), std::ios::end);
+			isomesh::UniformGridEdge edge = damage ? edges[0] : edges[1].translated (glm::ivec3 (0, 0, 100));
+			file.write (reinterpret_cast<const char *> (&edge), std::streamsize (edge_size));
+		}
+		bool thrown = false;
+		try {
+			UniformGrid::load (path);
+		}
+		catch (const std::runtime_error &) {
+			thrown = true;
+		}
+		if (!thrown) {
+			std::remove (path);
+			cerr << (damage ? "Loading unsorted edges didn't throw" : "Loading edges out of grid didn't throw") << endl;
+			return 34 + damage;
+		}
+	}
+	// Damaged files must be rejected
+	{
+		std::ofstream file (path, std::ios::binary | std::ios::trunc);
+		file << "ISOGRID";
+	}
+	bool thrown = false;
+	try {
+		UniformGrid::load (path);
+	}
+	catch (const std::runtime_error &) {
+		thrown = true;
+	}
+	std::remove (path);
+	if (!thrown) {
+		cerr << "Loading damaged file didn't throw" << endl;
+		return 25;
+	}
+	return 0;
+}
+
+// Dented sphere field counting its evaluations
+class CountingScalarField : public DentedSphereScalarField {
+public:
+	CountingScalarField () noexcept : DentedSphereScalarField (2.5) {}
+	virtual double value (double x, double y, double z) const noexcept override {
+		calls++;
+		return DentedSphereScalarField::value (x, y, z);
+	}
+	mutable uint64_t calls = 0;
+};
+
+// Check that grids filled with imported boundary planes match independently filled ones
+int testBoundaryPlanes () {
+	isomesh::BisectionZeroFinder solver;
+	CountingScalarField F;
+	const int sz = 8;
+	const double step = 0.75;
+	const glm::dvec3 base (-1.0, 0.5, -2.0);
+	// Lower X face of B is shared with A, lower Z face of B is shared with C
+	UniformGrid A (sz, base - glm::dvec3 (sz * step, 0, 0), step);
+	UniformGrid C (sz, base - glm::dvec3 (0, 0, sz * step), step);
+	UniformGrid B (sz, base, step), B_ref (sz, base, step);
+	isomesh::UniformGridBoundary a_plane, c_plane;
+	A.fill (F, solver, {}, { nullptr, &a_plane, nullptr, nullptr, nullptr, nullptr });
+	C.fill (F, solver, {}, { nullptr, nullptr, nullptr, nullptr, nullptr, &c_plane });
+	F.calls = 0;
+	B_ref.fill (F, solver);
+	uint64_t ref_calls = F.calls;
+	F.calls = 0;
+	B.fill (F, solver, { &a_plane, nullptr, nullptr, nullptr, &c_plane, nullptr }, {});
+	// Points of both planes (their common line counted once) are not sampled, and in-plane edges are not solved
+	if (F.calls + 2 * (sz + 1) * (sz + 1) - (sz + 1) > ref_calls) {
+		cerr << "Imported planes were sampled again" << endl;
+		return 26;
+	}
+	if (!std::equal (B.data (), B.data () + B.dataSize (), B_ref.data ())) {
+		cerr << "Grid filled with imported planes has different materials" << endl;
+		return 27;
+	}
+	if (!compareEdges<0> (B, B_ref) || !compareEdges<1> (B, B_ref) || !compareEdges<2> (B, B_ref)) {
+		cerr << "Grid filled with imported planes has different edges" << endl;
+		return 28;
+	}
+	// Seam edges must be exactly the same as in the neighbour
+	for (int D = 1; D < 3; D++) {
+		const auto &b_edges = (D == 1) ? B.edges<1> () : B.edges<2> ();
+		const auto &a_edges = (D == 1) ? A.edges<1> () : A.edges<2> ();
+		for (const auto &edge : a_edges) {
+			glm::ivec3 p = edge.lesserEndpoint ();
+			if (p.x != sz / 2)
+				continue;
+			auto iter = b_edges.findEdge (-sz / 2, p.y, p.z);
+			if (iter == b_edges.end () || iter->surfacePoint () - glm::vec3 (-sz / 2, p.y, p.z) !=
+			    edge.surfacePoint () - glm::vec3 (p) || iter->surfaceNormal () != edge.surfaceNormal ()) {
+				cerr << "Seam edges differ from neighbour ones" << endl;
+				return 29;
+			}
+		}
+	}
+	// Planes of grids placed elsewhere or having another step must be rejected
+	UniformGrid B_shifted (sz, base + glm::dvec3 (0, step, 0), step), B_scaled (sz, base, 2.0 * step);
+	for (UniformGrid *G : { &B_shifted, &B_scaled }) {
+		bool thrown = false;
+		try {
+			G->fill (F, solver, { &a_plane, nullptr, nullptr, nullptr, nullptr, nullptr }, {});
+		}
+		catch (const std::invalid_argument &) {
+			thrown = true;
+		}
+		if (!thrown) {
+			cerr << "Plane of a non-adjacent grid was imported" << endl;
+			return 36;
+		}
+	}
+	return 0;
+}
+
+// Check that downsampled grids match grids filled with larger step
+int testDownsample () {
+	isomesh::BisectionZeroFinder solver (30);
+	isomesh::QefSolver3D qef_solver;
+	DentedSphereScalarField F (2.5);
+	const glm::dvec3 pos (0.25, -0.5, 0.75);
+	const isomesh::UniformGridLayout layouts[2] = { isomesh::UniformGridLayout::Linear, isomesh::UniformGridLayout::Tiled };
+	for (auto layout : layouts) {
+		UniformGrid fine (32, pos, 0.5, layout);
+		fine.fill (F, solver);
+		// Build the pyramid down to size 8
+		UniformGrid coarse = fine.downsample ().downsample ();
+		UniformGrid ref (8, pos, 2.0, layout);
+		ref.fill (F, solver);
+		if (coarse.gridSize () != 8 || coarse.gridStep () != 2.0 || coarse.layout () != layout ||
+		    coarse.globalPosition () != pos || !std::equal (ref.data (), ref.data () + ref.dataSize (), coarse.data ())) {
+			cerr << "Downsampled grid has different materials or parameters" << endl;
+			return 30;
+		}
+		if (!compareEdges<0> (coarse, ref) || !compareEdges<1> (coarse, ref) || !compareEdges<2> (coarse, ref)) {
+			cerr << "Downsampled grid has different edges" << endl;
+			return 31;
+		}
+		isomesh::DC_Octree dc (8), dc_ref (8);
+		dc.build (coarse, qef_solver, 0.01f);
+		dc_ref.build (ref, qef_solver, 0.01f);
+		// QEF solutions amplify float rounding of reused normals
+		if (!compareMeshes (dc.contour (), dc_ref.contour (), 1e-3f)) {
+			cerr << "Downsampled grid gives different mesh" << endl;
+			return 32;
+		}
+	}
+	bool thrown = false;
+	try {
+		UniformGrid (2).downsample ();
+	}
+	catch (const std::invalid_argument &) {
+		thrown = true;
+	}
+	if (!thrown) {
+		cerr << "Downsampling too small grid didn't throw" << endl;
+		return 33;
+	}
+	return 0;
+}
+
 int main () {
 	/* Code below will create a grid and fill it using a simple
 	 plane function. The grid then may be checked for correctness,
@@ -142,5 +664,23 @@ int main () {
 		return 2;
 	}
 
-	return 0;
+	int ret = testRefill ();
+	if (ret)
+		return ret;
+	ret = testFieldBuild ();
+	if (ret)
+		return ret;
+	ret = testSurfaceCells ();
+	if (ret)
+		return ret;
+	ret = testTiledLayout ();
+	if (ret)
+		return ret;
+	ret = testSaveLoad ();
+	if (ret)
+		return ret;
+	ret = testBoundaryPlanes ();
+	if (ret)
+		return ret;
+	return testDownsample ();
 }
@@ -0,0 +1,126 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+// Tests for compressed grids and grid cache
+#include <isomesh/isomesh.hpp>
+
+#include <cmath>
+#include <iostream>
+
+using std::cerr;
+using std::clog;
+using std::endl;
+
+class BumpySphereScalarField : public isomesh::ScalarField {
+public:
+	explicit BumpySphereScalarField (double radius) : m_radius (radius) {}
+	virtual double value (double x, double y, double z) const noexcept override {
+		return glm::length (glm::dvec3 (x, y, z)) - m_radius + std::sin (0.5 * x) * std::cos (0.4 * z);
+	}
+	virtual glm::dvec3 grad (double x, double y, double z) const noexcept override {
+		return glm::normalize (glm::dvec3 (x, y, z)) +
+			glm::dvec3 (0.5 * std::cos (0.5 * x) * std::cos (0.4 * z), 0, -0.4 * std::sin (0.5 * x) * std::sin (0.4 * z));
+	}
+	virtual isomesh::Material material (double, double y, double, double) const noexcept override {
+		return y > 0 ? isomesh::Material::Soil : isomesh::Material::Stone;
+	}
+
+private:
+	double m_radius;
+};
+
+size_t gridMemory (const isomesh::UniformGrid &G) {
+	return G.dataSize () + (G.edges<0> ().size () + G.edges<1> ().size () + G.edges<2> ().size ()) *
+		sizeof (isomesh::UniformGridEdge);
+}
+
+bool sameEdges (const isomesh::UniformGridEdgeStorage &e1, const isomesh::UniformGridEdgeStorage &e2) {
+	if (e1.size () != e2.size ())
+		return false;
+	for (size_t i = 0; i < e1.size (); i++) {
+		if (e1[i].lesserEndpoint () != e2[i].lesserEndpoint () ||
+		    e1[i].isLesserEndpointSolid () != e2[i].isLesserEndpointSolid () ||
+		    e1[i].solidEndpointMaterial () != e2[i].solidEndpointMaterial ())
+			return false;
+		if (glm::length (e1[i].surfacePoint () - e2[i].surfacePoint ()) > 1e-4f ||
+		    glm::length (e1[i].surfaceNormal () - e2[i].surfaceNormal ()) > 1e-3f)
+			return false;
+	}
+	return true;
+}
+
+int testCompression () {
+	BumpySphereScalarField field (23.7);
+	isomesh::BisectionZeroFinder zero_finder;
+	const isomesh::UniformGridLayout layouts[2] = { isomesh::UniformGridLayout::Linear, isomesh::UniformGridLayout::Tiled };
+	for (auto layout : layouts) {
+		isomesh::UniformGrid G (64, glm::dvec3 (3, 5, 7), 0.5, layout);
+		G.fill (field, zero_finder);
+		isomesh::CompressedGrid C (G);
+		clog << "Grid takes " << gridMemory (G) << " bytes, compressed " << C.memoryUsage () << " bytes" << endl;
+		if (C.memoryUsage () * 4 > gridMemory (G)) {
+			cerr << "Grid is compressed too weakly" << endl;
+			return 1;
+		}
+		isomesh::UniformGrid D = C.decompress ();
+		if (D.gridSize () != G.gridSize () || D.layout () != G.layout () || D.gridStep () != G.gridStep () ||
+		    D.globalPosition () != G.globalPosition () || !std::equal (G.data (), G.data () + G.dataSize (), D.data ())) {
+			cerr << "Decompressed grid has different materials or parameters" << endl;
+			return 2;
+		}
+		if (!sameEdges (G.edges<0> (), D.edges<0> ()) || !sameEdges (G.edges<1> (), D.edges<1> ()) ||
+		    !sameEdges (G.edges<2> (), D.edges<2> ())) {
+			cerr << "Decompressed grid has different edges" << endl;
+			return 3;
+		}
+	}
+	return 0;
+}
+
+int testCache () {
+	BumpySphereScalarField field (5.3);
+	isomesh::BisectionZeroFinder zero_finder;
+	isomesh::UniformGrid G (16);
+	G.fill (field, zero_finder);
+	size_t grid_bytes = isomesh::CompressedGrid (G).memoryUsage ();
+	// Room for two grids only
+	isomesh::GridCache cache (2 * grid_bytes + grid_bytes / 2);
+	const glm::ivec3 keys[3] = { { 0, 0, 0 }, { 1, 0, 0 }, { 0, -1, 2 } };
+	cache.put (keys[0], G);
+	cache.put (keys[1], G);
+	// Touching the first grid makes the second one least recently used
+	auto restored = cache.get (keys[0]);
+	if (!restored || restored->edges<0> ().size () != G.edges<0> ().size ()) {
+		cerr << "Cache lost a grid" << endl;
+		return 4;
+	}
+	cache.put (keys[2], G);
+	if (cache.size () != 2 || !cache.contains (keys[0]) || cache.contains (keys[1]) || !cache.contains (keys[2]) ||
+	    cache.memoryUsage () > cache.memoryBudget ()) {
+		cerr << "Cache evicted wrong grid" << endl;
+		return 5;
+	}
+	if (cache.get (keys[1]) || !cache.get (keys[2])) {
+		cerr << "Cache returned wrong grids" << endl;
+		return 6;
+	}
+	const auto &stats = cache.stats ();
+	if (stats.hits != 2 || stats.misses != 1 || stats.evictions != 1) {
+		cerr << "Wrong cache statistics" << endl;
+		return 7;
+	}
+	cache.setMemoryBudget (grid_bytes);
+	bool fits = (cache.size () == 1 && cache.contains (keys[2]));
+	cache.setMemoryBudget (grid_bytes - 1);
+	if (!fits || cache.size () != 0 || cache.memoryUsage () != 0 || cache.put (keys[0], G)) {
+		cerr << "Cache doesn't respect memory budget" << endl;
+		return 8;
+	}
+	return 0;
+}
+
+int main () {
+	int ret = testCompression ();
+	if (ret)
+		return ret;
+	return testCache ();
+}
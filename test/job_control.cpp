@@ -0,0 +1,158 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+// Tests for cancellable asynchronous jobs
+#include <isomesh/isomesh.hpp>
+
+#include <iostream>
+
+using std::cerr;
+using std::endl;
+
+class SphereScalarField : public isomesh::ScalarField {
+public:
+	virtual double value (double x, double y, double z) const noexcept override {
+		return glm::length (glm::dvec3 (x, y, z) - kCenter) - kRadius;
+	}
+	virtual glm::dvec3 grad (double x, double y, double z) const noexcept override {
+		return glm::normalize (glm::dvec3 (x, y, z) - kCenter);
+	}
+	static constexpr double kRadius = 9.7;
+	static const glm::dvec3 kCenter;
+};
+
+const glm::dvec3 SphereScalarField::kCenter (0.3, -0.2, 0.1);
+
+int testProgress () {
+	SphereScalarField F;
+	isomesh::BisectionZeroFinder zero_finder;
+	isomesh::QefSolver3D solver;
+	const int sz = 32;
+	isomesh::UniformGrid reference_grid (sz);
+	reference_grid.fill (F, zero_finder);
+	isomesh::DC_Octree reference_octree (sz);
+	reference_octree.build (reference_grid, solver, 0.01f);
+	auto reference = reference_octree.contour ();
+
+	isomesh::JobControl control;
+	float last_reported = 0.0f;
+	bool monotonic = true;
+	control.setProgressCallback ([&] (float value) {
+		monotonic &= (value > last_reported);
+		last_reported = value;
+	});
+	isomesh::UniformGrid G (sz);
+	G.fill (F, zero_finder, &control);
+	if (control.progress () != 1.0f || last_reported != 1.0f || !monotonic) {
+		cerr << "Grid fill progress is wrong (" << control.progress () << ", last reported "
+		     << last_reported << ")" << endl;
+		return 1;
+	}
+	if (G.edges<0> ().size () != reference_grid.edges<0> ().size () ||
+	    G.edges<2> ().size () != reference_grid.edges<2> ().size ()) {
+		cerr << "Tracked grid fill gives different data" << endl;
+		return 2;
+	}
+	// Executor running jobs in place
+	int executed = 0;
+	isomesh::JobExecutor inline_executor = [&] (std::function<void ()> job) {
+		executed++;
+		job ();
+	};
+	last_reported = 0.0f;
+	isomesh::DC_Octree octree (sz);
+	auto future = isomesh::runAsync ([&] () {
+		octree.build (G, solver, 0.01f, true, &control);
+		return octree.contour ();
+	}, inline_executor);
+	if (executed != 1) {
+		cerr << "Executor was not used" << endl;
+		return 3;
+	}
+	auto mesh = future.get ();
+	if (mesh.indexCount () != reference.indexCount () || control.progress () != 1.0f || !monotonic) {
+		cerr << "Tracked octree build gives different result" << endl;
+		return 4;
+	}
+	// Update progress counts rebuilt subtrees only
+	last_reported = 0.0f;
+	octree.update (G, solver, 0.01f, glm::ivec3 (2), glm::ivec3 (5), true, &control);
+	if (control.progress () != 1.0f || last_reported != 1.0f || !monotonic) {
+		cerr << "Octree update progress is wrong (" << control.progress () << ", last reported "
+		     << last_reported << ")" << endl;
+		return 6;
+	}
+	if (octree.contour ().indexCount () != reference.indexCount ()) {
+		cerr << "Tracked octree update gives different result" << endl;
+		return 7;
+	}
+	// Default executor runs the job with std::async
+	isomesh::MDC_Octree mdc_octree (sz);
+	isomesh::JobControl mdc_control;
+	auto mdc_future = isomesh::runAsync ([&] () {
+		isomesh::QefSolver3D thread_solver;
+		mdc_octree.build (G, thread_solver, &mdc_control);
+	});
+	mdc_future.get ();
+	if (mdc_control.progress () != 1.0f) {
+		cerr << "MDC octree build progress is " << mdc_control.progress () << endl;
+		return 5;
+	}
+	return 0;
+}
+
+int testCancellation () {
+	SphereScalarField F;
+	isomesh::BisectionZeroFinder zero_finder;
+	const int sz = 32;
+	isomesh::JobControl control;
+	control.cancel ();
+	isomesh::UniformGrid G (sz);
+	try {
+		G.fill (F, zero_finder, &control);
+		cerr << "Cancelled grid fill has finished" << endl;
+		return 1;
+	}
+	catch (isomesh::JobCancelled &) {}
+	// Cancel in the middle of the build
+	isomesh::JobControl build_control;
+	build_control.setProgressCallback ([&] (float value) {
+		if (value >= 0.3f)
+			build_control.cancel ();
+	});
+	isomesh::QefSolver4D solver;
+	isomesh::DMC_Octree octree (sz);
+	auto future = isomesh::runAsync ([&] () {
+		octree.build (F, solver, 0.01f, false, true, false, 0xDEADBEEF, &build_control);
+	});
+	try {
+		future.get ();
+		cerr << "Cancelled octree build has finished" << endl;
+		return 2;
+	}
+	catch (isomesh::JobCancelled &) {}
+	if (build_control.progress () >= 0.5f) {
+		cerr << "Octree build was cancelled too late (" << build_control.progress () << ")" << endl;
+		return 3;
+	}
+	// Octree stays usable after cancellation
+	if (octree.contour ().indexCount () != 0) {
+		cerr << "Cancelled octree is not empty" << endl;
+		return 4;
+	}
+	octree.build (F, solver, 0.01f);
+	if (octree.contour ().indexCount () == 0) {
+		cerr << "Octree can't be rebuilt after cancellation" << endl;
+		return 5;
+	}
+	return 0;
+}
+
+int main () {
+	int ret = testProgress ();
+	if (ret)
+		return ret;
+	ret = testCancellation ();
+	if (ret)
+		return 10 + ret;
+	return 0;
+}
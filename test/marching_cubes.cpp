@@ -2,9 +2,13 @@
   Copyright (c) 2018-2019 Pavel Asyutchenko (sventeam@yandex.ru) */
 // Tests for marching cubes algorithm
 #include <isomesh/isomesh.hpp>
+#include <algorithm>
 
 #include <iostream>
 #include <fstream>
+#include <map>
+#include <memory>
+#include <tuple>
 
 using std::cerr;
 using std::clog;
@@ -29,6 +33,90 @@ private:
 	constexpr static double freq_z2 = 0.2;
 };
 
+// Big sphere with optional small one near the corner
+class SpheresScalarField : public isomesh::ScalarField {
+public:
+	explicit SpheresScalarField (bool with_small) : m_withSmall (with_small) {}
+	virtual double value (double x, double y, double z) const noexcept override {
+		glm::dvec3 p (x, y, z);
+		double v = glm::length (p) - 4.5;
+		if (m_withSmall)
+			v = glm::min (v, glm::length (p - kSmallCenter) - 1.2);
+		return v;
+	}
+	virtual glm::dvec3 grad (double x, double y, double z) const noexcept override {
+		glm::dvec3 p (x, y, z);
+		if (m_withSmall && glm::length (p - kSmallCenter) - 1.2 < glm::length (p) - 4.5)
+			return glm::normalize (p - kSmallCenter);
+		return glm::normalize (p);
+	}
+private:
+	bool m_withSmall;
+	static const glm::dvec3 kSmallCenter;
+};
+
+const glm::dvec3 SpheresScalarField::kSmallCenter (5.1, 5.3, 5.2);
+
+// Fine chunk in the positive octant with coarser chunks in the other seven, surface must be watertight
+int testTransitionCells () {
+	isomesh::BisectionZeroFinder solver;
+	SpheresScalarField F (false);
+	const int sz = 16;
+	isomesh::UniformGrid fine (sz, glm::dvec3 (sz / 2));
+	fine.fill (F, solver);
+	std::unique_ptr<isomesh::UniformGrid> coarse[8];
+	std::vector<isomesh::Mesh> meshes;
+	for (int i = 1; i < 8; i++) {
+		glm::dvec3 pos (-sz / 2);
+		pos.x += (i & 1) ? 0 : sz;
+		pos.y += (i & 2) ? 0 : sz;
+		pos.z += (i & 4) ? 0 : sz;
+		coarse[i].reset (new isomesh::UniformGrid (sz / 2, pos, 2.0));
+		coarse[i]->fill (F, solver);
+		meshes.push_back (isomesh::marchingCubes (*coarse[i]));
+	}
+	meshes.push_back (isomesh::marchingCubes (fine, { coarse[1].get (), nullptr, coarse[2].get (), nullptr,
+	                                                  coarse[4].get (), nullptr }));
+	// Fine vertices replaced by coarse ones must be removed
+	const auto &transition_mesh = meshes.back ();
+	std::vector<bool> used (transition_mesh.vertexCount (), false);
+	const uint32_t *transition_indices = static_cast<const uint32_t *> (transition_mesh.indexData ());
+	for (size_t k = 0; k < transition_mesh.indexCount (); k++)
+		used[transition_indices[k]] = true;
+	if (std::find (used.begin (), used.end (), false) != used.end ()) {
+		cerr << "Mesh with transition cells has unused vertices" << endl;
+		return 5;
+	}
+	// Weld meshes by global positions, every edge must be shared by two triangles in opposite directions
+	std::map<std::tuple<long, long, long>, uint32_t> welded;
+	std::map<std::pair<uint32_t, uint32_t>, int> edge_uses;
+	for (const auto &mesh : meshes) {
+		std::vector<uint32_t> ids (mesh.vertexCount ());
+		for (uint32_t k = 0; k < mesh.vertexCount (); k++) {
+			glm::dvec3 p = glm::dvec3 (mesh[k].position) * mesh.globalScale () + mesh.globalPos ();
+			auto key = std::make_tuple (std::lround (p.x * 1e3), std::lround (p.y * 1e3), std::lround (p.z * 1e3));
+			ids[k] = welded.emplace (key, uint32_t (welded.size ())).first->second;
+		}
+		const uint32_t *indices = static_cast<const uint32_t *> (mesh.indexData ());
+		for (size_t k = 0; k < mesh.indexCount (); k += 3) {
+			for (int e = 0; e < 3; e++) {
+				uint32_t a = ids[indices[k + e]];
+				uint32_t b = ids[indices[k + (e + 1) % 3]];
+				if (a < b)
+					edge_uses[std::make_pair (a, b)]++;
+				else edge_uses[std::make_pair (b, a)] += 100;
+			}
+		}
+	}
+	for (const auto &e : edge_uses) {
+		if (e.second != 101) {
+			cerr << "Surface with transition cells is not watertight" << endl;
+			return 6;
+		}
+	}
+	return 0;
+}
+
 int main () {
 	WavesScalarField F;
 	isomesh::BisectionZeroFinder solver;
@@ -67,5 +155,30 @@ int main () {
 		return 2;
 	}
 
-	return 0;
+	// Small components culling must remove the small sphere only
+	isomesh::UniformGrid G1 (sz), G2 (sz);
+	G1.fill (SpheresScalarField (true), solver);
+	G2.fill (SpheresScalarField (false), solver);
+	isomesh::ComponentCulling culling;
+	culling.minTriangles = 50;
+	auto expected = isomesh::marchingCubes (G2);
+	auto unculled = isomesh::marchingCubes (G1);
+	auto culled = isomesh::marchingCubes (G1, culling);
+	if (culled.vertexCount () != expected.vertexCount () || culled.indexCount () != expected.indexCount () ||
+	    unculled.indexCount () <= culled.indexCount ()) {
+		cerr << "Marching cubes component culling by triangles count failed!" << endl;
+		return 3;
+	}
+	culling.minTriangles = 0;
+	culling.minVolume = 50.0;
+	isomesh::QefSolver3D qef;
+	expected = isomesh::dualContouring (G2, qef);
+	culled = isomesh::dualContouring (G1, qef, culling);
+	if (culled.indexCount () != expected.indexCount ()) {
+		cerr << "Dual contouring component culling by volume failed!" << endl;
+		cerr << "Expected " << expected.indexCount () << " indices, got " << culled.indexCount () << endl;
+		return 4;
+	}
+
+	return testTransitionCells ();
 }
@@ -0,0 +1,66 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+// Tests for parallel vertex clustering in MDC octree
+#include <isomesh/isomesh.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+using std::cerr;
+using std::clog;
+using std::endl;
+
+// Two intersecting spheres make clusters spanning several subtrees
+class TwoSpheresScalarField : public isomesh::ScalarField {
+public:
+	virtual double value (double x, double y, double z) const noexcept override {
+		glm::dvec3 p (x, y, z);
+		return glm::min (glm::length (p - kCenter1), glm::length (p - kCenter2)) - kRadius;
+	}
+	virtual glm::dvec3 grad (double x, double y, double z) const noexcept override {
+		glm::dvec3 p (x, y, z);
+		if (glm::length (p - kCenter1) < glm::length (p - kCenter2))
+			return glm::normalize (p - kCenter1);
+		return glm::normalize (p - kCenter2);
+	}
+	static constexpr double kRadius = 14.3;
+	static const glm::dvec3 kCenter1;
+	static const glm::dvec3 kCenter2;
+};
+
+const glm::dvec3 TwoSpheresScalarField::kCenter1 (-7.3, -4.2, 0.1);
+const glm::dvec3 TwoSpheresScalarField::kCenter2 (8.2, 5.1, -3.4);
+
+int main () {
+	TwoSpheresScalarField F;
+	isomesh::BisectionZeroFinder zero_finder;
+	isomesh::QefSolver3D solver;
+	const int sz = 64;
+	isomesh::UniformGrid G (sz);
+	G.fill (F, zero_finder);
+
+	isomesh::Mesh meshes[2];
+	const uint32_t thread_counts[2] = { 1, 4 };
+	for (int i = 0; i < 2; i++) {
+		isomesh::MDC_Octree octree (sz);
+		octree.setThreadCount (thread_counts[i]);
+		auto start = std::chrono::steady_clock::now ();
+		octree.build (G, solver);
+		std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now () - start;
+		clog << thread_counts[i] << " thread(s): built in " << time.count () << " ms" << endl;
+		meshes[i] = octree.contour (0.01f);
+	}
+	if (meshes[0].vertexCount () == 0) {
+		cerr << "Mesh is empty" << endl;
+		return 1;
+	}
+	// Clustering order within a node does not depend on threads, so meshes must be identical
+	if (meshes[0].vertexCount () != meshes[1].vertexCount () || meshes[0].indexCount () != meshes[1].indexCount () ||
+	    memcmp (meshes[0].vertexData (), meshes[1].vertexData (), meshes[0].vertexBytes ()) != 0 ||
+	    memcmp (meshes[0].indexData (), meshes[1].indexData (), meshes[0].indexBytes ()) != 0) {
+		cerr << "Parallel clustering gives different mesh" << endl;
+		return 2;
+	}
+	return 0;
+}
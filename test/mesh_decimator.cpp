@@ -0,0 +1,244 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+// Tests for edge-collapse mesh decimation
+#include <isomesh/isomesh.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+using std::cerr;
+using std::endl;
+
+class SphereScalarField : public isomesh::ScalarField {
+public:
+	virtual double value (double x, double y, double z) const noexcept override {
+		return glm::length (glm::dvec3 (x, y, z) - kCenter) - kRadius;
+	}
+	virtual glm::dvec3 grad (double x, double y, double z) const noexcept override {
+		return glm::normalize (glm::dvec3 (x, y, z) - kCenter);
+	}
+	static constexpr double kRadius = 11.7;
+	static const glm::dvec3 kCenter;
+};
+
+const glm::dvec3 SphereScalarField::kCenter (0.3, -0.2, 0.1);
+
+class BoxScalarField : public isomesh::ScalarField {
+public:
+	virtual double value (double x, double y, double z) const noexcept override {
+		glm::dvec3 d = glm::abs (glm::dvec3 (x, y, z)) - kHalfSize;
+		return glm::max (d.x, glm::max (d.y, d.z));
+	}
+	virtual glm::dvec3 grad (double x, double y, double z) const noexcept override {
+		glm::dvec3 p (x, y, z);
+		glm::dvec3 d = glm::abs (p) - kHalfSize;
+		if (d.x >= d.y && d.x >= d.z)
+			return glm::dvec3 (p.x > 0 ? 1 : -1, 0, 0);
+		if (d.y >= d.z)
+			return glm::dvec3 (0, p.y > 0 ? 1 : -1, 0);
+		return glm::dvec3 (0, 0, p.z > 0 ? 1 : -1);
+	}
+	static const glm::dvec3 kHalfSize;
+};
+
+const glm::dvec3 BoxScalarField::kHalfSize (5.3, 4.6, 3.7);
+
+// Large and small spheres in opposite corners, so most of the triangles fall into a few regions
+class TwoSpheresScalarField : public isomesh::ScalarField {
+public:
+	virtual double value (double x, double y, double z) const noexcept override {
+		glm::dvec3 p (x, y, z);
+		return glm::min (glm::length (p - kLargeCenter) - 8.3, glm::length (p - kSmallCenter) - 3.1);
+	}
+	virtual glm::dvec3 grad (double x, double y, double z) const noexcept override {
+		glm::dvec3 p (x, y, z);
+		if (glm::length (p - kLargeCenter) - 8.3 < glm::length (p - kSmallCenter) - 3.1)
+			return glm::normalize (p - kLargeCenter);
+		return glm::normalize (p - kSmallCenter);
+	}
+	static const glm::dvec3 kLargeCenter, kSmallCenter;
+};
+
+const glm::dvec3 TwoSpheresScalarField::kLargeCenter (-6.2, -5.9, -6.1);
+const glm::dvec3 TwoSpheresScalarField::kSmallCenter (11.1, 10.8, 11.3);
+
+// Checks that every directed edge is used once and has its opposite, i.e. mesh is closed and oriented
+bool isClosedManifold (const isomesh::Mesh &mesh) {
+	const uint32_t *indices = static_cast<const uint32_t *> (mesh.indexData ());
+	std::vector<std::pair<uint32_t, uint32_t>> edges;
+	for (size_t i = 0; i < mesh.indexCount (); i += 3) {
+		for (int k = 0; k < 3; k++) {
+			uint32_t a = indices[i + k], b = indices[i + (k + 1) % 3];
+			if (a == b)
+				return false;
+			edges.emplace_back (a, b);
+		}
+	}
+	std::sort (edges.begin (), edges.end ());
+	if (std::adjacent_find (edges.begin (), edges.end ()) != edges.end ())
+		return false;
+	for (const auto &e : edges)
+		if (!std::binary_search (edges.begin (), edges.end (), std::make_pair (e.second, e.first)))
+			return false;
+	return true;
+}
+
+int testSphere () {
+	SphereScalarField F;
+	isomesh::BisectionZeroFinder zero_finder;
+	const int sz = 32;
+	isomesh::UniformGrid G (sz);
+	G.fill (F, zero_finder);
+	auto mesh = isomesh::marchingCubes (G);
+	if (!isClosedManifold (mesh)) {
+		cerr << "Source mesh is not closed" << endl;
+		return 1;
+	}
+	const size_t target = mesh.indexCount () / 3 / 4;
+	for (uint32_t threads : { 1u, 4u }) {
+		isomesh::MeshDecimator decimator;
+		decimator.setTargetTriangleCount (target);
+		decimator.setThreadCount (threads);
+		auto result = decimator.decimate (mesh);
+		if (result.indexCount () / 3 > target) {
+			cerr << "Decimation with " << threads << " threads stopped at " << result.indexCount () / 3
+			     << " triangles, target is " << target << endl;
+			return 2;
+		}
+		// Regions must not over-decimate, the final pass can't restore triangles
+		if (result.indexCount () / 3 * 100 < target * 97) {
+			cerr << "Decimation with " << threads << " threads went down to " << result.indexCount () / 3
+			     << " triangles, target is " << target << endl;
+			return 6;
+		}
+		if (!isClosedManifold (result)) {
+			cerr << "Decimation with " << threads << " threads broke the mesh" << endl;
+			return 3;
+		}
+		if (result.globalPos () != mesh.globalPos () || result.globalScale () != mesh.globalScale ()) {
+			cerr << "Decimation lost mesh transform" << endl;
+			return 4;
+		}
+		for (uint32_t i = 0; i < result.vertexCount (); i++) {
+			glm::dvec3 p = glm::dvec3 (result[i].position) * result.globalScale () + result.globalPos ();
+			double deviation = glm::abs (glm::length (p - SphereScalarField::kCenter) - SphereScalarField::kRadius);
+			if (deviation > 0.5) {
+				cerr << "Decimated vertex is too far from surface (" << deviation << ")" << endl;
+				return 5;
+			}
+		}
+	}
+	return 0;
+}
+
+int testBox () {
+	BoxScalarField F;
+	isomesh::BisectionZeroFinder zero_finder;
+	isomesh::QefSolver3D solver;
+	const int sz = 16;
+	isomesh::UniformGrid G (sz);
+	G.fill (F, zero_finder);
+	auto mesh = isomesh::dualContouring (G, solver);
+	// Error bound must hold for the whole run, including the pass after parallel regions
+	for (uint32_t threads : { 1u, 4u }) {
+		isomesh::MeshDecimator decimator;
+		decimator.setMaxError (1e-4f);
+		decimator.setThreadCount (threads);
+		auto result = decimator.decimate (mesh);
+		// Flat faces collapse, corners and sharp edges stay in place
+		if (result.indexCount () * 4 > mesh.indexCount ()) {
+			cerr << "Box faces were not simplified with " << threads << " threads: " << mesh.indexCount () / 3 << " -> "
+			     << result.indexCount () / 3 << " triangles" << endl;
+			return 1;
+		}
+		if (!isClosedManifold (result)) {
+			cerr << "Box decimation broke the mesh" << endl;
+			return 2;
+		}
+		glm::dvec3 lo (0), hi (0);
+		for (uint32_t i = 0; i < result.vertexCount (); i++) {
+			glm::dvec3 p = glm::dvec3 (result[i].position) * result.globalScale () + result.globalPos ();
+			lo = glm::min (lo, p);
+			hi = glm::max (hi, p);
+			if (glm::abs (F.value (p.x, p.y, p.z)) > 0.01) {
+				cerr << "Decimated vertex left the box surface" << endl;
+				return 3;
+			}
+		}
+		if (glm::length (hi - BoxScalarField::kHalfSize) > 0.01 || glm::length (lo + BoxScalarField::kHalfSize) > 0.01) {
+			cerr << "Box corners were not preserved" << endl;
+			return 4;
+		}
+	}
+	return 0;
+}
+
+// Parallel regions must not reset errors accumulated by collapses
+int testErrorBound () {
+	SphereScalarField F;
+	isomesh::BisectionZeroFinder zero_finder;
+	const int sz = 32;
+	isomesh::UniformGrid G (sz);
+	G.fill (F, zero_finder);
+	auto mesh = isomesh::marchingCubes (G);
+	size_t counts[2];
+	for (uint32_t threads : { 1u, 4u }) {
+		isomesh::MeshDecimator decimator;
+		decimator.setMaxError (1e-2f);
+		decimator.setThreadCount (threads);
+		counts[threads > 1] = decimator.decimate (mesh).indexCount () / 3;
+	}
+	// Order of collapses differs, but the error bound should stop both at about the same point
+	if (glm::abs (double (counts[1]) - double (counts[0])) > 0.1 * double (counts[0])) {
+		cerr << "Decimation with error bound stopped at " << counts[0] << " triangles with one thread and at "
+		     << counts[1] << " with four threads" << endl;
+		return 1;
+	}
+	return 0;
+}
+
+// Regions holding most of the triangles must keep their share of the target
+int testUneven () {
+	TwoSpheresScalarField F;
+	isomesh::BisectionZeroFinder zero_finder;
+	const int sz = 32;
+	isomesh::UniformGrid G (sz);
+	G.fill (F, zero_finder);
+	auto mesh = isomesh::marchingCubes (G);
+	const size_t target = mesh.indexCount () / 3 / 2;
+	for (uint32_t threads : { 1u, 4u, 8u }) {
+		isomesh::MeshDecimator decimator;
+		decimator.setTargetTriangleCount (target);
+		decimator.setThreadCount (threads);
+		auto result = decimator.decimate (mesh);
+		size_t count = result.indexCount () / 3;
+		if (count > target || count * 100 < target * 97) {
+			cerr << "Decimation of uneven mesh with " << threads << " threads stopped at " << count
+			     << " triangles, target is " << target << endl;
+			return 1;
+		}
+		if (!isClosedManifold (result)) {
+			cerr << "Decimation of uneven mesh with " << threads << " threads broke the mesh" << endl;
+			return 2;
+		}
+	}
+	return 0;
+}
+
+int main () {
+	int ret = testSphere ();
+	if (ret)
+		return ret;
+	ret = testBox ();
+	if (ret)
+		return 10 + ret;
+	ret = testErrorBound ();
+	if (ret)
+		return 20 + ret;
+	ret = testUneven ();
+	if (ret)
+		return 30 + ret;
+	return 0;
+}
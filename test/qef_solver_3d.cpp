@@ -69,6 +69,63 @@ bool test3 (isomesh::QefSolver3D &solver) {
 	return validate (solver, { 0.5f, 1, 0.5f });
 }
 
+bool testConfig () {
+	isomesh::QefSolver3D::Config config;
+	config.maxJacobiIters = 30;
+	config.useFastFormulas = false;
+	// Solvers are cheap to construct from a shared configuration, e.g. one per worker thread
+	isomesh::QefSolver3D solver (config);
+	solver.addPlane ({ 0, 1, 0 }, { 1, 0, 0 });
+	solver.reset ();
+	// Reset clears the state but keeps the configuration
+	if (solver.maxJacobiIters () != 30 || solver.fastFormulasUsed () || solver.state ().mp_cnt != 0) {
+		cerr << "Solver lost its configuration!" << endl;
+		return false;
+	}
+	return true;
+}
+
+bool testNormalEquations () {
+	isomesh::QefSolver3D::Config config;
+	config.useNormalEquations = true;
+	isomesh::QefSolver3D qr, normal (config);
+	// Two cells sharing an edge feature, merged as in octree simplification
+	const glm::vec3 points[] = { { 0.2f, 0.5f, 0.1f }, { 0.6f, 0.5f, 0.3f }, { 0.5f, 0.2f, 0.7f }, { 0.5f, 0.8f, 0.9f } };
+	const glm::vec3 normals[] = { { 0, 1, 0 }, { 0, 1, 0 }, { 1, 0, 0 }, { 1, 0, 0 } };
+	isomesh::QefSolver3D::State states[2];
+	for (int i = 0; i < 2; i++) {
+		isomesh::QefSolver3D cell (config);
+		cell.addPlane (points[2 * i], glm::normalize (normals[2 * i] + glm::vec3 (0.01f * i)));
+		cell.addPlane (points[2 * i + 1], normals[2 * i + 1]);
+		states[i] = cell.state ();
+	}
+	for (int i = 0; i < 2; i++) {
+		qr.merge (states[i]);
+		normal.merge (states[i]);
+	}
+	glm::vec3 x1 = qr.solve ({ 0, 0, 0 }, { 1, 1, 1 });
+	glm::vec3 x2 = normal.solve ({ 0, 0, 0 }, { 1, 1, 1 });
+	clog << "Normal equations test:" << endl;
+	clog << "  QR point: " << x1 << ", error: " << qr.eval (x1) << endl;
+	clog << "  Normal equations point: " << x2 << ", error: " << normal.eval (x2) << endl;
+	if (glm::distance (x1, x2) > 0.001f) {
+		cerr << "Normal equations give different solution!" << endl;
+		return false;
+	}
+	glm::vec3 probe (0.9f, 0.1f, 0.4f);
+	if (std::abs (qr.eval (probe) - normal.eval (probe)) > 1e-4f) {
+		cerr << "Normal equations give different error!" << endl;
+		return false;
+	}
+	// Switching representation must preserve the data
+	normal.useNormalEquations (false);
+	if (std::abs (qr.eval (probe) - normal.eval (probe)) > 1e-4f) {
+		cerr << "Switching representation has lost data!" << endl;
+		return false;
+	}
+	return true;
+}
+
 int main () {
 	isomesh::QefSolver3D solver;
 	if (!test1 (solver))
@@ -80,5 +137,20 @@ int main () {
 	solver.reset ();
 	if (!test3 (solver))
 		return 3;
+	if (!testConfig ())
+		return 4;
+	isomesh::QefSolver3D::Config config;
+	config.useNormalEquations = true;
+	isomesh::QefSolver3D normal_solver (config);
+	if (!test1 (normal_solver))
+		return 5;
+	normal_solver.reset ();
+	if (!test2 (normal_solver))
+		return 6;
+	normal_solver.reset ();
+	if (!test3 (normal_solver))
+		return 7;
+	if (!testNormalEquations ())
+		return 8;
 	return 0;
 }
@@ -3,7 +3,10 @@
 // Tests for QEF solver interface and its example implementation
 #include <isomesh/qef/qef_solver_4d.hpp>
 
+#include <chrono>
 #include <iostream>
+#include <random>
+#include <vector>
 
 using std::cerr;
 using std::clog;
@@ -86,6 +89,84 @@ bool test4 (isomesh::QefSolver4D &solver) {
 	return validate (solver, { 0.5f, 0.5f, 0.5f, 0.5f });
 }
 
+// Repeated solving must reuse the decomposition, yet respect new bounds and new data
+bool test5 (isomesh::QefSolver4D &solver) {
+	const glm::vec4 points[] = { { 0.2f, 0.3f, 0.1f, 0.4f }, { 0.7f, 0.3f, 0.6f, 0.4f }, { 0.5f, 0.9f, 0.2f, 0.4f } };
+	const glm::vec4 normals[] = { { 1, 0, 0, 0 }, { 0, 0, 1, 0 }, { 0, 1, 0, 0 } };
+	isomesh::QefSolver4D fresh;
+	for (int i = 0; i < 3; i++) {
+		solver.addPlane (points[i], normals[i]);
+		fresh.addPlane (points[i], normals[i]);
+	}
+	clog << "Test 5:" << endl;
+	glm::vec4 fixed_w = solver.solve ({ 0, 0, 0, 0 }, { 1, 1, 1, 0 });
+	glm::vec4 free_w = solver.solve ({ 0, 0, 0, -1 }, { 1, 1, 1, 1 });
+	glm::vec4 expected = fresh.solve ({ 0, 0, 0, -1 }, { 1, 1, 1, 1 });
+	clog << "  Fixed W: " << fixed_w << endl;
+	clog << "  Free W: " << free_w << endl;
+	if (fixed_w.w != 0 || glm::distance (free_w, expected) > 1e-6f) {
+		cerr << "Repeated solving gives wrong result!" << endl;
+		return false;
+	}
+	solver.addPlane ({ 0, 0, 0, 0 }, { 0, 0, 0, 1 });
+	fresh.addPlane ({ 0, 0, 0, 0 }, { 0, 0, 0, 1 });
+	isomesh::QefSolver4D reference (fresh.state ());
+	glm::vec4 updated = solver.solve ({ 0, 0, 0, -1 }, { 1, 1, 1, 1 });
+	if (glm::distance (updated, reference.solve ({ 0, 0, 0, -1 }, { 1, 1, 1, 1 })) > 1e-5f) {
+		cerr << "Solver has not noticed new data!" << endl;
+		return false;
+	}
+	return true;
+}
+
+// Compares SIMD and scalar compression kernels on DMC-like workload and reports timings
+bool testSimd () {
+	const int kQefCount = 20000;
+	// DMC random sampling adds 6 * sqrt (size) planes, this is for size 64
+	const int kPlanesPerQef = 48;
+	std::mt19937 rng (42);
+	std::uniform_real_distribution<float> dist (-1.0f, 1.0f);
+	std::vector<glm::vec4> points, normals;
+	for (int i = 0; i < kQefCount * kPlanesPerQef; i++) {
+		points.emplace_back (dist (rng), dist (rng), dist (rng), 0.1f * dist (rng));
+		normals.push_back (glm::normalize (glm::vec4 (dist (rng), dist (rng), dist (rng), -1.0f)));
+	}
+	auto run = [&] (bool simd, std::vector<isomesh::QefSolver4D::State> &states) {
+		isomesh::QefSolver4D solver;
+		solver.useSimd (simd);
+		auto start = std::chrono::steady_clock::now ();
+		for (int i = 0; i < kQefCount; i++) {
+			solver.reset ();
+			for (int j = 0; j < kPlanesPerQef; j++)
+				solver.addPlane (points[i * kPlanesPerQef + j], normals[i * kPlanesPerQef + j]);
+			states.push_back (solver.state ());
+		}
+		std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now () - start;
+		return time.count ();
+	};
+	std::vector<isomesh::QefSolver4D::State> scalar_states, simd_states;
+	double scalar_time = run (false, scalar_states);
+	double simd_time = run (true, simd_states);
+	clog << "SIMD test:" << endl;
+	clog << "  Scalar kernel: " << scalar_time << " ms" << endl;
+	clog << "  SIMD kernel: " << simd_time << " ms" << endl;
+	const glm::vec4 lower (-1), upper (1);
+	for (int i = 0; i < kQefCount; i++) {
+		isomesh::QefSolver4D scalar (scalar_states[i]), simd (simd_states[i]);
+		glm::vec4 probe (dist (rng), dist (rng), dist (rng), dist (rng));
+		float expected = scalar.eval (probe);
+		if (std::abs (simd.eval (probe) - expected) > 1e-4f * (1.0f + expected)) {
+			cerr << "SIMD kernel gives different error in QEF " << i << "!" << endl;
+			return false;
+		}
+		if (glm::distance (scalar.solve (lower, upper), simd.solve (lower, upper)) > 1e-3f) {
+			cerr << "SIMD kernel gives different solution in QEF " << i << "!" << endl;
+			return false;
+		}
+	}
+	return true;
+}
+
 int main () {
 	isomesh::QefSolver4D solver;
 	if (!test1 (solver))
@@ -100,5 +181,10 @@ int main () {
 	solver.reset ();
 	if (!test4 (solver))
 		return 4;
+	solver.reset ();
+	if (!test5 (solver))
+		return 5;
+	if (!testSimd ())
+		return 6;
 	return 0;
 }
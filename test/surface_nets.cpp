@@ -0,0 +1,94 @@
+/* This file is part of Isomesh library, released under MIT license.
+  Copyright (c) 2019 Pavel Asyutchenko (sventeam@yandex.ru) */
+// Tests for surface nets algorithm
+#include <isomesh/isomesh.hpp>
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+
+using std::cerr;
+using std::clog;
+using std::endl;
+
+class SphereScalarField : public isomesh::ScalarField {
+public:
+	virtual double value (double x, double y, double z) const noexcept override {
+		return glm::length (glm::dvec3 (x, y, z) - kCenter) - kRadius;
+	}
+	virtual glm::dvec3 grad (double x, double y, double z) const noexcept override {
+		return glm::normalize (glm::dvec3 (x, y, z) - kCenter);
+	}
+	static constexpr double kRadius = 5.7;
+	static const glm::dvec3 kCenter;
+};
+
+const glm::dvec3 SphereScalarField::kCenter (0.3, -0.2, 0.1);
+
+// Returns the largest distance from mesh vertices to the sphere
+double maxSphereDeviation (const isomesh::Mesh &mesh) {
+	double result = 0;
+	for (uint32_t i = 0; i < mesh.vertexCount (); i++) {
+		glm::dvec3 p = glm::dvec3 (mesh[i].position) * mesh.globalScale () + mesh.globalPos ();
+		result = glm::max (result, glm::abs (glm::length (p - SphereScalarField::kCenter) - SphereScalarField::kRadius));
+	}
+	return result;
+}
+
+// Reports time of extracting a larger surface with surface nets versus dual contouring
+void compareTiming () {
+	SphereScalarField F;
+	isomesh::BisectionZeroFinder zero_finder;
+	isomesh::QefSolver3D solver;
+	const int sz = 64;
+	isomesh::UniformGrid G (sz, glm::dvec3 (0), 0.2);
+	G.fill (F, zero_finder);
+	const int kRuns = 5;
+	auto run = [&] (const std::function<isomesh::Mesh ()> &extract) {
+		auto start = std::chrono::steady_clock::now ();
+		for (int i = 0; i < kRuns; i++)
+			extract ();
+		std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now () - start;
+		return time.count () / kRuns;
+	};
+	double dc_time = run ([&] { return isomesh::dualContouring (G, solver); });
+	double sn_time = run ([&] { return isomesh::surfaceNets (G); });
+	clog << "Timing on " << sz << "^3 grid:" << endl;
+	clog << "  Dual contouring: " << dc_time << " ms" << endl;
+	clog << "  Surface nets: " << sn_time << " ms (" << dc_time / sn_time << "x faster)" << endl;
+}
+
+int main () {
+	SphereScalarField F;
+	isomesh::BisectionZeroFinder zero_finder;
+	isomesh::QefSolver3D solver;
+	const int sz = 16;
+	isomesh::UniformGrid G (sz);
+	G.fill (F, zero_finder);
+	// Surface nets share topology with dual contouring
+	auto reference = isomesh::dualContouring (G, solver);
+	auto mesh = isomesh::surfaceNets (G);
+	if (mesh.vertexCount () != reference.vertexCount () || mesh.indexCount () != reference.indexCount ()) {
+		cerr << "Surface nets topology differs from dual contouring" << endl;
+		cerr << "Expected " << reference.vertexCount () << " vertices and " << reference.indexCount ()
+		     << " indices, got " << mesh.vertexCount () << " and " << mesh.indexCount () << endl;
+		return 1;
+	}
+	double deviation = maxSphereDeviation (mesh);
+	if (deviation > 0.25) {
+		cerr << "Surface nets vertices are too far from surface (" << deviation << ")" << endl;
+		return 2;
+	}
+	auto smoothed = isomesh::surfaceNets (G, 3);
+	if (smoothed.indexCount () != mesh.indexCount ()) {
+		cerr << "Smoothing changed mesh topology" << endl;
+		return 3;
+	}
+	deviation = maxSphereDeviation (smoothed);
+	if (deviation > 0.5) {
+		cerr << "Smoothed vertices are too far from surface (" << deviation << ")" << endl;
+		return 4;
+	}
+	compareTiming ();
+	return 0;
+}